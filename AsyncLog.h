@@ -0,0 +1,469 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include "BoundedRing.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-=- ASYNC LOGGER -=-=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Hot-path threads (acquisition, save workers) log by copying a fixed-size
+// binary record into their own lock-free ring: no formatting, no allocation,
+// no stream lock and no syscall. A background thread drains all rings every
+// LOG_FLUSH_INTERVAL_MS, formats the records and writes them to std::cout in
+// one batch. If a ring is full the record is dropped and counted.
+//
+// Formats are printf-like but only take %u (unsigned), %d (signed), %f
+// (double, %.Nf allowed), %s (string with static lifetime), %t (the record's
+// inline text; a second %t takes the second text of WriteWithTexts; both
+// share LOG_TEXT_BYTES) and %%. The format string
+// itself must also have static lifetime.
+
+#define LOG_MAX_ARGS 8
+#define LOG_TEXT_BYTES 128
+#define LOG_RING_RECORDS 2048
+#define LOG_FLUSH_INTERVAL_MS 5
+
+enum LogLevel
+{
+	LOG_ERROR,
+	LOG_WARN,
+	LOG_INFO,
+	LOG_DEBUG
+};
+
+union LogArg
+{
+	uint64_t u;
+	int64_t i;
+	double f;
+	const char* s;
+};
+
+struct LogRecord
+{
+	const char* format;
+	LogArg args[LOG_MAX_ARGS];
+	// messages skipped by a rate limiter just before this one
+	uint32_t suppressed;
+	uint8_t level;
+	uint8_t argCount;
+	char text[LOG_TEXT_BYTES];
+};
+
+inline LogArg MakeLogArg(unsigned int value)
+{
+	LogArg arg;
+	arg.u = value;
+	return arg;
+}
+
+inline LogArg MakeLogArg(unsigned long value)
+{
+	LogArg arg;
+	arg.u = value;
+	return arg;
+}
+
+inline LogArg MakeLogArg(unsigned long long value)
+{
+	LogArg arg;
+	arg.u = value;
+	return arg;
+}
+
+inline LogArg MakeLogArg(int value)
+{
+	LogArg arg;
+	arg.i = value;
+	return arg;
+}
+
+inline LogArg MakeLogArg(long value)
+{
+	LogArg arg;
+	arg.i = value;
+	return arg;
+}
+
+inline LogArg MakeLogArg(long long value)
+{
+	LogArg arg;
+	arg.i = value;
+	return arg;
+}
+
+inline LogArg MakeLogArg(double value)
+{
+	LogArg arg;
+	arg.f = value;
+	return arg;
+}
+
+inline LogArg MakeLogArg(const char* value)
+{
+	LogArg arg;
+	arg.s = value;
+	return arg;
+}
+
+// Allows at most maxPerSecond messages per one-second window and counts the
+// rest. Not thread-safe; give each logging thread its own limiter.
+class LogRateLimiter
+{
+public:
+	explicit LogRateLimiter(uint32_t perSecond)
+		: maxPerSecond(perSecond)
+		, windowStartNs(0)
+		, windowCount(0)
+		, suppressed(0)
+	{
+	}
+
+	// True if a message may be logged now. suppressedBefore receives the
+	// number of messages refused since the last allowed one.
+	bool Allow(uint32_t& suppressedBefore)
+	{
+		if (maxPerSecond == 0)
+		{
+			suppressedBefore = 0;
+			return true;
+		}
+
+		uint64_t nowNs = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count());
+		if (nowNs - windowStartNs >= 1000000000ull)
+		{
+			windowStartNs = nowNs;
+			windowCount = 0;
+		}
+		if (windowCount >= maxPerSecond)
+		{
+			suppressed++;
+			return false;
+		}
+		windowCount++;
+		suppressedBefore = suppressed;
+		suppressed = 0;
+		return true;
+	}
+
+private:
+	uint32_t maxPerSecond;
+	uint64_t windowStartNs;
+	uint32_t windowCount;
+	uint32_t suppressed;
+};
+
+class AsyncLog
+{
+public:
+	static AsyncLog& Instance()
+	{
+		static AsyncLog log;
+		return log;
+	}
+
+	void SetLevel(LogLevel maxLevel)
+	{
+		level.store(maxLevel, std::memory_order_relaxed);
+	}
+
+	bool Enabled(LogLevel messageLevel) const
+	{
+		return messageLevel <= level.load(std::memory_order_relaxed);
+	}
+
+	// Start the writer thread. Records logged before Start are kept (up to
+	// the ring size) and written once it runs.
+	void Start()
+	{
+		if (running.exchange(true))
+			return;
+		writer = std::thread(&AsyncLog::Run, this);
+	}
+
+	// Write everything logged so far and stop the writer thread.
+	void Stop()
+	{
+		if (!running.exchange(false))
+			return;
+		writer.join();
+		Flush();
+	}
+
+	// Synchronously write everything logged so far. Call before printing to
+	// std::cout directly so output stays in order.
+	void Flush()
+	{
+		std::lock_guard<std::mutex> lock(drainMutex);
+		DrainLocked();
+	}
+
+	// Number of records dropped because a thread's ring was full.
+	uint64_t Dropped() const
+	{
+		return dropped.load(std::memory_order_relaxed);
+	}
+
+	template <typename... Args>
+	void Write(LogLevel messageLevel, const char* format, Args... args)
+	{
+		WriteWithText(messageLevel, 0, NULL, format, args...);
+	}
+
+	// Log with inline text for %t and a suppressed count from a limiter.
+	template <typename... Args>
+	void WriteWithText(LogLevel messageLevel, uint32_t suppressed, const char* text, const char* format, Args... args)
+	{
+		WriteWithTexts(messageLevel, suppressed, text, NULL, format, args...);
+	}
+
+	// As WriteWithText, with a second text for the second %t.
+	template <typename... Args>
+	void WriteWithTexts(LogLevel messageLevel, uint32_t suppressed, const char* text, const char* secondText, const char* format, Args... args)
+	{
+		static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "too many log arguments");
+		if (!Enabled(messageLevel))
+			return;
+
+		LogRecord record;
+		record.format = format;
+		record.suppressed = suppressed;
+		record.level = static_cast<uint8_t>(messageLevel);
+		record.argCount = static_cast<uint8_t>(sizeof...(Args));
+		StoreArgs(record.args, args...);
+		// texts are stored back to back, each NUL-terminated
+		size_t used = CopyText(record.text, LOG_TEXT_BYTES, text);
+		CopyText(record.text + used, LOG_TEXT_BYTES - used, secondText);
+
+		if (!GetThreadRing()->TryPush(record))
+			dropped.fetch_add(1, std::memory_order_relaxed);
+	}
+
+private:
+	AsyncLog()
+		: level(LOG_INFO)
+		, running(false)
+		, dropped(0)
+		, reportedDropped(0)
+	{
+	}
+
+	~AsyncLog()
+	{
+		Stop();
+	}
+
+	AsyncLog(const AsyncLog&);
+	AsyncLog& operator=(const AsyncLog&);
+
+	typedef BoundedRing<LogRecord> LogRing;
+
+	// Copy a possibly truncated string and its NUL; returns bytes used.
+	static size_t CopyText(char* pOut, size_t room, const char* text)
+	{
+		if (room == 0)
+			return 0;
+		size_t length = text ? std::strlen(text) : 0;
+		if (length > room - 1)
+			length = room - 1;
+		if (length)
+			std::memcpy(pOut, text, length);
+		pOut[length] = '\0';
+		return length + 1;
+	}
+
+	static void StoreArgs(LogArg*)
+	{
+	}
+
+	template <typename First, typename... Rest>
+	static void StoreArgs(LogArg* pArgs, First first, Rest... rest)
+	{
+		*pArgs = MakeLogArg(first);
+		StoreArgs(pArgs + 1, rest...);
+	}
+
+	// The calling thread's ring, registered on first use (the only locked
+	// step on the producer side).
+	LogRing* GetThreadRing()
+	{
+		static thread_local LogRing* ring = NULL;
+		if (!ring)
+		{
+			std::lock_guard<std::mutex> lock(ringsMutex);
+			rings.push_back(std::unique_ptr<LogRing>(new LogRing(LOG_RING_RECORDS)));
+			ring = rings.back().get();
+		}
+		return ring;
+	}
+
+	void Run()
+	{
+		while (running.load(std::memory_order_acquire))
+		{
+			Flush();
+			std::this_thread::sleep_for(std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MS));
+		}
+	}
+
+	// Caller holds drainMutex.
+	void DrainLocked()
+	{
+		std::vector<LogRing*> snapshot;
+		{
+			std::lock_guard<std::mutex> lock(ringsMutex);
+			for (size_t i = 0; i < rings.size(); i++)
+				snapshot.push_back(rings[i].get());
+		}
+
+		output.clear();
+		LogRecord record;
+		for (size_t i = 0; i < snapshot.size(); i++)
+		{
+			while (snapshot[i]->TryPop(record))
+				FormatRecord(record, output);
+		}
+
+		uint64_t droppedNow = dropped.load(std::memory_order_relaxed);
+		if (droppedNow != reportedDropped)
+		{
+			output += "[log] " + std::to_string(droppedNow - reportedDropped) + " record(s) dropped, log ring full\n";
+			reportedDropped = droppedNow;
+		}
+
+		if (!output.empty())
+		{
+			std::cout.write(output.data(), static_cast<std::streamsize>(output.size()));
+			std::cout.flush();
+		}
+	}
+
+	static void FormatRecord(const LogRecord& record, std::string& out)
+	{
+		char number[64];
+		int argIndex = 0;
+		int textIndex = 0;
+		const char* pText = record.text;
+		for (const char* p = record.format; *p; p++)
+		{
+			if (*p != '%')
+			{
+				out += *p;
+				continue;
+			}
+
+			// optional precision for %f, e.g. %.2f
+			int precision = 6;
+			if (p[1] == '.' && p[2] >= '0' && p[2] <= '9')
+			{
+				precision = p[2] - '0';
+				p += 2;
+			}
+
+			char spec = *++p;
+			if (spec == '\0')
+				break;
+			if (spec == '%')
+			{
+				out += '%';
+				continue;
+			}
+			if (spec == 't')
+			{
+				// at most two texts; a truncated first text leaves no room for a second
+				if (textIndex < 2 && pText < record.text + LOG_TEXT_BYTES)
+				{
+					out += pText;
+					pText += std::strlen(pText) + 1;
+				}
+				textIndex++;
+				continue;
+			}
+			if (argIndex >= record.argCount)
+			{
+				out += "<?>";
+				continue;
+			}
+
+			const LogArg& arg = record.args[argIndex++];
+			switch (spec)
+			{
+			case 'u':
+				std::snprintf(number, sizeof(number), "%llu", static_cast<unsigned long long>(arg.u));
+				out += number;
+				break;
+			case 'd':
+				std::snprintf(number, sizeof(number), "%lld", static_cast<long long>(arg.i));
+				out += number;
+				break;
+			case 'f':
+				std::snprintf(number, sizeof(number), "%.*f", precision, arg.f);
+				out += number;
+				break;
+			case 's':
+				out += arg.s ? arg.s : "(null)";
+				break;
+			default:
+				out += "<?>";
+				break;
+			}
+		}
+
+		if (record.suppressed > 0)
+		{
+			// keep the suppressed note before the message's own line break
+			bool newline = !out.empty() && out[out.size() - 1] == '\n';
+			if (newline)
+				out.erase(out.size() - 1);
+			out += " [" + std::to_string(record.suppressed) + " similar suppressed]";
+			if (newline)
+				out += '\n';
+		}
+	}
+
+	std::atomic<int> level;
+	std::atomic<bool> running;
+	std::thread writer;
+
+	std::mutex ringsMutex;
+	std::vector<std::unique_ptr<LogRing>> rings;
+
+	std::mutex drainMutex;
+	std::string output;
+
+	std::atomic<uint64_t> dropped;
+	uint64_t reportedDropped;
+};
+
+// Shorthands for the global logger.
+template <typename... Args>
+inline void LogMessage(LogLevel level, const char* format, Args... args)
+{
+	AsyncLog::Instance().Write(level, format, args...);
+}
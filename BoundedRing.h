@@ -0,0 +1,219 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+
+// Size used to keep hot atomics on separate cache lines. Padding is done with
+// explicit byte arrays because C++11 operator new ignores over-alignment.
+#define RING_CACHE_LINE 64
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- FUTEX WAKE SIGNAL -=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Event count built on a futex. A waiter announces itself with PrepareWait,
+// re-checks its condition and then either calls Wait or CancelWait. Notify is
+// a single relaxed load when nobody is parked, so the signalling thread only
+// pays for a syscall when a waiter actually sleeps.
+class FutexEvent
+{
+public:
+	FutexEvent()
+		: epoch(0)
+		, waiters(0)
+		, wakeCount(0)
+	{
+	}
+
+	uint32_t PrepareWait()
+	{
+		waiters.fetch_add(1, std::memory_order_seq_cst);
+		return epoch.load(std::memory_order_seq_cst);
+	}
+
+	void CancelWait()
+	{
+		waiters.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	void Wait(uint32_t expected)
+	{
+		// returns immediately if a notify already advanced the epoch
+		while (epoch.load(std::memory_order_acquire) == expected)
+			syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch), FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+		waiters.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	void NotifyOne()
+	{
+		Notify(1);
+	}
+
+	void NotifyAll()
+	{
+		Notify(INT_MAX);
+	}
+
+	uint64_t WakeCount() const
+	{
+		return wakeCount.load(std::memory_order_relaxed);
+	}
+
+private:
+	void Notify(int count)
+	{
+		// pairs with the seq_cst increment in PrepareWait so either the waiter
+		// sees the new state or we see the waiter
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (waiters.load(std::memory_order_relaxed) == 0)
+			return;
+
+		epoch.fetch_add(1, std::memory_order_release);
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch), FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+		wakeCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	std::atomic<uint32_t> epoch;
+	std::atomic<uint32_t> waiters;
+	// wake syscalls issued by notifiers
+	std::atomic<uint64_t> wakeCount;
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be 32 bits");
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-= BOUNDED RING -=-=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Bounded lock-free ring (Vyukov sequence-per-cell design). Push and Pop are
+// both safe from any number of threads, which lets save workers share one
+// ring and lets the producer evict the oldest entry.
+template <typename T>
+class BoundedRing
+{
+public:
+	explicit BoundedRing(size_t minCapacity)
+		: capacity(RoundUpPowerOfTwo(minCapacity < 2 ? 2 : minCapacity))
+		, mask(capacity - 1)
+		, cells(new Cell[capacity])
+		, enqueuePos(0)
+		, dequeuePos(0)
+	{
+		for (size_t i = 0; i < capacity; i++)
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	~BoundedRing()
+	{
+		delete[] cells;
+	}
+
+	size_t Capacity() const
+	{
+		return capacity;
+	}
+
+	bool TryPush(T& value)
+	{
+		size_t pos = enqueuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = cells[pos & mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+			if (diff == 0)
+			{
+				if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					cell.value = std::move(value);
+					cell.sequence.store(pos + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = enqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	bool TryPop(T& value)
+	{
+		size_t pos = dequeuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Cell& cell = cells[pos & mask];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+			if (diff == 0)
+			{
+				if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					value = std::move(cell.value);
+					cell.sequence.store(pos + capacity, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (diff < 0)
+			{
+				return false;
+			}
+			else
+			{
+				pos = dequeuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+private:
+	BoundedRing(const BoundedRing&);
+	BoundedRing& operator=(const BoundedRing&);
+
+	static size_t RoundUpPowerOfTwo(size_t value)
+	{
+		size_t result = 1;
+		while (result < value)
+			result <<= 1;
+		return result;
+	}
+
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	const size_t capacity;
+	const size_t mask;
+	Cell* const cells;
+
+	char pad0[RING_CACHE_LINE];
+	std::atomic<size_t> enqueuePos;
+	char pad1[RING_CACHE_LINE - sizeof(std::atomic<size_t>)];
+	std::atomic<size_t> dequeuePos;
+	char pad2[RING_CACHE_LINE - sizeof(std::atomic<size_t>)];
+};
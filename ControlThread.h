@@ -0,0 +1,374 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <poll.h>
+#include <pthread.h>
+#include <stdexcept>
+#include <string>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+#define CONTROL_ESC_KEY 27
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- CONTROL SIGNALS -=-=-=
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// SIGINT, SIGTERM and SIGHUP request a stop; SIGUSR1 is a trigger. They are
+// received through a signalfd, so they must be blocked in every thread:
+// call BlockControlSignals at the top of main, before the SDK, the logger or
+// any other thread is created, and new threads inherit the mask.
+inline void GetControlSignals(sigset_t* pSet)
+{
+	sigemptyset(pSet);
+	sigaddset(pSet, SIGINT);
+	sigaddset(pSet, SIGTERM);
+	sigaddset(pSet, SIGHUP);
+	sigaddset(pSet, SIGUSR1);
+}
+
+inline void BlockControlSignals()
+{
+	sigset_t signals;
+	GetControlSignals(&signals);
+	int error = pthread_sigmask(SIG_BLOCK, &signals, NULL);
+	if (error != 0)
+		throw std::runtime_error(std::string("Failed to block control signals: ") + std::strerror(error));
+}
+
+// Give the calling thread default signal behaviour back once the control
+// thread is gone, e.g. so Ctrl+C works at a final prompt.
+inline void UnblockControlSignals()
+{
+	sigset_t signals;
+	GetControlSignals(&signals);
+	pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+}
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-= CONTROL THREAD -=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Waits in poll() on the signalfd, an eventfd used to wake it up, stdin (while
+// watched) and the trigger socket (if any). Stop and trigger requests are
+// published as atomics, so the acquisition loop only pays a relaxed
+// load per frame and never makes a syscall to look for them.
+//
+// Stop sources: ESC on stdin, SIGINT, SIGTERM, SIGHUP and RequestStop. A
+// second stop signal while a stop is already pending restores the terminal
+// and lets the signal terminate the process, so Ctrl+C twice always exits.
+// Trigger sources: the trigger key on stdin, SIGUSR1 and datagrams on the
+// trigger socket.
+//
+// stdin need not be a terminal. A terminal is switched to unbuffered,
+// no-echo input while watched; pipes are read as they are, and EOF (as with
+// /dev/null under systemd) simply stops watching stdin.
+class ControlThread
+{
+public:
+	explicit ControlThread(char triggerKey)
+		: triggerKey(triggerKey)
+		, signalFd(-1)
+		, wakeFd(-1)
+		, stopRequested(false)
+		, triggerCount(0)
+		, stopSignal(0)
+		, exitThread(false)
+		, stdinWatched(false)
+		, terminalRaw(false)
+		, triggerFd(-1)
+	{
+		std::memset(&originalTermios, 0, sizeof(originalTermios));
+	}
+
+	~ControlThread()
+	{
+		Stop();
+	}
+
+	// Open the signalfd and eventfd and start the thread. Throws on failure.
+	void Start()
+	{
+		sigset_t signals;
+		GetControlSignals(&signals);
+		signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+		if (signalFd < 0)
+			throw std::runtime_error(std::string("Failed to create signalfd: ") + std::strerror(errno));
+
+		wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (wakeFd < 0)
+		{
+			int error = errno;
+			CloseFds();
+			throw std::runtime_error(std::string("Failed to create eventfd: ") + std::strerror(error));
+		}
+
+		exitThread.store(false, std::memory_order_relaxed);
+		thread = std::thread(&ControlThread::Run, this);
+	}
+
+	void Stop()
+	{
+		if (thread.joinable())
+		{
+			exitThread.store(true, std::memory_order_release);
+			Wake();
+			thread.join();
+		}
+		UnwatchStdin();
+		CloseFds();
+	}
+
+	// Ask the acquisition loop to stop, as ESC or SIGTERM would. Safe from
+	// any thread.
+	void RequestStop()
+	{
+		stopRequested.store(true, std::memory_order_relaxed);
+	}
+
+	bool StopRequested() const
+	{
+		return stopRequested.load(std::memory_order_relaxed);
+	}
+
+	// Signal that requested the stop, or 0 for ESC, RequestStop or none.
+	int StopSignal() const
+	{
+		return stopSignal.load(std::memory_order_relaxed);
+	}
+
+	// Number of triggers so far. Each acquisition thread compares it with
+	// the count it last acted on, so one trigger reaches every camera.
+	uint64_t TriggerCount() const
+	{
+		return triggerCount.load(std::memory_order_relaxed);
+	}
+
+	// Start reading the stop and trigger keys from stdin.
+	void WatchStdin()
+	{
+		std::lock_guard<std::mutex> lock(configMutex);
+		if (stdinWatched)
+			return;
+
+		if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &originalTermios) == 0)
+		{
+			termios raw = originalTermios;
+			raw.c_lflag &= ~(ICANON | ECHO);
+			raw.c_cc[VMIN] = 1;
+			raw.c_cc[VTIME] = 0;
+			terminalRaw = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+		}
+		stdinWatched = true;
+		Wake();
+	}
+
+	// Stop reading stdin and restore the terminal, e.g. before prompting.
+	void UnwatchStdin()
+	{
+		std::lock_guard<std::mutex> lock(configMutex);
+		stdinWatched = false;
+		RestoreTerminalLocked();
+		Wake();
+	}
+
+	// Watch a non-blocking datagram socket; every datagram is a trigger.
+	// Pass -1 to stop watching. The caller keeps ownership of the socket.
+	void WatchTriggerSocket(int fd)
+	{
+		std::lock_guard<std::mutex> lock(configMutex);
+		triggerFd = fd;
+		Wake();
+	}
+
+private:
+	ControlThread(const ControlThread&);
+	ControlThread& operator=(const ControlThread&);
+
+	void Wake()
+	{
+		if (wakeFd < 0)
+			return;
+		uint64_t one = 1;
+		ssize_t written = write(wakeFd, &one, sizeof(one));
+		(void)written;
+	}
+
+	void CloseFds()
+	{
+		if (signalFd >= 0)
+			close(signalFd);
+		if (wakeFd >= 0)
+			close(wakeFd);
+		signalFd = -1;
+		wakeFd = -1;
+	}
+
+	// Caller holds configMutex.
+	void RestoreTerminalLocked()
+	{
+		if (terminalRaw)
+			tcsetattr(STDIN_FILENO, TCSANOW, &originalTermios);
+		terminalRaw = false;
+	}
+
+	void Run()
+	{
+		while (!exitThread.load(std::memory_order_acquire))
+		{
+			bool watchStdin;
+			int watchTrigger;
+			{
+				std::lock_guard<std::mutex> lock(configMutex);
+				watchStdin = stdinWatched;
+				watchTrigger = triggerFd;
+			}
+
+			pollfd fds[4];
+			nfds_t count = 0;
+			fds[count].fd = signalFd;
+			fds[count++].events = POLLIN;
+			fds[count].fd = wakeFd;
+			fds[count++].events = POLLIN;
+			nfds_t stdinIndex = count;
+			if (watchStdin)
+			{
+				fds[count].fd = STDIN_FILENO;
+				fds[count++].events = POLLIN;
+			}
+			nfds_t triggerIndex = count;
+			if (watchTrigger >= 0)
+			{
+				fds[count].fd = watchTrigger;
+				fds[count++].events = POLLIN;
+			}
+			for (nfds_t i = 0; i < count; i++)
+				fds[i].revents = 0;
+
+			if (poll(fds, count, -1) < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				// nothing sensible left to wait on; stop rather than spin
+				RequestStop();
+				return;
+			}
+
+			if (fds[0].revents & POLLIN)
+				ReadSignals();
+			if (fds[1].revents & POLLIN)
+			{
+				uint64_t value = 0;
+				ssize_t bytesRead = read(wakeFd, &value, sizeof(value));
+				(void)bytesRead;
+			}
+			if (watchStdin && fds[stdinIndex].revents)
+				ReadStdin();
+			if (watchTrigger >= 0 && (fds[triggerIndex].revents & POLLIN))
+			{
+				char message[64];
+				while (recv(watchTrigger, message, sizeof(message), MSG_DONTWAIT) >= 0)
+					triggerCount.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void ReadSignals()
+	{
+		signalfd_siginfo info;
+		while (read(signalFd, &info, sizeof(info)) == static_cast<ssize_t>(sizeof(info)))
+		{
+			int signalNumber = static_cast<int>(info.ssi_signo);
+			if (signalNumber == SIGUSR1)
+			{
+				triggerCount.fetch_add(1, std::memory_order_relaxed);
+				continue;
+			}
+
+			if (StopRequested())
+				ForceExit(signalNumber);
+			stopSignal.store(signalNumber, std::memory_order_relaxed);
+			RequestStop();
+		}
+	}
+
+	void ReadStdin()
+	{
+		char input[64];
+		ssize_t bytesRead = read(STDIN_FILENO, input, sizeof(input));
+		if (bytesRead < 0 && (errno == EINTR || errno == EAGAIN))
+			return;
+		if (bytesRead <= 0)
+		{
+			// EOF or error: nothing more will come from stdin
+			std::lock_guard<std::mutex> lock(configMutex);
+			stdinWatched = false;
+			return;
+		}
+
+		for (ssize_t i = 0; i < bytesRead; i++)
+		{
+			if (input[i] == CONTROL_ESC_KEY)
+				RequestStop();
+			else if (input[i] == triggerKey)
+				triggerCount.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	// Give up on a graceful stop: restore the terminal and let the signal
+	// take its default action.
+	void ForceExit(int signalNumber)
+	{
+		{
+			std::lock_guard<std::mutex> lock(configMutex);
+			RestoreTerminalLocked();
+		}
+		std::signal(signalNumber, SIG_DFL);
+		sigset_t only;
+		sigemptyset(&only);
+		sigaddset(&only, signalNumber);
+		pthread_sigmask(SIG_UNBLOCK, &only, NULL);
+		raise(signalNumber);
+		_exit(128 + signalNumber);
+	}
+
+	const char triggerKey;
+	int signalFd;
+	int wakeFd;
+
+	std::atomic<bool> stopRequested;
+	std::atomic<uint64_t> triggerCount;
+	std::atomic<int> stopSignal;
+	std::atomic<bool> exitThread;
+	std::thread thread;
+
+	// guards what the thread watches and the saved terminal state
+	std::mutex configMutex;
+	bool stdinWatched;
+	bool terminalRaw;
+	termios originalTermios;
+	int triggerFd;
+};
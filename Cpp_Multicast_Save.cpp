@@ -15,28 +15,52 @@
 #include "stdafx.h"
 #include "ArenaApi.h"
 #include "SaveApi.h"
+#include "AsyncLog.h"
+#include "BoundedRing.h"
+#include "ControlThread.h"
+#include "DirectIo.h"
+#include "FramePipeline.h"
+#include "FramePool.h"
+#include "FrameStats.h"
+#include "Gvsp.h"
+#include "LatencyHistogram.h"
+#include "NicStats.h"
+#include "ParallelPng.h"
+#include "PreTrigger.h"
+#include "RawFrame.h"
+#include "RecordingWriter.h"
+#include "ShmFrameRing.h"
+#include "StageTrace.h"
+#include "ThreadPlacement.h"
+#include "UdpDrops.h"
+#include "UringWriter.h"
 #include <arpa/inet.h>
+#include <atomic>
 #include <chrono>
-#include <condition_variable>
+#include <cstdlib>
 #include <ctime>
 #include <cstring>
-#include <deque>
 #include <errno.h>
+#include <exception>
 #include <fcntl.h>
+#include <fstream>
 #include <iomanip>
 #include <limits.h>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <net/if.h>
 #include <netinet/in.h>
 #include <sstream>
 #include <stdexcept>
 #include <string>
-#include <termios.h>
 #include <thread>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include <vector>
 
 #define TAB1 "  "
 #define TAB2 "    "
@@ -58,7 +82,16 @@
 // pixel format
 #define PIXEL_FORMAT BGR8
 
-// multicast group IP (fixed)
+// multicast group IP (override with --group)
+//    With --cameras each camera gets its own group: SERIAL@GROUP sets it,
+//    otherwise camera i uses this address + i (239.10.10.10, .11, ...).
+//    SERIAL%INTERFACE joins a camera's group on another NIC than the one
+//    given first on the command line, so cameras spread over several ports
+//    are received by one process.
+//    With --ssm each group is joined for its camera's IP address only
+//    (IGMPv3 source-specific multicast), so other masters streaming to the
+//    same group on a shared segment are filtered out by the kernel and by
+//    IGMPv3-snooping switches.
 #define MULTICAST_GROUP_IP "239.10.10.10"
 
 // Length of time to grab images (sec)
@@ -68,6 +101,548 @@
 //    Retained from the original example; loop now exits on ESC.
 #define NUM_SECONDS 20
 
+// console logging (override with --log-level, --log-rate)
+//    Per-frame lines go through the async logger (AsyncLog.h) so the
+//    acquisition thread never blocks on the terminal. At most
+//    LOG_FRAME_LINES_PER_SEC frame lines are printed per second; the rest are
+//    counted and reported with the next line.
+#define LOG_LEVEL LOG_INFO
+#define LOG_FRAME_LINES_PER_SEC 100
+
+// seconds between live frame statistics lines (override with --stats-sec, 0 = off)
+//    Received and dropped frames are found from gaps in the frame IDs, frame
+//    rate and jitter from device timestamp deltas; totals, a drop-run
+//    histogram and interval percentiles are also printed at exit. With
+//    --stats-file the same figures are written as JSON lines for scripts.
+//    Every interval main also logs each interface's throughput: frame bytes
+//    of its cameras and the NIC's own receive, drop and miss counters.
+#define STATS_INTERVAL_SEC 5
+// how often main checks whether the acquisition threads are done
+#define STATS_MAIN_POLL_MS 100
+
+// number of frames saved after streaming starts (override with --save-frames)
+//    The listener exits once they are saved; the master keeps streaming.
+#define NUM_SAVED_FRAMES 10
+
+// pre-trigger ring (enable with --pretrigger-frames, limit age with --pretrigger-ms)
+//    Instead of the first frames, keep the most recent N frames in pool slots
+//    and hand them to the save workers when a trigger fires: TRIGGER_KEY on
+//    the keyboard, SIGUSR1, or any datagram sent to TRIGGER_SOCKET_NAME in the
+//    output directory. Memory is fixed at startup to (pre-trigger frames +
+//    pool slots) * PayloadSize.
+#define TRIGGER_KEY 't'
+#define TRIGGER_SOCKET_NAME "trigger.sock"
+
+// number of save worker threads (override with --save-workers)
+//    Each worker converts and encodes one frame at a time, so PNG saving scales
+//    roughly with the number of workers up to the number of free cores.
+#define NUM_SAVE_WORKERS 4
+
+// save queue limits (override with --queue-jobs, --queue-mb, --queue-policy)
+//    Each queued job holds a full copy of a frame, so the queue is bounded by
+//    both job count and bytes. Jobs being saved still count against the limits
+//    until their copy is destroyed. With several cameras every camera has its
+//    own queue and frame pool with an equal share of the limits, and the save
+//    workers take jobs from the queues in turn, so a busy camera cannot starve
+//    the others of workers or disk bandwidth.
+#define SAVE_QUEUE_MAX_JOBS 64
+#define SAVE_QUEUE_MAX_MB 1024
+
+// number of pre-allocated frame slots (override with --pool-slots)
+//    Slots are sized from the stream's PayloadSize at startup. By default the
+//    pool matches the save queue so an admitted job always finds a free slot;
+//    it is also capped by the queue's byte limit. When no slot is free the
+//    frame falls back to ImageFactory::Copy.
+#define FRAME_POOL_SLOTS SAVE_QUEUE_MAX_JOBS
+
+// zero-copy buffer hold (enable with --hold-buffers, override the stream's
+// buffer count with --stream-buffers)
+//    Save jobs may keep the SDK buffer itself instead of a copy and hand it
+//    back to the acquisition thread for requeueing once written. Only up to
+//    the hold watermark are held at a time; beyond it frames are copied as
+//    before. Unless given, the stream gets watermark + STREAM_FREE_BUFFERS
+//    buffers so GetImage always has free ones while the maximum is held.
+#define STREAM_FREE_BUFFERS 8
+
+// threads used to encode one PNG (override with --png-threads)
+//    0 saves through Save::ImageWriter. Any other value uses the striped
+//    encoder in ParallelPng.h, which deflates horizontal stripes of a frame
+//    concurrently; keep save workers * PNG threads near the number of cores.
+#define PNG_ENCODER_THREADS 0
+
+// zlib compression level for the striped PNG encoder (1 fastest, 9 smallest)
+#define PNG_DEFLATE_LEVEL 6
+
+// maximum size of one recording segment file in MB (override with --segment-mb)
+#define RECORDING_SEGMENT_MB 2048
+
+// records in flight per save worker with the io_uring backend (override with --io-depth)
+#define IO_URING_DEPTH 8
+
+// per-stage latency of saved frames (see StageTrace.h)
+//    Every save job is stamped with the monotonic clock from GetImage to the
+//    end of its write, and per-stage percentiles are printed at exit. --fsync
+//    adds an fdatasync per png/raw file so the last stage ends when the data
+//    is durable. --trace-file also writes the stages as Chrome trace events
+//    for Perfetto (ui.perfetto.dev) or chrome://tracing.
+
+// thread placement (override with --acq-cpus, --acq-fifo, --save-cpus,
+// --save-nice, --save-ioprio)
+//    By default all threads float. Pinning the acquisition threads away from
+//    the save workers keeps PNG encoding from delaying GetImage and requeue;
+//    on big.LITTLE boards "big" and "little" select cores by cpu_capacity.
+//    With several cameras and at least as many acquisition CPUs, camera i
+//    gets every Nth CPU of the list. "nic" pins each camera's thread to the
+//    CPUs that handle its interface's IRQs, shared the same way by cameras
+//    on one interface; this is the default when cameras use several
+//    interfaces. SCHED_FIFO and negative nice values need CAP_SYS_NICE;
+//    I/O priorities only take effect with the BFQ scheduler.
+//    The effective placement of every thread is logged at startup.
+#define ACQUISITION_FIFO_PRIORITY 0
+#define SAVE_WORKER_NICE 0
+
+// frame processing stages (add with --stage, in order)
+//    Each save worker runs a camera's stages on a frame after taking it from
+//    the queue and before converting and writing it, e.g. "crop=X,Y,W,H"
+//    then "stats". Unordered stages run on any number of workers at once;
+//    ordered ones see one frame at a time in queue order. Per-stage timing
+//    and dropped frames are printed at exit. Cropped frames are always
+//    written from the worker, never from a fixed io_uring buffer.
+
+// shared-memory frame ring for local readers (enable with --shm <name>,
+// override the slot count with --shm-slots)
+//    Every complete frame is copied once into a POSIX shared-memory ring
+//    (ShmFrameRing.h) so analysis, preview or archiving processes on the same
+//    host can read the stream without their own multicast listener. The copy
+//    happens on the acquisition thread and never waits for readers: a reader
+//    more than the slot count behind loses frames, which is logged with the
+//    frame statistics. With several cameras each gets "<name>-<serial>".
+#define SHM_RING_SLOTS 8
+
+// native GVSP receiver for listener hosts (enable with --native-gvsp,
+// override the stream port with --gvsp-port)
+//    Instead of starting the SDK stream, the listener binds its multicast
+//    socket to the stream port and reads GVSP datagrams itself with
+//    recvmmsg, GVSP_BATCH_PACKETS per syscall (Gvsp.h). Packets are
+//    reassembled straight into frame pool slots, which go to the save queue
+//    without another copy. The port defaults to the camera's GevSCPHostPort
+//    as configured by the master. Incomplete frames are counted but not
+//    saved, since a passive listener cannot request resends.
+#define NATIVE_GVSP_POLL_MS 100
+
+// socket receive buffer of the native GVSP receiver
+//    Sized to hold this many milliseconds of the expected stream (PayloadSize
+//    x AcquisitionFrameRate), within the limits below, so a receive thread
+//    that is briefly descheduled does not lose datagrams in the socket queue.
+//    SO_RCVBUFFORCE needs CAP_NET_ADMIN; without it SO_RCVBUF is capped at
+//    net.core.rmem_max. Kernel drops on the stream port and host-wide UDP
+//    RcvbufErrors are logged next to the frame statistics in either mode.
+#define SOCKET_RCVBUF_MS 200
+#define SOCKET_RCVBUF_MIN_BYTES (4 * 1024 * 1024)
+#define SOCKET_RCVBUF_MAX_BYTES (512 * 1024 * 1024)
+
+// save jobs slower than this are reported as write stalls
+//    With buffered writes the kernel's writeback of dirty pages periodically
+//    blocks writers for hundreds of milliseconds; --direct-io avoids the page
+//    cache for raw and rec output.
+#define WRITE_STALL_MS 100
+
+// drop every Nth offered frame while the save queue is at least half full
+// (used by the drop-nth policy, override with --drop-nth)
+#define SAVE_QUEUE_DROP_NTH 2
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- COMMAND LINE OPTIONS
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+enum SaveFormat
+{
+	// How saved frames are written to disk.
+	SAVE_FORMAT_PNG,      // convert to PIXEL_FORMAT and encode as PNG
+	SAVE_FORMAT_RAW,      // original pixel buffer behind a RawFrameHeader (RawFrame.h)
+	SAVE_FORMAT_RECORDING // raw frame records appended to segment files (RecordingWriter.h)
+};
+
+enum IoBackend
+{
+	// How recording segments are written.
+	IO_BACKEND_PWRITE, // blocking pwritev, one write in flight per worker
+	IO_BACKEND_URING   // io_uring, many writes in flight per worker (UringWriter.h)
+};
+
+enum QueuePolicy
+{
+	// What to do with a new frame when the save queue is full.
+	QUEUE_POLICY_BLOCK,       // wait in the acquisition loop until a job completes
+	QUEUE_POLICY_DROP_NEWEST, // discard the new frame
+	QUEUE_POLICY_DROP_OLDEST, // discard queued frames that have not started saving
+	QUEUE_POLICY_DROP_NTH     // thin out every Nth frame once half full, then drop newest
+};
+
+enum SaveAdmission
+{
+	// Outcome of reserving room for a new frame in the save queue.
+	SAVE_ADMITTED,
+	SAVE_DROPPED_FULL,   // no room for the frame
+	SAVE_DROPPED_THINNED // dropped by QUEUE_POLICY_DROP_NTH while there was room
+};
+
+struct SaveQueueLimits
+{
+	size_t maxJobs;
+	uint64_t maxBytes;
+	QueuePolicy policy;
+	size_t dropNth;
+};
+
+struct Options
+{
+	// Runtime options; defaults come from the settings above.
+	const char* interfaceName;
+	// "all" or SERIAL[@GROUP][,...]; NULL selects one device interactively
+	const char* cameras;
+	// group of a single camera, and the base of the --cameras defaults
+	const char* group;
+	// join each group for its camera's address only
+	bool sourceSpecific;
+	SaveFormat saveFormat;
+	uint64_t segmentBytes;
+	IoBackend ioBackend;
+	unsigned ioDepth;
+	bool directIo;
+	bool syncFiles;
+	const char* traceFile;
+	size_t pngThreads;
+	LogLevel logLevel;
+	uint32_t logRate;
+	uint64_t statsSec;
+	const char* statsFile;
+	size_t saveFrames;
+	size_t preTriggerFrames;
+	uint64_t preTriggerMs;
+	size_t saveWorkers;
+	SaveQueueLimits queueLimits;
+	size_t poolSlots;
+	// SDK buffers save jobs may hold per camera (0 = always copy)
+	size_t holdBuffers;
+	// buffers per stream (0 = SDK default, or derived from holdBuffers)
+	size_t streamBuffers;
+	ThreadPlacement acquisitionPlacement;
+	// --acq-cpus nic: CPUs come from each camera's interface instead
+	bool acquisitionNicCpus;
+	ThreadPlacement savePlacement;
+	// --stage specs, run in order on every camera's frames
+	std::vector<std::string> stages;
+	// shared-memory ring name, or NULL
+	const char* shmName;
+	size_t shmSlots;
+	// receive GVSP without the SDK (listener only); port 0 = GevSCPHostPort
+	bool nativeGvsp;
+	uint16_t gvspPort;
+};
+
+static const char* GetQueuePolicyName(QueuePolicy policy)
+{
+	switch (policy)
+	{
+	case QUEUE_POLICY_BLOCK:
+		return "block";
+	case QUEUE_POLICY_DROP_NEWEST:
+		return "drop-newest";
+	case QUEUE_POLICY_DROP_OLDEST:
+		return "drop-oldest";
+	case QUEUE_POLICY_DROP_NTH:
+		return "drop-nth";
+	}
+	return "unknown";
+}
+
+static SaveFormat ParseSaveFormat(const char* value)
+{
+	std::string name = value;
+	if (name == "png")
+		return SAVE_FORMAT_PNG;
+	if (name == "raw")
+		return SAVE_FORMAT_RAW;
+	if (name == "rec")
+		return SAVE_FORMAT_RECORDING;
+	throw std::runtime_error("Invalid save format: " + name);
+}
+
+static const char* GetSaveFormatExtension(SaveFormat format)
+{
+	return format == SAVE_FORMAT_RAW ? ".raw" : ".png";
+}
+
+static IoBackend ParseIoBackend(const char* value)
+{
+	std::string name = value;
+	if (name == "pwrite")
+		return IO_BACKEND_PWRITE;
+	if (name == "uring")
+		return IO_BACKEND_URING;
+	throw std::runtime_error("Invalid I/O backend: " + name);
+}
+
+static LogLevel ParseLogLevel(const char* value)
+{
+	std::string name = value;
+	if (name == "error")
+		return LOG_ERROR;
+	if (name == "warn")
+		return LOG_WARN;
+	if (name == "info")
+		return LOG_INFO;
+	if (name == "debug")
+		return LOG_DEBUG;
+	throw std::runtime_error("Invalid log level: " + name);
+}
+
+static QueuePolicy ParseQueuePolicy(const char* value)
+{
+	std::string name = value;
+	if (name == "block")
+		return QUEUE_POLICY_BLOCK;
+	if (name == "drop-newest")
+		return QUEUE_POLICY_DROP_NEWEST;
+	if (name == "drop-oldest")
+		return QUEUE_POLICY_DROP_OLDEST;
+	if (name == "drop-nth")
+		return QUEUE_POLICY_DROP_NTH;
+	throw std::runtime_error("Invalid queue policy: " + name);
+}
+
+static void PrintUsage(const char* program)
+{
+	std::cout << "\nUsage: " << program << " <interface> [options]\n";
+	std::cout << "Example: " << program << " eno1 --save-workers 4\n";
+	std::cout << "Options:\n";
+	std::cout << TAB1 << "--cameras <list>     all | SERIAL[@GROUP][%INTERFACE][,...], one acquisition thread each\n";
+	std::cout << TAB1 << "--group <ip>         multicast group, base of the per-camera defaults (default " << MULTICAST_GROUP_IP << ")\n";
+	std::cout << TAB1 << "--ssm                join source-specific: only the selected camera's address is received\n";
+	std::cout << TAB1 << "--log-level <l>      error | warn | info | debug (default info)\n";
+	std::cout << TAB1 << "--log-rate <n>       max frame lines per second (default " << LOG_FRAME_LINES_PER_SEC << ")\n";
+	std::cout << TAB1 << "--stats-sec <n>      seconds between frame statistics lines (default " << STATS_INTERVAL_SEC << ", 0 = off)\n";
+	std::cout << TAB1 << "--stats-file <path>  also write frame statistics as JSON lines\n";
+	std::cout << TAB1 << "--save-frames <n>    frames saved after start (default " << NUM_SAVED_FRAMES << ")\n";
+	std::cout << TAB1 << "--pretrigger-frames <n>  keep the last n frames and save them on a trigger\n";
+	std::cout << TAB1 << "--pretrigger-ms <n>  also drop pre-trigger frames older than n ms\n";
+	std::cout << TAB1 << "--format <f>         png | raw | rec (default png)\n";
+	std::cout << TAB1 << "--png-threads <n>    encode each PNG on n threads (default " << PNG_ENCODER_THREADS << ", SDK writer)\n";
+	std::cout << TAB1 << "--segment-mb <n>     max recording segment size for rec (default " << RECORDING_SEGMENT_MB << ")\n";
+	std::cout << TAB1 << "--io-backend <b>     pwrite | uring, used by rec (default pwrite)\n";
+	std::cout << TAB1 << "--io-depth <n>       io_uring records in flight per worker (default " << IO_URING_DEPTH << ")\n";
+	std::cout << TAB1 << "--direct-io          write raw and rec output with O_DIRECT\n";
+	std::cout << TAB1 << "--fsync              fdatasync each png/raw file before it counts as saved\n";
+	std::cout << TAB1 << "--trace-file <path>  write per-stage save timings as Chrome trace JSON\n";
+	std::cout << TAB1 << "--save-workers <n>   number of save worker threads (default " << NUM_SAVE_WORKERS << ")\n";
+	std::cout << TAB1 << "--queue-jobs <n>     max queued or in-flight save jobs (default " << SAVE_QUEUE_MAX_JOBS << ")\n";
+	std::cout << TAB1 << "--queue-mb <n>       max MB held by save jobs (default " << SAVE_QUEUE_MAX_MB << ")\n";
+	std::cout << TAB1 << "--queue-policy <p>   block | drop-newest | drop-oldest | drop-nth (default block)\n";
+	std::cout << TAB1 << "--pool-slots <n>     pre-allocated frame slots (default " << FRAME_POOL_SLOTS << ")\n";
+	std::cout << TAB1 << "--hold-buffers <n>   let up to n save jobs per camera hold the SDK buffer instead of a copy\n";
+	std::cout << TAB1 << "--stream-buffers <n> stream buffers per camera (default SDK, or hold + " << STREAM_FREE_BUFFERS << ")\n";
+	std::cout << TAB1 << "--drop-nth <n>       N for the drop-nth policy (default " << SAVE_QUEUE_DROP_NTH << ")\n";
+	std::cout << TAB1 << "--acq-cpus <list>    pin acquisition threads: big | little | nic | e.g. 4-7\n";
+	std::cout << TAB1 << "--acq-fifo <prio>    SCHED_FIFO priority 1-99 for acquisition threads\n";
+	std::cout << TAB1 << "--save-cpus <list>   pin save workers (and their PNG threads): big | little | e.g. 0-3\n";
+	std::cout << TAB1 << "--save-nice <n>      nice value -20..19 for save workers\n";
+	std::cout << TAB1 << "--save-ioprio <p>    I/O priority for save workers: rt[:0-7] | be[:0-7] | idle\n";
+	std::cout << TAB1 << "--shm <name>         publish frames to a shared-memory ring for local readers\n";
+	std::cout << TAB1 << "--shm-slots <n>      frames kept in the shared-memory ring (default " << SHM_RING_SLOTS << ")\n";
+	std::cout << TAB1 << "--native-gvsp        listener only: receive the stream with recvmmsg instead of the SDK\n";
+	std::cout << TAB1 << "--gvsp-port <n>      UDP port of the stream for --native-gvsp (default GevSCPHostPort)\n";
+	std::cout << TAB1 << "--stage <spec>       add a processing stage before saving: crop=X,Y,W,H | stats (repeatable)\n";
+}
+
+// Return the value following option argv[i], advancing i.
+static const char* GetOptionValue(int argc, char** argv, int& i)
+{
+	if (i + 1 >= argc)
+		throw std::runtime_error(std::string("Missing value for option: ") + argv[i]);
+	return argv[++i];
+}
+
+// Parse a signed integer option value within [low, high].
+static int ParseInt(const char* option, const char* value, int low, int high)
+{
+	char* end = NULL;
+	errno = 0;
+	long number = std::strtol(value, &end, 10);
+	if (errno != 0 || end == value || *end != '\0' || number < low || number > high)
+		throw std::runtime_error(std::string("Invalid value for ") + option + ": " + value);
+	return static_cast<int>(number);
+}
+
+// Parse a positive integer option value.
+static size_t ParseCount(const char* option, const char* value)
+{
+	char* end = NULL;
+	errno = 0;
+	unsigned long long count = std::strtoull(value, &end, 10);
+	if (errno != 0 || end == value || *end != '\0' || count == 0 || value[0] == '-')
+		throw std::runtime_error(std::string("Invalid value for ") + option + ": " + value);
+	return static_cast<size_t>(count);
+}
+
+// Parse a non-negative integer option value, for options where 0 turns
+// the feature off.
+static size_t ParseOptionalCount(const char* option, const char* value)
+{
+	char* end = NULL;
+	errno = 0;
+	unsigned long long count = std::strtoull(value, &end, 10);
+	if (errno != 0 || end == value || *end != '\0' || value[0] == '-')
+		throw std::runtime_error(std::string("Invalid value for ") + option + ": " + value);
+	return static_cast<size_t>(count);
+}
+
+static Options ParseOptions(int argc, char** argv)
+{
+	Options options;
+	options.interfaceName = argv[1];
+	options.cameras = NULL;
+	options.acquisitionNicCpus = false;
+	options.group = MULTICAST_GROUP_IP;
+	options.sourceSpecific = false;
+	options.saveFormat = SAVE_FORMAT_PNG;
+	options.segmentBytes = static_cast<uint64_t>(RECORDING_SEGMENT_MB) << 20;
+	options.ioBackend = IO_BACKEND_PWRITE;
+	options.ioDepth = IO_URING_DEPTH;
+	options.directIo = false;
+	options.syncFiles = false;
+	options.traceFile = NULL;
+	options.pngThreads = PNG_ENCODER_THREADS;
+	options.logLevel = LOG_LEVEL;
+	options.logRate = LOG_FRAME_LINES_PER_SEC;
+	options.statsSec = STATS_INTERVAL_SEC;
+	options.statsFile = NULL;
+	options.saveFrames = NUM_SAVED_FRAMES;
+	options.preTriggerFrames = 0;
+	options.preTriggerMs = 0;
+	options.saveWorkers = NUM_SAVE_WORKERS;
+	options.queueLimits.maxJobs = SAVE_QUEUE_MAX_JOBS;
+	options.queueLimits.maxBytes = static_cast<uint64_t>(SAVE_QUEUE_MAX_MB) << 20;
+	options.queueLimits.policy = QUEUE_POLICY_BLOCK;
+	options.queueLimits.dropNth = SAVE_QUEUE_DROP_NTH;
+	options.poolSlots = FRAME_POOL_SLOTS;
+	options.holdBuffers = 0;
+	options.streamBuffers = 0;
+	options.acquisitionPlacement.fifoPriority = ACQUISITION_FIFO_PRIORITY;
+	options.savePlacement.setNice = (SAVE_WORKER_NICE != 0);
+	options.savePlacement.nice = SAVE_WORKER_NICE;
+	options.shmName = NULL;
+	options.shmSlots = SHM_RING_SLOTS;
+	options.nativeGvsp = false;
+	options.gvspPort = 0;
+
+	for (int i = 2; i < argc; ++i)
+	{
+		std::string option = argv[i];
+		if (option == "--cameras")
+			options.cameras = GetOptionValue(argc, argv, i);
+		else if (option == "--group")
+		{
+			options.group = GetOptionValue(argc, argv, i);
+			in_addr address;
+			if (inet_pton(AF_INET, options.group, &address) != 1 || !IN_MULTICAST(ntohl(address.s_addr)))
+				throw std::runtime_error(std::string("Invalid multicast group: ") + options.group);
+		}
+		else if (option == "--ssm")
+			options.sourceSpecific = true;
+		else if (option == "--format")
+			options.saveFormat = ParseSaveFormat(GetOptionValue(argc, argv, i));
+		else if (option == "--log-level")
+			options.logLevel = ParseLogLevel(GetOptionValue(argc, argv, i));
+		else if (option == "--log-rate")
+			options.logRate = static_cast<uint32_t>(ParseCount(argv[i], GetOptionValue(argc, argv, i)));
+		else if (option == "--stats-sec")
+			options.statsSec = ParseOptionalCount(argv[i], GetOptionValue(argc, argv, i));
+		else if (option == "--stats-file")
+			options.statsFile = GetOptionValue(argc, argv, i);
+		else if (option == "--save-frames")
+			options.saveFrames = ParseCount(argv[i], GetOptionValue(argc, argv, i));
+		else if (option == "--pretrigger-frames")
+			options.preTriggerFrames = ParseCount(argv[i], GetOptionValue(argc, argv, i));
+		else if (option == "--pretrigger-ms")
+			options.preTriggerMs = ParseCount(argv[i], GetOptionValue(argc, argv, i));
+		else if (option == "--png-threads")
+			options.pngThreads = ParseCount(argv[i], GetOptionValue(argc, argv, i));
+		else if (option == "--segment-mb")
+			options.segmentBytes = static_cast<uint64_t>(ParseCount(argv[i], GetOptionValue(argc, argv, i))) << 20;
+		else if (option == "--io-backend")
+			options.ioBackend = ParseIoBackend(GetOptionValue(argc, argv, i));
+		else if (option == "--io-depth")
+			options.ioDepth = static_cast<unsigned>(ParseCount(argv[i], GetOptionValue(argc, argv, i)));
+		else if (option == "--direct-io")
+			options.directIo = true;
+		else if (option == "--fsync")
+			options.syncFiles = true;
+		else if (option == "--trace-file")
+			options.traceFile = GetOptionValue(argc, argv, i);
+		else if (option == "--save-workers")
+			options.saveWorkers = ParseCount(argv[i], GetOptionValue(argc, argv, i));
+		else if (option == "--queue-jobs")
+			options.queueLimits.maxJobs = ParseCount(argv[i], GetOptionValue(argc, argv, i));
+		else if (option == "--queue-mb")
+			options.queueLimits.maxBytes = static_cast<uint64_t>(ParseCount(argv[i], GetOptionValue(argc, argv, i))) << 20;
+		else if (option == "--queue-policy")
+			options.queueLimits.policy = ParseQueuePolicy(GetOptionValue(argc, argv, i));
+		else if (option == "--pool-slots")
+			options.poolSlots = ParseCount(argv[i], GetOptionValue(argc, argv, i));
+		else if (option == "--hold-buffers")
+			options.holdBuffers = ParseCount(argv[i], GetOptionValue(argc, argv, i));
+		else if (option == "--stream-buffers")
+			options.streamBuffers = ParseCount(argv[i], GetOptionValue(argc, argv, i));
+		else if (option == "--drop-nth")
+			options.queueLimits.dropNth = ParseCount(argv[i], GetOptionValue(argc, argv, i));
+		else if (option == "--acq-cpus")
+		{
+			std::string cpus = GetOptionValue(argc, argv, i);
+			options.acquisitionNicCpus = (cpus == "nic");
+			if (!options.acquisitionNicCpus)
+				options.acquisitionPlacement.cpus = ParseCpuList(cpus);
+		}
+		else if (option == "--acq-fifo")
+			options.acquisitionPlacement.fifoPriority = ParseInt(argv[i], GetOptionValue(argc, argv, i), 1, 99);
+		else if (option == "--save-cpus")
+			options.savePlacement.cpus = ParseCpuList(GetOptionValue(argc, argv, i));
+		else if (option == "--save-nice")
+		{
+			options.savePlacement.setNice = true;
+			options.savePlacement.nice = ParseInt(argv[i], GetOptionValue(argc, argv, i), -20, 19);
+		}
+		else if (option == "--save-ioprio")
+			ParseIoPriority(GetOptionValue(argc, argv, i), options.savePlacement);
+		else if (option == "--shm")
+			options.shmName = GetOptionValue(argc, argv, i);
+		else if (option == "--shm-slots")
+			options.shmSlots = ParseCount(argv[i], GetOptionValue(argc, argv, i));
+		else if (option == "--native-gvsp")
+			options.nativeGvsp = true;
+		else if (option == "--gvsp-port")
+			options.gvspPort = static_cast<uint16_t>(ParseInt(argv[i], GetOptionValue(argc, argv, i), 1, 65535));
+		else if (option == "--stage")
+		{
+			// validated now; every camera creates its own instances later
+			const char* spec = GetOptionValue(argc, argv, i);
+			std::unique_ptr<PipelineStage> stage(CreatePipelineStage(spec));
+			options.stages.push_back(spec);
+		}
+		else
+			throw std::runtime_error("Unknown option: " + option);
+	}
+
+	if (options.holdBuffers > 0 && options.streamBuffers == 0)
+		options.streamBuffers = options.holdBuffers + STREAM_FREE_BUFFERS;
+	if (options.holdBuffers > 0 && options.streamBuffers <= options.holdBuffers)
+		throw std::runtime_error("--stream-buffers must be larger than --hold-buffers");
+	if (options.nativeGvsp && (options.holdBuffers > 0 || options.streamBuffers > 0))
+		throw std::runtime_error("--hold-buffers and --stream-buffers do not apply to --native-gvsp");
+
+	return options;
+}
+
 // =-=-=-=-=-=-=-=-=-=-=-=-=-
 // =- OUTPUT DIRECTORY HELPER
 // =-=-=-=-=-=-=-=-=-=-=-=-=-
@@ -155,423 +730,2855 @@ static std::string CreateOutputDir()
 
 struct SaveJob
 {
-	// Image copy to be saved and destroyed by the worker.
+	// Frame to be saved, held in a pool slot (returned by the worker), in the
+	// SDK buffer itself (heldBuffer; returned for requeueing) or, when the
+	// pool is exhausted, in an image copy destroyed by the worker.
+	FrameSlot* pSlot;
 	Arena::IImage* pImage;
+	bool heldBuffer;
+	// Output of the camera's --stage pipeline when it replaced the pixels;
+	// points into the worker's thread-local frame, so it is saved before the
+	// worker takes another job.
+	const FrameSlot* pProcessed;
 	std::string filename;
+	// Bytes reserved against the queue limits for this job.
+	uint64_t bytes;
+	// Position in the camera's queue order, for ordered pipeline stages.
+	uint64_t sequence;
+	// Stage timestamps from GetImage to the end of the write.
+	JobTrace trace;
+};
+
+struct SaveQueueStats
+{
+	// Admission counters, written only by the acquisition thread.
+	uint64_t enqueued;
+	uint64_t droppedNewest;
+	uint64_t droppedOldest;
+	uint64_t droppedNth;
+	uint64_t blockedCount;
+	uint64_t blockedNs;
+	size_t peakJobs;
+	uint64_t peakBytes;
+};
+
+struct FrameCopyStats
+{
+	// How saved frames left the SDK buffer, written only by the acquisition thread.
+	uint64_t held;        // job kept the SDK buffer (no copy)
+	uint64_t slotCopies;  // copied into a frame pool slot
+	uint64_t imageCopies; // copied with ImageFactory::Copy
+	size_t peakHeld;
 };
 
 struct SaveQueue
 {
-	// Single-producer/single-consumer queue for disk writes.
-	std::deque<SaveJob> jobs;
-	std::mutex mutex;
-	std::condition_variable cv;
-	bool stop;
+	// Single-producer/multi-consumer bounded queue for disk writes, one per
+	// camera. The acquisition thread never takes a lock: jobs go through a
+	// lock-free ring and workers are only woken through the futex when they
+	// are parked.
+	BoundedRing<SaveJob> jobs;
+	// Signalled when a job is pushed; shared by all queues of a worker pool,
+	// whose workers park on it when idle.
+	FutexEvent* workEvent;
+	// Signalled when a job completes; the producer parks on it under the block policy.
+	FutexEvent spaceEvent;
+	// SDK buffers of finished held jobs, requeued by the acquisition thread.
+	// Sized for the hold limit, so a push never fails.
+	BoundedRing<Arena::IImage*> releasedBuffers;
+
+	SaveQueueLimits limits;
+	FramePool* framePool;
+	// Jobs and bytes reserved by queued or in-flight jobs. Only the producer
+	// increments them, so a reservation can never overshoot the limits.
+	std::atomic<size_t> pendingJobs;
+	std::atomic<uint64_t> pendingBytes;
+	uint64_t nthCounter;
+	// Stages run on every job before it is saved, or NULL. Every job pushed
+	// is either run through it or skipped, so ordered stages never stall.
+	FramePipeline* pipeline;
+	// sequence of the next job pushed, written only by the producer
+	uint64_t nextSequence;
+	SaveQueueStats stats;
+	// Jobs of this queue finished by any worker.
+	std::atomic<uint64_t> savedCount;
+	std::atomic<uint64_t> failedCount;
+	std::atomic<uint64_t> savedBytes;
+	// jobs a pipeline stage dropped instead of saving
+	std::atomic<uint64_t> filteredCount;
+
+	SaveQueue(const SaveQueueLimits& queueLimits, FramePool* pool, FutexEvent* event, size_t holdBuffers)
+		: jobs(queueLimits.maxJobs)
+		, workEvent(event)
+		, releasedBuffers(holdBuffers)
+		, limits(queueLimits)
+		, framePool(pool)
+		, pendingJobs(0)
+		, pendingBytes(0)
+		, nthCounter(0)
+		, pipeline(NULL)
+		, nextSequence(0)
+		, savedCount(0)
+		, failedCount(0)
+		, savedBytes(0)
+		, filteredCount(0)
+	{
+		std::memset(&stats, 0, sizeof(stats));
+	}
+};
+
+struct SaveWorkerStats
+{
+	// Per-worker throughput counters, written only by the owning worker.
+	std::atomic<uint64_t> savedCount;
+	std::atomic<uint64_t> failedCount;
+	std::atomic<uint64_t> savedBytes;
+	std::atomic<uint64_t> busyNs;
+	// time from dequeue to completion of each job; read after the worker exits
+	LatencyHistogram latency;
+	// per-stage latency of saved jobs; read after the worker exits
+	StageHistograms stages;
+	// thread ID of the worker in the trace file
+	uint32_t traceTid;
+
+	SaveWorkerStats()
+		: savedCount(0)
+		, failedCount(0)
+		, savedBytes(0)
+		, busyNs(0)
+		, traceTid(0)
+	{
+	}
 };
 
 void SaveImage(Arena::IImage* pImage, const char* filename);
+void SaveSlot(const FrameSlot* pSlot, const char* filename);
+void SaveRaw(const RawFrameHeader& header, const uint8_t* pData, const char* filename, bool directIo);
+void SavePngStriped(Arena::IImage* pImage, const FrameSlot* pSlot, const char* filename, size_t threads);
 
-static void SaveWorker(SaveQueue* queue)
+// Free the frame held by a job.
+static void DestroyJobFrame(SaveQueue* queue, SaveJob& job)
 {
-	// Drain save jobs on a background thread to avoid blocking acquisition.
-	for (;;)
+	if (job.pSlot)
+		queue->framePool->Release(job.pSlot);
+	else if (job.heldBuffer)
+		queue->releasedBuffers.TryPush(job.pImage);
+	else
+		Arena::ImageFactory::Destroy(job.pImage);
+}
+
+// Check whether a job of the given size fits in the queue limits. A single job
+// is always admitted into an otherwise empty queue.
+static bool HasSaveRoom(const SaveQueue* queue, uint64_t bytes)
+{
+	size_t pendingJobs = queue->pendingJobs.load(std::memory_order_acquire);
+	if (pendingJobs == 0)
+		return true;
+
+	return pendingJobs < queue->limits.maxJobs && queue->pendingBytes.load(std::memory_order_acquire) + bytes <= queue->limits.maxBytes;
+}
+
+static void ReleaseSave(SaveQueue* queue, uint64_t bytes)
+{
+	// Return a finished job's reservation and wake a blocked producer.
+	queue->pendingBytes.fetch_sub(bytes, std::memory_order_release);
+	queue->pendingJobs.fetch_sub(1, std::memory_order_release);
+	queue->spaceEvent.NotifyOne();
+}
+
+struct SaveOutput
+{
+	// Where save workers write frames.
+	SaveFormat format;
+	// Shared segment writer, SAVE_FORMAT_RECORDING only.
+	RecordingWriter* pRecording;
+	// io_uring backend for recordings; pool slots are registered as fixed buffers.
+	bool useUring;
+	unsigned uringDepth;
+	FramePool* pFramePool;
+	// O_DIRECT for raw files (recordings carry their own flag).
+	bool directIo;
+	// Striped PNG encoder threads per frame; 0 uses Save::ImageWriter.
+	size_t pngThreads;
+	// fdatasync each png/raw file before the job counts as saved.
+	bool syncFiles;
+	// Chrome trace of finished jobs, or NULL.
+	TraceFile* pTraceFile;
+};
+
+struct SaveLane
+{
+	// One camera's queue and where its frames are written.
+	SaveQueue* queue;
+	const SaveOutput* output;
+};
+
+struct SaveWorkerPool
+{
+	// Save worker threads shared by every camera. Workers take jobs from the
+	// lanes in turn, so backlogged cameras get an equal share of them.
+	std::vector<SaveLane> lanes;
+	// Signalled when a job is pushed to any lane; idle workers park on it.
+	FutexEvent workEvent;
+	std::atomic<bool> stop;
+	// lane the next pop starts from
+	std::atomic<size_t> nextLane;
+	std::vector<std::thread> threads;
+	std::vector<SaveWorkerStats> stats;
+	std::chrono::steady_clock::time_point startTime;
+	// CPUs, nice and I/O priority applied by each worker when it starts
+	ThreadPlacement placement;
+
+	SaveWorkerPool()
+		: stop(false)
+		, nextLane(0)
 	{
-		SaveJob job;
-		{
-			std::unique_lock<std::mutex> lock(queue->mutex);
-			queue->cv.wait(lock, [&]() { return queue->stop || !queue->jobs.empty(); });
-			if (queue->stop && queue->jobs.empty())
-				break;
+	}
+};
 
-			job = queue->jobs.front();
-			queue->jobs.pop_front();
-		}
+// Pop a job from the first non-empty lane, starting one lane further on for
+// each pop. Returns the lane index, or -1 if every queue is empty.
+static int TryPopSaveJob(SaveWorkerPool* pool, SaveJob& job)
+{
+	size_t count = pool->lanes.size();
+	size_t start = count > 1 ? pool->nextLane.fetch_add(1, std::memory_order_relaxed) : 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		size_t lane = (start + i) % count;
+		if (pool->lanes[lane].queue->jobs.TryPop(job))
+			return static_cast<int>(lane);
+	}
+	return -1;
+}
 
-		try
-		{
-			SaveImage(job.pImage, job.filename.c_str());
-		}
-		catch (GenICam::GenericException& ge)
-		{
-			std::cout << "\nGenICam exception thrown while saving: " << ge.what() << "\n";
-		}
-		catch (std::exception& ex)
+// Pop the next job, parking on the work event while all queues are empty.
+// Returns the job's lane, or -1 once the pool is stopped and fully drained.
+static int WaitForSaveJob(SaveWorkerPool* pool, SaveJob& job)
+{
+	for (;;)
+	{
+		int lane = TryPopSaveJob(pool, job);
+		if (lane >= 0)
+			return lane;
+
+		uint32_t epoch = pool->workEvent.PrepareWait();
+		// read stop before re-checking so jobs pushed ahead of stop are seen
+		bool stopping = pool->stop.load(std::memory_order_acquire);
+		lane = TryPopSaveJob(pool, job);
+		if (lane >= 0)
 		{
-			std::cout << "\nStandard exception thrown while saving: " << ex.what() << "\n";
+			pool->workEvent.CancelWait();
+			return lane;
 		}
-		catch (...)
+		if (stopping)
 		{
-			std::cout << "\nUnexpected exception thrown while saving\n";
+			pool->workEvent.CancelWait();
+			return -1;
 		}
-
-		Arena::ImageFactory::Destroy(job.pImage);
+		pool->workEvent.Wait(epoch);
 	}
 }
 
-static void EnqueueSave(SaveQueue* queue, SaveJob job)
+// Build the raw header for a job's frame and return its pixel data.
+static const uint8_t* GetRawFrame(const SaveJob& job, RawFrameHeader& header)
 {
+	if (job.pProcessed || job.pSlot)
 	{
-		std::lock_guard<std::mutex> lock(queue->mutex);
-		queue->jobs.push_back(job);
+		const FrameSlot* pSlot = job.pProcessed ? job.pProcessed : job.pSlot;
+		header = MakeRawFrameHeader(pSlot->width, pSlot->height, pSlot->bitsPerPixel, pSlot->pixelFormat,
+			pSlot->frameId, pSlot->timestampNs, pSlot->size);
+		return pSlot->data;
 	}
-	queue->cv.notify_one();
+
+	Arena::IImage* pImage = job.pImage;
+	header = MakeRawFrameHeader(pImage->GetWidth(), pImage->GetHeight(), pImage->GetBitsPerPixel(), pImage->GetPixelFormat(),
+		pImage->GetFrameId(), pImage->GetTimestampNs(), pImage->GetSizeFilled());
+	return pImage->GetData();
 }
 
-static void StopSaveWorker(SaveQueue* queue, std::thread& worker)
+// Run a job's frame through its camera's pipeline. Returns false if a stage
+// dropped the frame. When a stage replaced the pixels, job.pProcessed points
+// at the result until the worker's next call. Throws if a stage fails.
+static bool RunJobPipeline(SaveQueue* queue, SaveJob& job)
 {
-	// Signal the worker to flush and exit.
+	if (!queue->pipeline)
+		return true;
+
+	// one frame per worker so stage output buffers are reused
+	static thread_local PipelineFrame frame;
+	static thread_local FrameSlot processed;
+
+	if (job.pSlot)
 	{
-		std::lock_guard<std::mutex> lock(queue->mutex);
-		queue->stop = true;
+		const FrameSlot* pSlot = job.pSlot;
+		frame.Reset(pSlot->data, pSlot->size, pSlot->width, pSlot->height, pSlot->bitsPerPixel, pSlot->pixelFormat, pSlot->frameId, pSlot->timestampNs);
+	}
+	else
+	{
+		Arena::IImage* pImage = job.pImage;
+		frame.Reset(pImage->GetData(), pImage->GetSizeFilled(), pImage->GetWidth(), pImage->GetHeight(), pImage->GetBitsPerPixel(),
+			pImage->GetPixelFormat(), pImage->GetFrameId(), pImage->GetTimestampNs());
 	}
-	queue->cv.notify_all();
-	if (worker.joinable())
-		worker.join();
-}
 
-struct SaveWorkerGuard
-{
-	SaveQueue* queue;
-	std::thread* worker;
-	~SaveWorkerGuard()
+	bool keep = queue->pipeline->Run(frame, job.sequence);
+	job.trace.Mark(TRACE_PROCESSED);
+	if (keep && frame.Transformed())
 	{
-		// Ensure pending saves are flushed before returning.
-		if (worker && worker->joinable())
-			StopSaveWorker(queue, *worker);
+		std::memset(&processed, 0, sizeof(processed));
+		processed.data = const_cast<uint8_t*>(frame.data);
+		processed.capacity = frame.size;
+		processed.size = frame.size;
+		processed.width = frame.width;
+		processed.height = frame.height;
+		processed.bitsPerPixel = frame.bitsPerPixel;
+		processed.pixelFormat = frame.pixelFormat;
+		processed.frameId = frame.frameId;
+		processed.timestampNs = frame.timestampNs;
+		job.pProcessed = &processed;
 	}
-};
+	return keep;
+}
 
-struct TerminalSettings
+// Flush a written file's data to stable storage.
+static void SyncFile(const std::string& filename)
 {
-	// Terminal state for non-blocking ESC detection.
-	bool enabled;
-	termios originalTermios;
-	int originalFlags;
-};
+	int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		throw std::runtime_error("Failed to open " + filename + " for fdatasync: " + std::strerror(errno));
+	int error = fdatasync(fd) == 0 ? 0 : errno;
+	close(fd);
+	if (error != 0)
+		throw std::runtime_error("Failed to fdatasync " + filename + ": " + std::strerror(error));
+}
 
-static TerminalSettings SetupTerminalForEsc()
+// Write a job's frame in the configured format. The save functions stamp
+// conversion and encoding on the job's trace; the write and sync stages are
+// stamped here.
+static void SaveJobFrame(SaveJob& job, const SaveOutput* output)
 {
-	// Put stdin into non-canonical, non-echo, non-blocking mode.
-	TerminalSettings settings = {};
-	settings.enabled = false;
-	settings.originalFlags = -1;
-
-	if (!isatty(STDIN_FILENO))
-		return settings;
+	JobTraceScope traceScope(&job.trace);
+	RawFrameHeader header;
+	switch (output->format)
+	{
+	case SAVE_FORMAT_RAW:
+	{
+		const uint8_t* pData = GetRawFrame(job, header);
+		SaveRaw(header, pData, job.filename.c_str(), output->directIo);
+		break;
+	}
 
-	if (tcgetattr(STDIN_FILENO, &settings.originalTermios) != 0)
-		return settings;
+	case SAVE_FORMAT_RECORDING:
+	{
+		const uint8_t* pData = GetRawFrame(job, header);
+		output->pRecording->Append(header, pData);
+		break;
+	}
 
-	termios raw = settings.originalTermios;
-	raw.c_lflag &= ~(ICANON | ECHO);
-	raw.c_cc[VMIN] = 0;
-	raw.c_cc[VTIME] = 0;
-	if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) != 0)
-		return settings;
+	case SAVE_FORMAT_PNG:
+	{
+		const FrameSlot* pSlot = job.pProcessed ? job.pProcessed : job.pSlot;
+		if (output->pngThreads > 0)
+			SavePngStriped(job.pImage, pSlot, job.filename.c_str(), output->pngThreads);
+		else if (pSlot)
+			SaveSlot(pSlot, job.filename.c_str());
+		else
+			SaveImage(job.pImage, job.filename.c_str());
+		break;
+	}
+	}
+	job.trace.Mark(TRACE_WRITTEN);
 
-	settings.originalFlags = fcntl(STDIN_FILENO, F_GETFL, 0);
-	if (settings.originalFlags != -1)
-		fcntl(STDIN_FILENO, F_SETFL, settings.originalFlags | O_NONBLOCK);
+	// recordings are only synced when a segment is closed
+	if (output->syncFiles && output->format != SAVE_FORMAT_RECORDING)
+	{
+		SyncFile(job.filename);
+		job.trace.Mark(TRACE_SYNCED);
+	}
+}
 
-	settings.enabled = true;
-	return settings;
+// Return the frame and reservation of a job a pipeline stage dropped.
+static void FinishFilteredJob(SaveQueue* queue, SaveJob& job)
+{
+	queue->filteredCount.fetch_add(1, std::memory_order_relaxed);
+	DestroyJobFrame(queue, job);
+	ReleaseSave(queue, job.bytes);
 }
 
-static void RestoreTerminal(const TerminalSettings& settings)
+// Account for a finished job and return its frame and reservation.
+static void FinishSaveJob(SaveQueue* queue, SaveWorkerStats* stats, const SaveOutput* output, SaveJob& job, bool saved, bool overlappedWrites)
 {
-	// Restore terminal settings if they were changed.
-	if (!settings.enabled)
-		return;
+	if (saved)
+	{
+		stats->savedCount.fetch_add(1, std::memory_order_relaxed);
+		stats->savedBytes.fetch_add(job.bytes, std::memory_order_relaxed);
+		stats->stages.Record(job.trace);
+		queue->savedCount.fetch_add(1, std::memory_order_relaxed);
+		queue->savedBytes.fetch_add(job.bytes, std::memory_order_relaxed);
+		if (output->pTraceFile)
+			output->pTraceFile->WriteJob(job.trace, stats->traceTid, overlappedWrites);
+	}
+	else
+	{
+		stats->failedCount.fetch_add(1, std::memory_order_relaxed);
+		queue->failedCount.fetch_add(1, std::memory_order_relaxed);
+	}
 
-	tcsetattr(STDIN_FILENO, TCSANOW, &settings.originalTermios);
-	if (settings.originalFlags != -1)
-		fcntl(STDIN_FILENO, F_SETFL, settings.originalFlags);
+	DestroyJobFrame(queue, job);
+	ReleaseSave(queue, job.bytes);
 }
 
-struct TerminalGuard
+static void RunBlockingSaveWorker(SaveWorkerPool* pool, SaveWorkerStats* stats)
 {
-	// RAII restore for terminal settings.
-	TerminalSettings settings;
-	~TerminalGuard()
+	// Drain save jobs on a background thread to avoid blocking acquisition.
+	SaveJob job;
+	int lane;
+	while ((lane = WaitForSaveJob(pool, job)) >= 0)
 	{
-		RestoreTerminal(settings);
+		SaveQueue* queue = pool->lanes[lane].queue;
+		const SaveOutput* output = pool->lanes[lane].output;
+		job.trace.Mark(TRACE_DEQUEUED);
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		bool saved = false;
+		bool filtered = false;
+		try
+		{
+			filtered = !RunJobPipeline(queue, job);
+			if (!filtered)
+			{
+				SaveJobFrame(job, output);
+				saved = true;
+			}
+		}
+		catch (GenICam::GenericException& ge)
+		{
+			AsyncLog::Instance().WriteWithText(LOG_ERROR, 0, ge.what(), "\nGenICam exception thrown while saving: %t\n");
+		}
+		catch (std::exception& ex)
+		{
+			AsyncLog::Instance().WriteWithText(LOG_ERROR, 0, ex.what(), "\nStandard exception thrown while saving: %t\n");
+		}
+		catch (...)
+		{
+			LogMessage(LOG_ERROR, "\nUnexpected exception thrown while saving\n");
+		}
+		std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - begin;
+
+		stats->busyNs.fetch_add(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+		if (filtered)
+		{
+			FinishFilteredJob(queue, job);
+			continue;
+		}
+		stats->latency.Record(static_cast<uint64_t>(elapsed.count()));
+		FinishSaveJob(queue, stats, output, job, saved, false);
 	}
-};
+}
 
-static bool CheckForEsc(const TerminalSettings& settings)
+struct UringSaveContext
 {
-	// Consume all pending input; return true if ESC (27) is seen.
-	if (!settings.enabled)
-		return false;
+	// Jobs owned by one io_uring save worker while their writes are in flight.
+	SaveQueue* queue;
+	SaveWorkerStats* stats;
+	const SaveOutput* output;
+	std::vector<SaveJob> jobs;
+	std::vector<std::chrono::steady_clock::time_point> submitTimes;
+	std::vector<size_t> freeJobs;
+};
 
-	char ch = 0;
-	ssize_t bytesRead = read(STDIN_FILENO, &ch, 1);
-	while (bytesRead > 0)
-	{
-		if (ch == 27)
-			return true;
-		bytesRead = read(STDIN_FILENO, &ch, 1);
-	}
-	return false;
+static void OnUringRecordComplete(void* cookie, int error, void* context)
+{
+	UringSaveContext* uringContext = static_cast<UringSaveContext*>(context);
+	size_t index = reinterpret_cast<uintptr_t>(cookie);
+	SaveJob& job = uringContext->jobs[index];
+
+	if (error != 0)
+		AsyncLog::Instance().WriteWithText(LOG_ERROR, 0, std::strerror(error), "\nStandard exception thrown while saving: io_uring write failed: %t\n");
+
+	job.trace.Mark(TRACE_WRITTEN);
+	std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - uringContext->submitTimes[index];
+	uringContext->stats->latency.Record(static_cast<uint64_t>(elapsed.count()));
+	FinishSaveJob(uringContext->queue, uringContext->stats, uringContext->output, job, error == 0, true);
+	job = SaveJob();
+	uringContext->freeJobs.push_back(index);
 }
 
-struct MulticastGuard
+static void SubmitUringSaveJob(UringRecorder& recorder, UringSaveContext& context, SaveJob& job, const SaveOutput* output)
 {
-	int socketFd;
-	ip_mreqn request;
-	bool joined;
+	job.trace.Mark(TRACE_DEQUEUED);
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
 
-	MulticastGuard()
-		: socketFd(-1)
-		, joined(false)
+	bool keep = false;
+	try
 	{
-		std::memset(&request, 0, sizeof(request));
+		keep = RunJobPipeline(context.queue, job);
 	}
-
-	~MulticastGuard()
+	catch (std::exception& ex)
 	{
-		if (joined)
-			setsockopt(socketFd, IPPROTO_IP, IP_DROP_MEMBERSHIP, &request, sizeof(request));
-		if (socketFd != -1)
-			close(socketFd);
+		AsyncLog::Instance().WriteWithText(LOG_ERROR, 0, ex.what(), "\nStandard exception thrown while saving: %t\n");
+		FinishSaveJob(context.queue, context.stats, output, job, false, false);
+		return;
+	}
+	if (!keep)
+	{
+		FinishFilteredJob(context.queue, job);
+		return;
 	}
 
-	void Join(const char* interfaceName)
+	// O_DIRECT needs aligned memory; frames copied outside the pool are
+	// written synchronously through the bounce buffer instead. So are
+	// processed frames, whose worker-local buffer is reused by the next job.
+	if (job.pProcessed || (!job.pSlot && output->pRecording->IsDirect()))
 	{
-		socketFd = socket(AF_INET, SOCK_DGRAM, 0);
-		if (socketFd < 0)
-			throw std::runtime_error(std::string("Failed to create socket: ") + std::strerror(errno));
+		bool saved = false;
+		try
+		{
+			SaveJobFrame(job, output);
+			saved = true;
+		}
+		catch (std::exception& ex)
+		{
+			AsyncLog::Instance().WriteWithText(LOG_ERROR, 0, ex.what(), "\nStandard exception thrown while saving: %t\n");
+		}
+		std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - begin;
+		context.stats->busyNs.fetch_add(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+		context.stats->latency.Record(static_cast<uint64_t>(elapsed.count()));
+		FinishSaveJob(context.queue, context.stats, output, job, saved, false);
+		return;
+	}
 
-		unsigned int ifIndex = if_nametoindex(interfaceName);
-		if (ifIndex == 0)
-			throw std::runtime_error(std::string("Invalid interface name: ") + interfaceName);
+	size_t index = context.freeJobs.back();
+	context.freeJobs.pop_back();
+	context.jobs[index] = job;
+	context.submitTimes[index] = begin;
 
-		if (inet_pton(AF_INET, MULTICAST_GROUP_IP, &request.imr_multiaddr) != 1)
-			throw std::runtime_error("Invalid multicast group IP");
+	try
+	{
+		RawFrameHeader header;
+		const uint8_t* pData = GetRawFrame(job, header);
+		recorder.Submit(header, pData, job.pSlot, reinterpret_cast<void*>(static_cast<uintptr_t>(index)));
+	}
+	catch (std::exception& ex)
+	{
+		AsyncLog::Instance().WriteWithText(LOG_ERROR, 0, ex.what(), "\nStandard exception thrown while saving: %t\n");
+		FinishSaveJob(context.queue, context.stats, output, context.jobs[index], false, true);
+		context.freeJobs.push_back(index);
+	}
 
-		request.imr_ifindex = static_cast<int>(ifIndex);
-		request.imr_address.s_addr = htonl(INADDR_ANY);
+	std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - begin;
+	context.stats->busyNs.fetch_add(static_cast<uint64_t>(elapsed.count()), std::memory_order_relaxed);
+}
 
-		if (setsockopt(socketFd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) != 0)
-			throw std::runtime_error(std::string("Failed to join multicast group: ") + std::strerror(errno));
+static void RunUringSaveWorker(SaveWorkerPool* pool, SaveWorkerStats* stats)
+{
+	// Keep up to uringDepth records in flight per camera: submit whatever is
+	// queued, and only block on completions when a camera's ring is full or
+	// every queue is empty.
+	size_t laneCount = pool->lanes.size();
+	std::vector<std::unique_ptr<UringRecorder> > recorders(laneCount);
+	std::vector<UringSaveContext> contexts(laneCount);
+	for (size_t i = 0; i < laneCount; i++)
+	{
+		const SaveOutput* output = pool->lanes[i].output;
+		recorders[i].reset(new UringRecorder(output->pRecording, output->uringDepth));
+		int error = recorders[i]->Init(output->pFramePool);
+		if (error != 0)
+		{
+			AsyncLog::Instance().WriteWithText(LOG_WARN, 0, std::strerror(error), TAB2 "io_uring unavailable (%t), save worker falls back to pwrite\n");
+			recorders.clear();
+			RunBlockingSaveWorker(pool, stats);
+			return;
+		}
 
-		joined = true;
+		UringSaveContext& context = contexts[i];
+		context.queue = pool->lanes[i].queue;
+		context.stats = stats;
+		context.output = output;
+		context.jobs.resize(recorders[i]->Depth());
+		context.submitTimes.resize(recorders[i]->Depth());
+		for (size_t j = recorders[i]->Depth(); j > 0; j--)
+			context.freeJobs.push_back(j - 1);
 	}
-};
 
-// =-=-=-=-=-=-=-=-=-
-// =-=- EXAMPLE -=-=-
-// =-=-=-=-=-=-=-=-=- 
-// (1) enable multicast
-// (2) prepare settings on master, not on listener
-// (3) stream regularly
+	SaveJob job;
+	for (;;)
+	{
+		unsigned inFlight = 0;
+		for (size_t i = 0; i < laneCount; i++)
+		{
+			recorders[i]->Reap(false, OnUringRecordComplete, &contexts[i]);
+			inFlight += recorders[i]->InFlight();
+		}
 
-// demonstrates saving an image
-// (1) converts image to a displayable pixel format
-// (2) prepares image parameters
-// (3) prepares image writer
-// (4) saves image
+		int lane = TryPopSaveJob(pool, job);
+		if (lane < 0 && inFlight > 0)
+		{
+			// nothing queued: wait for a write of the first camera with any in flight
+			for (size_t i = 0; i < laneCount; i++)
+			{
+				if (recorders[i]->InFlight() > 0)
+				{
+					recorders[i]->Reap(true, OnUringRecordComplete, &contexts[i]);
+					break;
+				}
+			}
+			continue;
+		}
+
+		if (lane < 0)
+			lane = WaitForSaveJob(pool, job);
+		if (lane < 0)
+			break;
+
+		UringRecorder& recorder = *recorders[lane];
+		if (recorder.InFlight() == recorder.Depth())
+			recorder.Reap(true, OnUringRecordComplete, &contexts[lane]);
+		SubmitUringSaveJob(recorder, contexts[lane], job, pool->lanes[lane].output);
+	}
+}
+
+// Apply a thread's placement and log where it actually runs.
+static void PlaceThread(const ThreadPlacement& placement, const std::string& name)
+{
+	AsyncLog& log = AsyncLog::Instance();
+	std::string failed = ApplyThreadPlacement(placement);
+	if (!failed.empty())
+		log.WriteWithTexts(LOG_WARN, 0, name.c_str(), failed.c_str(), TAB1 "%t: could not set %t\n");
+	std::string placed = name + ": " + DescribeThreadPlacement();
+	log.WriteWithText(LOG_INFO, 0, placed.c_str(), TAB1 "%t\n");
+}
+
+static void SaveWorker(SaveWorkerPool* pool, SaveWorkerStats* stats, size_t index)
+{
+	// threads the PNG encoder starts later inherit the placement
+	PlaceThread(pool->placement, "Save worker " + std::to_string(index));
+
+	// every camera shares the output settings
+	const SaveOutput* output = pool->lanes[0].output;
+	if (output->format == SAVE_FORMAT_RECORDING && output->useUring)
+		RunUringSaveWorker(pool, stats);
+	else
+		RunBlockingSaveWorker(pool, stats);
+}
+
+// Block the acquisition thread until a job of the given size fits.
+static void WaitForSaveRoom(SaveQueue* queue, uint64_t bytes)
+{
+	if (HasSaveRoom(queue, bytes))
+		return;
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	for (;;)
+	{
+		uint32_t epoch = queue->spaceEvent.PrepareWait();
+		if (HasSaveRoom(queue, bytes))
+		{
+			queue->spaceEvent.CancelWait();
+			break;
+		}
+		queue->spaceEvent.Wait(epoch);
+	}
+	std::chrono::nanoseconds waited = std::chrono::steady_clock::now() - begin;
+	queue->stats.blockedCount++;
+	queue->stats.blockedNs += static_cast<uint64_t>(waited.count());
+}
+
+// Account for an admitted job.
+static void AdmitSave(SaveQueue* queue, uint64_t bytes)
+{
+	size_t pendingJobs = queue->pendingJobs.fetch_add(1, std::memory_order_acq_rel) + 1;
+	uint64_t pendingBytes = queue->pendingBytes.fetch_add(bytes, std::memory_order_acq_rel) + bytes;
+	queue->stats.enqueued++;
+	if (pendingJobs > queue->stats.peakJobs)
+		queue->stats.peakJobs = pendingJobs;
+	if (pendingBytes > queue->stats.peakBytes)
+		queue->stats.peakBytes = pendingBytes;
+}
+
+// Reserve room for a job of the given size, applying the queue policy.
+// Returns SAVE_ADMITTED, or why the frame must be dropped. Must be called
+// before copying the image so dropped frames cost no allocation.
+static SaveAdmission ReserveSave(SaveQueue* queue, uint64_t bytes)
+{
+	const SaveQueueLimits& limits = queue->limits;
+	bool admitted = false;
+	bool thinned = false;
+
+	switch (limits.policy)
+	{
+	case QUEUE_POLICY_BLOCK:
+		WaitForSaveRoom(queue, bytes);
+		admitted = true;
+		break;
+
+	case QUEUE_POLICY_DROP_OLDEST:
+	{
+		// only jobs that have not started saving can be evicted; the ring's pop
+		// side is multi-consumer so the producer can take them directly
+		SaveJob oldest;
+		while (!HasSaveRoom(queue, bytes) && queue->jobs.TryPop(oldest))
+		{
+			if (queue->pipeline)
+				queue->pipeline->Skip(oldest.sequence);
+			DestroyJobFrame(queue, oldest);
+			queue->pendingBytes.fetch_sub(oldest.bytes, std::memory_order_release);
+			queue->pendingJobs.fetch_sub(1, std::memory_order_release);
+			queue->stats.droppedOldest++;
+		}
+		admitted = HasSaveRoom(queue, bytes);
+		break;
+	}
+
+	case QUEUE_POLICY_DROP_NTH:
+		if (queue->pendingJobs.load(std::memory_order_acquire) * 2 >= limits.maxJobs ||
+			(queue->pendingBytes.load(std::memory_order_acquire) + bytes) * 2 > limits.maxBytes)
+		{
+			thinned = (++queue->nthCounter % limits.dropNth == 0);
+			if (thinned)
+			{
+				queue->stats.droppedNth++;
+				break;
+			}
+		}
+		admitted = HasSaveRoom(queue, bytes);
+		break;
+
+	case QUEUE_POLICY_DROP_NEWEST:
+		admitted = HasSaveRoom(queue, bytes);
+		break;
+	}
+
+	if (admitted)
+	{
+		AdmitSave(queue, bytes);
+		return SAVE_ADMITTED;
+	}
+	if (thinned)
+		return SAVE_DROPPED_THINNED;
+
+	// every policy falls back to dropping the newest frame when a
+	// reservation is impossible (e.g. all jobs are in flight)
+	queue->stats.droppedNewest++;
+	return SAVE_DROPPED_FULL;
+}
+
+static void EnqueueSave(SaveQueue* queue, SaveJob job)
+{
+	// The job's bytes must already be reserved with ReserveSave, which keeps
+	// the number of jobs below the ring capacity.
+	job.sequence = queue->nextSequence;
+	if (!queue->jobs.TryPush(job))
+		throw std::runtime_error("Save ring overflow");
+	queue->nextSequence++;
+	queue->workEvent->NotifyOne();
+}
+
+static void PrintSaveQueueStats(const SaveQueue* queue)
+{
+	// Call after the workers are stopped.
+	const SaveQueueStats& stats = queue->stats;
+
+	std::cout << TAB1 << "Save queue (" << GetQueuePolicyName(queue->limits.policy) << ", " << queue->limits.maxJobs << " jobs / "
+			  << (queue->limits.maxBytes >> 20) << " MB)\n";
+	std::cout << TAB2 << "enqueued: " << stats.enqueued << ", peak: " << stats.peakJobs << " jobs / " << (stats.peakBytes >> 20) << " MB\n";
+	std::cout << TAB2 << "dropped: " << stats.droppedNewest << " newest, " << stats.droppedOldest << " oldest, " << stats.droppedNth << " nth\n";
+	std::cout << TAB2 << "blocked: " << stats.blockedCount << " times, " << stats.blockedNs / 1000000 << " ms\n";
+	std::cout << TAB2 << "saved: " << queue->savedCount.load(std::memory_order_relaxed) << ", failed: "
+			  << queue->failedCount.load(std::memory_order_relaxed) << ", " << (queue->savedBytes.load(std::memory_order_relaxed) >> 20) << " MB\n";
+	if (queue->pipeline)
+		std::cout << TAB2 << "dropped by stages: " << queue->filteredCount.load(std::memory_order_relaxed) << "\n";
+}
+
+static void PrintPipelineStats(const FramePipeline& pipeline)
+{
+	// Report each stage's run time, and for ordered stages the wait for the
+	// frame's turn. Call after the workers are stopped.
+	std::ios::fmtflags flags = std::cout.flags();
+	std::streamsize precision = std::cout.precision();
+	std::cout << TAB1 << "Pipeline stages (ms)\n" << std::fixed << std::setprecision(3);
+	for (size_t i = 0; i < pipeline.StageCount(); i++)
+	{
+		const PipelineStage& stage = pipeline.Stage(i);
+		const LatencyHistogram& run = pipeline.RunLatency(i);
+		std::cout << TAB2 << std::left << std::setw(10) << stage.Name() << std::right << " frames " << run.Count() << ", dropped "
+				  << pipeline.Dropped(i) << ", p50 " << run.Percentile(50.0) / 1e6 << ", p99 " << run.Percentile(99.0) / 1e6 << ", max "
+				  << run.Max() / 1e6 << "\n";
+		if (stage.Order() == STAGE_ORDERED)
+		{
+			const LatencyHistogram& wait = pipeline.WaitLatency(i);
+			std::cout << TAB2 << std::setw(10) << "" << " ordered, waited p50 " << wait.Percentile(50.0) / 1e6 << ", p99 "
+					  << wait.Percentile(99.0) / 1e6 << ", max " << wait.Max() / 1e6 << "\n";
+		}
+		std::string summary = stage.Summary();
+		if (!summary.empty())
+			std::cout << TAB2 << std::setw(10) << "" << " " << summary << "\n";
+	}
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
+
+static void PrintFrameCopyStats(const FrameCopyStats& stats, size_t holdLimit)
+{
+	std::cout << TAB1 << "Saved frames: " << stats.held << " held in SDK buffers (peak " << stats.peakHeld << " of " << holdLimit << "), "
+			  << stats.slotCopies << " copied to pool slots, " << stats.imageCopies << " copied with ImageFactory::Copy\n";
+}
+
+static void PrintGvspReceiverStats(const GvspReceiverStats& stats)
+{
+	std::cout << TAB1 << "Native GVSP receiver\n";
+	std::cout << TAB2 << "packets: " << stats.packets << " (" << (stats.bytes >> 20) << " MB) in " << stats.batches << " recvmmsg calls, "
+			  << std::fixed << std::setprecision(1) << (stats.batches ? static_cast<double>(stats.packets) / stats.batches : 0.0) << std::defaultfloat
+			  << " per call (peak " << stats.peakBatch << ")\n";
+	std::cout << TAB2 << "frames: " << stats.frames << ", incomplete: " << stats.incompleteFrames << ", no free slot: " << stats.noSlotFrames << "\n";
+	std::cout << TAB2 << "packets ignored: " << stats.ignoredPackets << ", from other senders: " << stats.foreignPackets << ", late: " << stats.latePackets
+			  << ", duplicate: " << stats.duplicatePackets << ", dropped by the kernel (SO_RXQ_OVFL): " << stats.socketDrops << "\n";
+}
+
+static void PrintFramePoolStats(const FramePool& pool)
+{
+	std::cout << TAB1 << "Frame pool (" << pool.SlotCount() << " x " << pool.SlotBytes() << " bytes)\n";
+	std::cout << TAB2 << "acquired: " << pool.AcquiredCount() << ", peak in use: " << pool.PeakInUse() << "\n";
+	std::cout << TAB2 << "exhausted: " << pool.ExhaustedCount() << ", oversize: " << pool.OversizeCount() << " (fell back to ImageFactory::Copy)\n";
+}
+
+// Requeue the SDK buffers of finished held jobs. Returns how many.
+static size_t RequeueReleasedBuffers(Arena::IDevice* pDevice, SaveQueue* queue)
+{
+	size_t count = 0;
+	Arena::IImage* pImage = NULL;
+	while (queue->releasedBuffers.TryPop(pImage))
+	{
+		pDevice->RequeueBuffer(pImage);
+		count++;
+	}
+	return count;
+}
+
+// Copy a frame into the shared-memory ring for local readers.
+static void PublishFrame(ShmFrameWriter& ring, Arena::IImage* pImage)
+{
+	RawFrameHeader header = MakeRawFrameHeader(pImage->GetWidth(), pImage->GetHeight(), pImage->GetBitsPerPixel(), pImage->GetPixelFormat(),
+		pImage->GetFrameId(), pImage->GetTimestampNs(), pImage->GetSizeFilled());
+	ring.Publish(header, pImage->GetData());
+}
+
+// Warn about shared-memory readers that lost frames since the last call.
+static void LogShmReaders(ShmFrameWriter& ring, std::map<int32_t, uint64_t>& lostLogged, const char* label)
+{
+	std::vector<ShmReaderStatus> readers = ring.Readers();
+	for (size_t i = 0; i < readers.size(); i++)
+	{
+		const ShmReaderStatus& reader = readers[i];
+		uint64_t& logged = lostLogged[reader.pid];
+		if (reader.lostFrames > logged)
+			AsyncLog::Instance().WriteWithText(LOG_WARN, 0, label, TAB1 "%tShared memory reader %u is too slow: lost %u frame(s) (+%u), %u behind\n",
+				reader.pid, reader.lostFrames, reader.lostFrames - logged, reader.behind);
+		logged = reader.lostFrames;
+	}
+}
+
+static void PrintShmRingStats(ShmFrameWriter& ring)
+{
+	std::vector<ShmReaderStatus> readers = ring.Readers();
+	std::cout << TAB1 << "Shared memory " << ring.Name() << " (" << ring.SlotCount() << " slots)\n";
+	std::cout << TAB2 << "published: " << ring.Published() << ", oversize: " << ring.OversizeCount() << ", reader wakeups: " << ring.WakeCount() << "\n";
+	for (size_t i = 0; i < readers.size(); i++)
+		std::cout << TAB2 << "reader " << readers[i].pid << ": read " << readers[i].readFrames << ", lost " << readers[i].lostFrames << ", "
+				  << readers[i].behind << " behind\n";
+}
+
+// Copy an image into a pool slot so the SDK buffer can be requeued.
+static void CopyToSlot(Arena::IImage* pImage, FrameSlot* pSlot)
+{
+	pSlot->size = pImage->GetSizeFilled();
+	pSlot->width = pImage->GetWidth();
+	pSlot->height = pImage->GetHeight();
+	pSlot->bitsPerPixel = pImage->GetBitsPerPixel();
+	pSlot->pixelFormat = pImage->GetPixelFormat();
+	pSlot->frameId = pImage->GetFrameId();
+	pSlot->timestampNs = pImage->GetTimestampNs();
+	std::memcpy(pSlot->data, pImage->GetData(), pSlot->size);
+}
+
+static std::string MakeSaveFilename(const std::string& outputDir, uint64_t timestampNs, uint64_t frameId, SaveFormat format)
+{
+	// Recordings name their own segment files.
+	if (format == SAVE_FORMAT_RECORDING)
+		return std::string();
+
+	std::ostringstream filename;
+	filename << outputDir << "/" << timestampNs << "-" << frameId << GetSaveFormatExtension(format);
+	return filename.str();
+}
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- PRE-TRIGGER HELPERS -
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+struct PreTriggerStats
+{
+	// Written only by the acquisition thread.
+	uint64_t triggers;
+	uint64_t kept;
+	uint64_t flushed;
+	// frames whose slot was reused for a newer frame
+	uint64_t recycled;
+	// frames older than the --pretrigger-ms window
+	uint64_t expired;
+	// frames not kept because no slot was free
+	uint64_t skipped;
+};
+
+// Copy a frame into the pre-trigger ring. A fresh pool slot is used while
+// the ring has room; otherwise the oldest frame's slot is reused. Frames that
+// fall out of the time window are returned to the pool. Returns false if the
+// frame could not be kept (all slots are busy saving an earlier trigger).
+static bool KeepPreTriggerFrame(Arena::IImage* pImage, FramePool& pool, PreTriggerRing& ring, uint64_t windowNs, PreTriggerStats& stats)
+{
+	size_t bytes = pImage->GetSizeFilled();
+	FrameSlot* pSlot = ring.Full() ? NULL : pool.TryAcquire(bytes);
+	if (!pSlot && ring.Size() > 0 && bytes <= pool.SlotBytes())
+	{
+		pSlot = ring.PopOldest();
+		stats.recycled++;
+	}
+	if (!pSlot)
+	{
+		stats.skipped++;
+		return false;
+	}
+
+	CopyToSlot(pImage, pSlot);
+	ring.Push(pSlot);
+	stats.kept++;
+
+	while (windowNs > 0 && ring.Oldest()->timestampNs + windowNs < pSlot->timestampNs)
+	{
+		pool.Release(ring.PopOldest());
+		stats.expired++;
+	}
+	return true;
+}
+
+// Keep a frame that already lives in a pool slot (from the native receiver)
+// in the pre-trigger ring, reusing the oldest frame's place when full.
+static void KeepPreTriggerSlot(FrameSlot* pSlot, FramePool& pool, PreTriggerRing& ring, uint64_t windowNs, PreTriggerStats& stats)
+{
+	if (ring.Full())
+	{
+		pool.Release(ring.PopOldest());
+		stats.recycled++;
+	}
+	ring.Push(pSlot);
+	stats.kept++;
+
+	while (windowNs > 0 && ring.Oldest()->timestampNs + windowNs < pSlot->timestampNs)
+	{
+		pool.Release(ring.PopOldest());
+		stats.expired++;
+	}
+}
+
+// Hand every frame in the pre-trigger ring to the save workers, oldest first.
+// The queue limits are sized so that all pool slots fit, so this never drops
+// or waits in practice. Returns the number of frames queued.
+static size_t FlushPreTrigger(SaveQueue* queue, PreTriggerRing& ring, const std::string& outputDir, SaveFormat format, uint32_t traceTid, PreTriggerStats& stats)
+{
+	size_t flushed = 0;
+	stats.triggers++;
+	for (FrameSlot* pSlot = ring.PopOldest(); pSlot; pSlot = ring.PopOldest())
+	{
+		WaitForSaveRoom(queue, pSlot->size);
+		AdmitSave(queue, pSlot->size);
+
+		SaveJob job;
+		job.pSlot = pSlot;
+		job.pImage = NULL;
+		job.heldBuffer = false;
+		job.pProcessed = NULL;
+		job.bytes = pSlot->size;
+		job.filename = MakeSaveFilename(outputDir, pSlot->timestampNs, pSlot->frameId, format);
+		// the frame was copied when it entered the ring; trace from here
+		job.trace.Reset(pSlot->frameId, traceTid);
+		job.trace.Mark(TRACE_COPIED);
+		EnqueueSave(queue, job);
+		flushed++;
+	}
+	stats.flushed += flushed;
+	return flushed;
+}
+
+static void PrintPreTriggerStats(const PreTriggerStats& stats, size_t discarded)
+{
+	std::cout << TAB1 << "Pre-trigger: " << stats.triggers << " trigger(s), " << stats.flushed << " frames saved, " << stats.kept << " kept, "
+			  << stats.recycled << " recycled, " << stats.expired << " expired, " << stats.skipped << " skipped, " << discarded
+			  << " discarded at exit\n";
+}
+
+struct StatsFile
+{
+	// JSON lines written by every camera's acquisition thread.
+	std::ofstream out;
+	std::mutex mutex;
+};
+
+struct LiveFrameStats
+{
+	// State for one camera's periodic frame statistics line.
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::duration interval;
+	std::chrono::steady_clock::time_point next;
+	uint64_t lastReceived;
+	uint64_t lastDropped;
+	StatsFile* pStatsFile;
+	// kernel UDP drops sampled with each line, or NULL
+	KernelUdpDrops* pKernelDrops;
+	// log line prefix and serial number for the stats file ("" with one camera)
+	const char* label;
+	const char* camera;
+};
+
+static void WriteStatsRecord(StatsFile* pStatsFile, const char* type, const char* camera, double elapsedSec, const FrameGapTracker& gaps,
+	const IntervalHistogram& intervals, int timeouts, const KernelUdpDrops* pKernelDrops)
+{
+	// One JSON object per line. Frame counts are totals since the start;
+	// interval figures cover the record's window ("final" covers the run).
+	std::ostringstream out;
+	out << "{\"type\":\"" << type << "\"";
+	if (camera[0] != '\0')
+		out << ",\"camera\":\"" << camera << "\"";
+	out << ",\"elapsed_s\":" << elapsedSec << ",\"received\":" << gaps.Received() << ",\"dropped\":" << gaps.Dropped()
+		<< ",\"incomplete\":" << gaps.Incomplete() << ",\"restarts\":" << gaps.Restarts() << ",\"timeouts\":" << timeouts
+		<< ",\"longest_drop_run\":" << gaps.LongestRun() << ",\"intervals\":" << intervals.Count() << ",\"fps\":" << FrameIntervalTracker::Fps(intervals)
+		<< ",\"interval_ns\":{\"min\":" << intervals.Min() << ",\"mean\":" << intervals.Mean() << ",\"p50\":" << intervals.Percentile(50.0)
+		<< ",\"p99\":" << intervals.Percentile(99.0) << ",\"p99_9\":" << intervals.Percentile(99.9) << ",\"max\":" << intervals.Max()
+		<< "},\"max_jitter_ns\":" << FrameIntervalTracker::MaxJitter(intervals);
+	if (pKernelDrops && pKernelDrops->HavePort())
+		out << ",\"kernel_port_drops\":" << pKernelDrops->PortDrops();
+	if (pKernelDrops && pKernelDrops->HaveHost())
+		out << ",\"kernel_rcvbuf_errors\":" << pKernelDrops->HostDrops();
+	out << "}\n";
+
+	std::lock_guard<std::mutex> lock(pStatsFile->mutex);
+	pStatsFile->out << out.str() << std::flush;
+}
+
+static void LogLiveFrameStats(const FrameGapTracker& gaps, FrameIntervalTracker& intervals, int timeouts, LiveFrameStats& live)
+{
+	AsyncLog& log = AsyncLog::Instance();
+	uint64_t received = gaps.Received();
+	uint64_t dropped = gaps.Dropped();
+	log.WriteWithText(LOG_INFO, 0, live.label, TAB1 "%tFrames: %u received (+%u), %u dropped (+%u, %.2f%% total), %u incomplete, longest drop run %u, %u timeouts\n",
+		received, received - live.lastReceived, dropped, dropped - live.lastDropped, gaps.DropPercent(), gaps.Incomplete(),
+		gaps.LongestRun(), timeouts);
+	live.lastReceived = received;
+	live.lastDropped = dropped;
+
+	if (live.pKernelDrops)
+	{
+		KernelUdpDrops& drops = *live.pKernelDrops;
+		drops.Sample();
+		if (drops.HavePort())
+			log.WriteWithText(LOG_INFO, 0, live.label, TAB1 "%tKernel drops: %u on UDP port %u (+%u), %u host-wide UDP RcvbufErrors (+%u)\n",
+				drops.PortDrops(), static_cast<unsigned int>(drops.Port()), drops.PortDropsDelta(), drops.HostDrops(), drops.HostDropsDelta());
+		else if (drops.HaveHost())
+			log.WriteWithText(LOG_INFO, 0, live.label, TAB1 "%tKernel drops: %u host-wide UDP RcvbufErrors (+%u)\n", drops.HostDrops(),
+				drops.HostDropsDelta());
+	}
+
+	const IntervalHistogram& window = intervals.Window();
+	if (window.Count() > 0)
+		log.WriteWithText(LOG_INFO, 0, live.label, TAB1 "%tIntervals: %.2f fps, p50 %.3f ms, p99 %.3f ms, p99.9 %.3f ms, max %.3f ms, max jitter %.3f ms\n",
+			FrameIntervalTracker::Fps(window), window.Percentile(50.0) / 1e6, window.Percentile(99.0) / 1e6, window.Percentile(99.9) / 1e6,
+			window.Max() / 1e6, FrameIntervalTracker::MaxJitter(window) / 1e6);
+
+	if (live.pStatsFile)
+	{
+		double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - live.start).count();
+		WriteStatsRecord(live.pStatsFile, "interval", live.camera, elapsedSec, gaps, window, timeouts, live.pKernelDrops);
+	}
+	intervals.ResetWindow();
+}
+
+static void PrintFrameIntervalStats(const FrameIntervalTracker& intervals)
+{
+	const IntervalHistogram& total = intervals.Total();
+	if (total.Count() == 0)
+		return;
+
+	std::ios::fmtflags flags = std::cout.flags();
+	std::streamsize precision = std::cout.precision();
+	std::cout << TAB1 << "Frame intervals (device timestamps): " << total.Count() << " intervals, " << intervals.Skipped() << " skipped at gaps, "
+			  << std::fixed << std::setprecision(2) << FrameIntervalTracker::Fps(total) << " fps\n";
+	std::cout << std::setprecision(3);
+	std::cout << TAB2 << "ms: min " << total.Min() / 1e6 << ", mean " << total.Mean() / 1e6 << ", p50 " << total.Percentile(50.0) / 1e6 << ", p99 "
+			  << total.Percentile(99.0) / 1e6 << ", p99.9 " << total.Percentile(99.9) / 1e6 << ", max " << total.Max() / 1e6 << ", max jitter "
+			  << FrameIntervalTracker::MaxJitter(total) / 1e6 << "\n";
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
+
+static void PrintFrameGapStats(const FrameGapTracker& gaps, int timeouts, const KernelUdpDrops& kernelDrops)
+{
+	std::ios::fmtflags flags = std::cout.flags();
+	std::streamsize precision = std::cout.precision();
+	std::cout << TAB1 << "Frame IDs: " << gaps.Received() << " received, " << gaps.Dropped() << " dropped (" << std::fixed << std::setprecision(2)
+			  << gaps.DropPercent() << "%), " << gaps.Incomplete() << " incomplete, " << gaps.Restarts() << " restart(s), " << gaps.Duplicates()
+			  << " duplicate(s), " << timeouts << " timeout(s)\n";
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+
+	// datagrams the kernel dropped before the SDK or the receiver saw them
+	if (kernelDrops.HavePort())
+		std::cout << TAB2 << "kernel drops: " << kernelDrops.PortDrops() << " datagram(s) on UDP port " << kernelDrops.Port() << ", "
+				  << kernelDrops.HostDrops() << " host-wide UDP RcvbufErrors\n";
+	else if (kernelDrops.HaveHost())
+		std::cout << TAB2 << "kernel drops: " << kernelDrops.HostDrops() << " host-wide UDP RcvbufErrors\n";
+
+	if (gaps.Runs() == 0)
+		return;
+
+	std::cout << TAB2 << "drop runs: " << gaps.Runs() << ", longest " << gaps.LongestRun() << " frame(s) before frame ID "
+			  << gaps.LongestRunBeforeId() << "\n";
+	std::cout << TAB2 << "drop run histogram (frames: runs):";
+	bool first = true;
+	for (int i = 0; i < FRAME_GAP_RUN_BUCKETS; i++)
+	{
+		if (gaps.RunBucketCount(i) == 0)
+			continue;
+		uint64_t lower = FrameGapTracker::RunBucketLower(i);
+		std::cout << (first ? " " : ", ") << lower;
+		if (i == FRAME_GAP_RUN_BUCKETS - 1)
+			std::cout << "+";
+		else if (lower > 1)
+			std::cout << "-" << lower * 2 - 1;
+		std::cout << ": " << gaps.RunBucketCount(i);
+		first = false;
+	}
+	std::cout << "\n";
+}
+
+// Start the workers once every camera's lane is in place. Worker trace
+// threads are numbered after the cameras' acquisition threads.
+static void StartSaveWorkers(SaveWorkerPool& pool, size_t count, TraceFile* pTraceFile, const ThreadPlacement& placement)
+{
+	pool.stats = std::vector<SaveWorkerStats>(count);
+	pool.placement = placement;
+	pool.startTime = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < count; i++)
+	{
+		pool.stats[i].traceTid = static_cast<uint32_t>(pool.lanes.size() + i);
+		if (pTraceFile)
+			pTraceFile->NameThread(pool.stats[i].traceTid, "save worker " + std::to_string(i));
+	}
+	for (size_t i = 0; i < count; i++)
+		pool.threads.push_back(std::thread(SaveWorker, &pool, &pool.stats[i], i));
+}
+
+static void StopSaveWorkers(SaveWorkerPool& pool)
+{
+	// Signal the workers to flush and exit; each worker drains the queues
+	// until they are empty before returning.
+	pool.stop.store(true, std::memory_order_release);
+	pool.workEvent.NotifyAll();
+	for (size_t i = 0; i < pool.threads.size(); i++)
+	{
+		if (pool.threads[i].joinable())
+			pool.threads[i].join();
+	}
+}
+
+static void PrintSaveLatency(const SaveWorkerPool& pool)
+{
+	// Report job latency percentiles and how many jobs fell into each stall
+	// band, so buffered and --direct-io runs can be compared.
+	LatencyHistogram latency;
+	for (size_t i = 0; i < pool.stats.size(); i++)
+		latency.Merge(pool.stats[i].latency);
+	if (latency.Count() == 0)
+		return;
+
+	std::cout << TAB2 << "job latency ms: p50 " << latency.Percentile(50.0) / 1e6 << ", p90 " << latency.Percentile(90.0) / 1e6
+			  << ", p99 " << latency.Percentile(99.0) / 1e6 << ", p99.9 " << latency.Percentile(99.9) / 1e6
+			  << ", max " << latency.Max() / 1e6 << "\n";
+
+	static const uint64_t bandsMs[] = { 0, 1, 10, 100, 1000 };
+	const size_t bandCount = sizeof(bandsMs) / sizeof(bandsMs[0]);
+	std::cout << TAB2 << "job latency histogram:";
+	for (size_t i = 0; i < bandCount; i++)
+	{
+		uint64_t low = bandsMs[i] * 1000000ull;
+		uint64_t high = i + 1 < bandCount ? bandsMs[i + 1] * 1000000ull : UINT64_MAX;
+		std::cout << (i ? ", " : " ") << (i + 1 < bandCount ? "<" : ">=") << (i + 1 < bandCount ? bandsMs[i + 1] : bandsMs[i])
+				  << " ms: " << latency.CountBetween(low, high);
+	}
+	std::cout << "\n";
+	std::cout << TAB2 << "write stalls (>= " << WRITE_STALL_MS << " ms): "
+			  << latency.CountBetween(static_cast<uint64_t>(WRITE_STALL_MS) * 1000000ull, UINT64_MAX) << "\n";
+}
+
+static void PrintStageLatency(const SaveWorkerPool& pool)
+{
+	// Report where saved frames spent their time, stage by stage.
+	StageHistograms stages;
+	for (size_t i = 0; i < pool.stats.size(); i++)
+		stages.Merge(pool.stats[i].stages);
+	if (stages.Total().Count() == 0)
+		return;
+
+	std::ios::fmtflags flags = std::cout.flags();
+	std::streamsize precision = std::cout.precision();
+	std::cout << TAB1 << "Stage latency (ms, " << stages.Total().Count() << " saved frames)\n" << std::fixed << std::setprecision(3);
+	for (int i = 0; i <= TRACE_STAGE_COUNT; i++)
+	{
+		const LatencyHistogram& latency = i < TRACE_STAGE_COUNT ? stages.Stage(i) : stages.Total();
+		if (latency.Count() == 0)
+			continue;
+		std::cout << TAB2 << std::left << std::setw(10) << (i < TRACE_STAGE_COUNT ? GetTraceStageName(i) : "total") << std::right
+				  << " p50 " << latency.Percentile(50.0) / 1e6 << ", p99 " << latency.Percentile(99.0) / 1e6 << ", p99.9 "
+				  << latency.Percentile(99.9) / 1e6 << ", max " << latency.Max() / 1e6 << "\n";
+	}
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
+
+static void PrintSaveWorkerStats(const SaveWorkerPool& pool)
+{
+	// Report per-worker and total throughput over the pool's lifetime.
+	std::chrono::duration<double> wall = std::chrono::steady_clock::now() - pool.startTime;
+	double wallSec = wall.count() > 0.0 ? wall.count() : 1e-9;
+
+	uint64_t totalSaved = 0;
+	uint64_t totalFailed = 0;
+	uint64_t totalBytes = 0;
+
+	std::ios::fmtflags flags = std::cout.flags();
+	std::streamsize precision = std::cout.precision();
+	std::cout << TAB1 << "Save workers (" << pool.stats.size() << ", " << std::fixed << std::setprecision(2) << wallSec << " s)\n";
+	for (size_t i = 0; i < pool.stats.size(); i++)
+	{
+		const SaveWorkerStats& stats = pool.stats[i];
+		uint64_t saved = stats.savedCount.load(std::memory_order_relaxed);
+		uint64_t failed = stats.failedCount.load(std::memory_order_relaxed);
+		uint64_t bytes = stats.savedBytes.load(std::memory_order_relaxed);
+		double busySec = stats.busyNs.load(std::memory_order_relaxed) / 1e9;
+
+		std::cout << TAB2 << "worker " << i << ": " << saved << " saved, " << failed << " failed, "
+				  << saved / wallSec << " fps, " << bytes / wallSec / 1e6 << " MB/s, "
+				  << 100.0 * busySec / wallSec << "% busy\n";
+
+		totalSaved += saved;
+		totalFailed += failed;
+		totalBytes += bytes;
+	}
+	std::cout << TAB2 << "total: " << totalSaved << " saved, " << totalFailed << " failed, "
+			  << totalSaved / wallSec << " fps, " << totalBytes / wallSec / 1e6 << " MB/s\n";
+	std::cout << TAB2 << "worker wakeups: " << pool.workEvent.WakeCount() << "\n";
+
+	PrintSaveLatency(pool);
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
+
+struct SaveWorkerGuard
+{
+	SaveWorkerPool* pool;
+	~SaveWorkerGuard()
+	{
+		// Ensure pending saves are flushed before returning.
+		if (pool)
+			StopSaveWorkers(*pool);
+	}
+};
+
+struct StdinWatchGuard
+{
+	// Hand stdin back (and restore the terminal) when acquisition ends.
+	ControlThread* control;
+	~StdinWatchGuard()
+	{
+		control->UnwatchStdin();
+	}
+};
+
+struct LogGuard
+{
+	// Write pending log records before the caller prints anything else.
+	~LogGuard()
+	{
+		AsyncLog::Instance().Stop();
+	}
+};
+
+struct MulticastGuard
+{
+	int socketFd;
+	ip_mreqn request;
+	// source-specific join (--ssm); request still holds group and interface
+	group_source_req sourceRequest;
+	bool sourceSpecific;
+	bool joined;
+
+	MulticastGuard()
+		: socketFd(-1)
+		, sourceSpecific(false)
+		, joined(false)
+	{
+		std::memset(&request, 0, sizeof(request));
+		std::memset(&sourceRequest, 0, sizeof(sourceRequest));
+	}
+
+	~MulticastGuard()
+	{
+		Leave();
+		if (socketFd != -1)
+			close(socketFd);
+	}
+
+	// Join the group on the interface. With a source address the join is
+	// source-specific (IGMPv3 INCLUDE mode) and only that sender's datagrams
+	// are accepted; otherwise any source is.
+	void Join(const char* interfaceName, const std::string& group, const std::string& source = std::string())
+	{
+		socketFd = socket(AF_INET, SOCK_DGRAM, 0);
+		if (socketFd < 0)
+			throw std::runtime_error(std::string("Failed to create socket: ") + std::strerror(errno));
+
+		unsigned int ifIndex = if_nametoindex(interfaceName);
+		if (ifIndex == 0)
+			throw std::runtime_error(std::string("Invalid interface name: ") + interfaceName);
+
+		if (inet_pton(AF_INET, group.c_str(), &request.imr_multiaddr) != 1)
+			throw std::runtime_error("Invalid multicast group IP: " + group);
+
+		request.imr_ifindex = static_cast<int>(ifIndex);
+		request.imr_address.s_addr = htonl(INADDR_ANY);
+
+		if (!source.empty())
+		{
+			// MCAST_JOIN_SOURCE_GROUP is IP_ADD_SOURCE_MEMBERSHIP with the
+			// interface given by index, as in request, instead of by address
+			sockaddr_in* pGroup = reinterpret_cast<sockaddr_in*>(&sourceRequest.gsr_group);
+			sockaddr_in* pSource = reinterpret_cast<sockaddr_in*>(&sourceRequest.gsr_source);
+			sourceRequest.gsr_interface = ifIndex;
+			pGroup->sin_family = AF_INET;
+			pGroup->sin_addr = request.imr_multiaddr;
+			pSource->sin_family = AF_INET;
+			if (inet_pton(AF_INET, source.c_str(), &pSource->sin_addr) != 1)
+				throw std::runtime_error("Invalid multicast source IP: " + source);
+			if (setsockopt(socketFd, IPPROTO_IP, MCAST_JOIN_SOURCE_GROUP, &sourceRequest, sizeof(sourceRequest)) != 0)
+				throw std::runtime_error("Failed to join multicast group " + group + " for source " + source + ": " + std::strerror(errno));
+			sourceSpecific = true;
+		}
+		else if (setsockopt(socketFd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) != 0)
+			throw std::runtime_error(std::string("Failed to join multicast group: ") + std::strerror(errno));
+
+		joined = true;
+	}
+
+	// Leave the group the way it was joined. A source-specific membership is
+	// left with MCAST_LEAVE_SOURCE_GROUP so the kernel sends the IGMPv3
+	// report that removes the source. Returns 0 or an errno value if the
+	// kernel refused; the membership ends with the socket anyway.
+	int Leave()
+	{
+		if (!joined)
+			return 0;
+		joined = false;
+		int result = sourceSpecific
+			? setsockopt(socketFd, IPPROTO_IP, MCAST_LEAVE_SOURCE_GROUP, &sourceRequest, sizeof(sourceRequest))
+			: setsockopt(socketFd, IPPROTO_IP, IP_DROP_MEMBERSHIP, &request, sizeof(request));
+		return result == 0 ? 0 : errno;
+	}
+
+	// Bind the socket to the group and stream port so it receives the GVSP
+	// datagrams itself (--native-gvsp). Call after Join.
+	void Bind(uint16_t port)
+	{
+		int reuse = 1;
+		setsockopt(socketFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+		// only this socket's own membership (group, interface and source),
+		// not every group the host joined on any interface
+		int all = 0;
+		setsockopt(socketFd, IPPROTO_IP, IP_MULTICAST_ALL, &all, sizeof(all));
+
+		sockaddr_in address;
+		std::memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr = request.imr_multiaddr;
+		address.sin_port = htons(port);
+		if (bind(socketFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+			throw std::runtime_error("Failed to bind to stream port " + std::to_string(port) + ": " + std::strerror(errno));
+	}
+
+	// Ask for a receive queue of `bytes` and return what the kernel granted.
+	// SO_RCVBUFFORCE is tried first, then SO_RCVBUF. The kernel doubles the
+	// request to cover its bookkeeping and reports the doubled value.
+	size_t SizeReceiveBuffer(size_t bytes)
+	{
+		int request = bytes > INT_MAX / 2 ? INT_MAX / 2 : static_cast<int>(bytes);
+		if (setsockopt(socketFd, SOL_SOCKET, SO_RCVBUFFORCE, &request, sizeof(request)) != 0)
+			setsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &request, sizeof(request));
+
+		int granted = 0;
+		socklen_t length = sizeof(granted);
+		if (getsockopt(socketFd, SOL_SOCKET, SO_RCVBUF, &granted, &length) != 0)
+			throw std::runtime_error(std::string("Failed to read socket receive buffer: ") + std::strerror(errno));
+		return static_cast<size_t>(granted) / 2;
+	}
+
+	// Have the kernel attach the socket's drop count to received datagrams
+	// (GvspReceiverStats::socketDrops).
+	void EnableDropCount()
+	{
+		int enable = 1;
+		if (setsockopt(socketFd, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable)) != 0)
+			throw std::runtime_error(std::string("Failed to enable SO_RXQ_OVFL: ") + std::strerror(errno));
+	}
+};
+
+struct CameraDevice
+{
+	// A device opened by main and the multicast group it streams to.
+	Arena::IDevice* pDevice;
+	std::string serial;
+	std::string group;
+	// interface the group is joined on
+	std::string interfaceName;
+	// camera's IPv4 address in host byte order, the sender of its stream
+	uint32_t address;
+	// socket joined to the group, owned by main's MulticastGuard
+	MulticastGuard* pMulticast;
+};
+
+struct CameraContext
+{
+	// One camera and everything its acquisition thread owns. Heap allocated
+	// and never moved, since the save workers keep pointers into it.
+	Arena::IDevice* pDevice;
+	std::string serial;
+	std::string group;
+	std::string interfaceName;
+	// IPv4 address in host byte order
+	uint32_t address;
+	// "[serial] " before the camera's lines in multi-camera runs, "" otherwise
+	std::string label;
+	std::string outputDir;
+	uint32_t traceTid;
+	// CPUs and scheduling applied by the acquisition thread when it starts
+	ThreadPlacement placement;
+	bool isMaster;
+	GenICam::gcstring acquisitionModeInitial;
+	// GevSCDA before this run set it to the camera's group, if it did
+	bool streamDestinationSet;
+	int64_t streamDestinationInitial;
+
+	std::unique_ptr<FramePool> framePool;
+	std::unique_ptr<RecordingWriter> recording;
+	std::unique_ptr<SaveQueue> saveQueue;
+	// --stage pipeline with this camera's own stage instances, or NULL
+	std::unique_ptr<FramePipeline> pipeline;
+	SaveOutput saveOutput;
+	// --shm ring every complete frame is published to, or NULL
+	std::unique_ptr<ShmFrameWriter> shmRing;
+	// joined multicast socket, and its receiver with --native-gvsp (else NULL)
+	MulticastGuard* pMulticast;
+	std::unique_ptr<GvspReceiver> gvspReceiver;
+	// UDP port the stream arrives on (0 if unknown) and its kernel drops
+	uint16_t streamPort;
+	KernelUdpDrops kernelDrops;
+	std::unique_ptr<PreTriggerRing> preTriggerRing;
+
+	// Written only by the camera's acquisition thread.
+	int imageCount;
+	int unreceivedImageCount;
+	size_t savedImageCount;
+	FrameGapTracker frameGaps;
+	FrameIntervalTracker frameIntervals;
+	LiveFrameStats liveStats;
+	PreTriggerStats preTriggerStats;
+	size_t preTriggerDiscarded;
+	// SDK buffers currently held by save jobs (--hold-buffers)
+	size_t heldBuffers;
+	FrameCopyStats copyStats;
+	// lost frames of the shm readers already logged, by reader PID
+	std::map<int32_t, uint64_t> shmLostLogged;
+
+	// Written by the acquisition thread, read by main's interface report.
+	std::atomic<uint64_t> receivedBytes;
+	std::atomic<bool> finished;
+
+	// exception that ended the camera's thread, rethrown on the main thread
+	std::exception_ptr error;
+
+	CameraContext()
+		: pDevice(NULL)
+		, address(0)
+		, traceTid(0)
+		, isMaster(false)
+		, streamDestinationSet(false)
+		, streamDestinationInitial(0)
+		, saveOutput()
+		, pMulticast(NULL)
+		, streamPort(0)
+		, imageCount(0)
+		, unreceivedImageCount(0)
+		, savedImageCount(0)
+		, liveStats()
+		, preTriggerStats()
+		, preTriggerDiscarded(0)
+		, heldBuffers(0)
+		, copyStats()
+		, receivedBytes(0)
+		, finished(false)
+	{
+	}
+};
+
+// =-=-=-=-=-=-=-=-=-
+// =-=- EXAMPLE -=-=-
+// =-=-=-=-=-=-=-=-=- 
+// (1) enable multicast
+// (2) prepare settings on master, not on listener
+// (3) stream regularly
+
+// demonstrates saving an image
+// (1) converts image to a displayable pixel format
+// (2) prepares image parameters
+// (3) prepares image writer
+// (4) saves image
 // (5) destroys converted image
 void SaveImage(Arena::IImage* pImage, const char* filename)
 {
 
-	// Convert image
-	//    Convert the image to a displayable pixel format. It is worth keeping in
-	//    mind the best pixel and file formats for your application. This example
-	//    converts the image so that it is displayable by the operating system.
-	std::cout << TAB1 << "Convert image to " << GetPixelFormatName(PIXEL_FORMAT) << "\n";
+	// Convert image
+	//    Convert the image to a displayable pixel format. It is worth keeping in
+	//    mind the best pixel and file formats for your application. This example
+	//    converts the image so that it is displayable by the operating system.
+	AsyncLog::Instance().WriteWithText(LOG_DEBUG, 0, GetPixelFormatName(PIXEL_FORMAT), TAB1 "Convert image to %t\n");
+
+	auto pConverted = Arena::ImageFactory::Convert(
+		pImage,
+		PIXEL_FORMAT);
+	MarkCurrentJob(TRACE_CONVERTED);
+
+	// Prepare image parameters
+	//    An image's width, height, and bits per pixel are required to save to
+	//    disk. Its size and stride (i.e. pitch) can be calculated from those 3
+	//    inputs. Notice that an image's size and stride use bytes as a unit
+	//    while the bits per pixel uses bits.
+	LogMessage(LOG_DEBUG, TAB1 "Prepare image parameters\n");
+
+	Save::ImageParams params(
+		pConverted->GetWidth(),
+		pConverted->GetHeight(),
+		pConverted->GetBitsPerPixel());
+
+	// Prepare image writer
+	//    The image writer requires 3 arguments to save an image: the image's
+	//    parameters, a specified file name or pattern, and the image data to
+	//    save. Providing these should result in a successfully saved file on the
+	//    disk. Because an image's parameters and file name pattern may repeat,
+	//    they can be passed into the image writer's constructor.
+	LogMessage(LOG_DEBUG, TAB1 "Prepare image writer\n");
+
+	Save::ImageWriter writer(
+		params,
+		filename);
+
+	// Save image
+	//    Passing image data into the image writer using the cascading I/O
+	//    operator (<<) triggers a save. Notice that the << operator accepts the
+	//    image data as a constant unsigned 8-bit integer pointer (const
+	//    uint8_t*) and the file name as a character string (const char*).
+	LogMessage(LOG_DEBUG, TAB1 "Save image\n");
+
+	writer << pConverted->GetData();
+
+	// destroy converted image
+	Arena::ImageFactory::Destroy(pConverted);
+}
+
+// saves a frame held in a frame pool slot
+//    Frames already in the save pixel format are written straight from the
+//    slot. Others are wrapped in an image on the worker thread so they can be
+//    converted, which keeps that allocation off the acquisition thread.
+void SaveSlot(const FrameSlot* pSlot, const char* filename)
+{
+	if (pSlot->pixelFormat == static_cast<uint64_t>(PIXEL_FORMAT))
+	{
+		Save::ImageParams params(
+			pSlot->width,
+			pSlot->height,
+			pSlot->bitsPerPixel);
+
+		Save::ImageWriter writer(
+			params,
+			filename);
 
-	auto pConverted = Arena::ImageFactory::Convert(
-		pImage,
-		PIXEL_FORMAT);
+		writer << pSlot->data;
+		return;
+	}
+
+	Arena::IImage* pImage = Arena::ImageFactory::Create(
+		pSlot->data,
+		pSlot->size,
+		pSlot->width,
+		pSlot->height,
+		pSlot->pixelFormat);
+
+	try
+	{
+		SaveImage(pImage, filename);
+	}
+	catch (...)
+	{
+		Arena::ImageFactory::Destroy(pImage);
+		throw;
+	}
+	Arena::ImageFactory::Destroy(pImage);
+}
+
+// saves a frame with the striped PNG encoder
+//    The frame comes from a pool slot or a copied image. Frames not already in
+//    PIXEL_FORMAT are converted first, as in SaveImage, then the encoder
+//    splits the frame into stripes that are deflated on separate threads and
+//    writes the resulting chunks with one pwritev.
+void SavePngStriped(Arena::IImage* pImage, const FrameSlot* pSlot, const char* filename, size_t threads)
+{
+	// one encoder per save worker so its stripe buffers are reused
+	static thread_local StripedPngEncoder encoder;
+
+	Arena::IImage* pWrapped = NULL;
+	Arena::IImage* pConverted = NULL;
+	try
+	{
+		const uint8_t* pData = NULL;
+		size_t width = 0;
+		size_t height = 0;
+		uint64_t pixelFormat = 0;
+		if (pSlot && pSlot->pixelFormat == static_cast<uint64_t>(PIXEL_FORMAT))
+		{
+			pData = pSlot->data;
+			width = pSlot->width;
+			height = pSlot->height;
+			pixelFormat = pSlot->pixelFormat;
+		}
+		else
+		{
+			if (pSlot)
+				pImage = pWrapped = Arena::ImageFactory::Create(pSlot->data, pSlot->size, pSlot->width, pSlot->height, pSlot->pixelFormat);
+			pConverted = Arena::ImageFactory::Convert(pImage, PIXEL_FORMAT);
+			MarkCurrentJob(TRACE_CONVERTED);
+			pData = pConverted->GetData();
+			width = pConverted->GetWidth();
+			height = pConverted->GetHeight();
+			pixelFormat = pConverted->GetPixelFormat();
+		}
+
+		// PNG stores RGB; BGR frames are reordered while filtering
+		size_t channels = 3;
+		bool swapRedBlue = false;
+		if (pixelFormat == static_cast<uint64_t>(BGR8))
+			swapRedBlue = true;
+		else if (pixelFormat == static_cast<uint64_t>(Mono8))
+			channels = 1;
+		else if (pixelFormat != static_cast<uint64_t>(RGB8))
+			throw std::runtime_error("Striped PNG encoder supports Mono8, RGB8 and BGR8 only");
+
+		encoder.Encode(pData, width, height, channels, swapRedBlue, PNG_DEFLATE_LEVEL, threads);
+		MarkCurrentJob(TRACE_ENCODED);
+
+		int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		if (fd < 0)
+			throw std::runtime_error(std::string("Failed to open ") + filename + ": " + std::strerror(errno));
+		std::vector<iovec> parts = encoder.Parts();
+		int error = WriteVectorAt(fd, &parts[0], static_cast<int>(parts.size()), 0);
+		if (close(fd) != 0 && error == 0)
+			error = errno;
+		if (error != 0)
+			throw std::runtime_error(std::string("Failed to write ") + filename + ": " + std::strerror(error));
+	}
+	catch (...)
+	{
+		if (pConverted)
+			Arena::ImageFactory::Destroy(pConverted);
+		if (pWrapped)
+			Arena::ImageFactory::Destroy(pWrapped);
+		throw;
+	}
+	if (pConverted)
+		Arena::ImageFactory::Destroy(pConverted);
+	if (pWrapped)
+		Arena::ImageFactory::Destroy(pWrapped);
+}
+
+// saves a frame without conversion
+//    Raw mode skips conversion and PNG encoding so the listener can keep up
+//    with line rate. The header and the original pixel buffer are written with
+//    a single pwritev; conversion can be done later from the header fields.
+//    With O_DIRECT the header is padded to a full block (headerSize says how
+//    far), so an aligned pixel buffer such as a pool slot goes straight to
+//    the device and only the header and the file's last block are copied.
+void SaveRaw(const RawFrameHeader& header, const uint8_t* pData, const char* filename, bool directIo)
+{
+	int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | (directIo ? O_DIRECT : 0), 0644);
+	if (fd < 0)
+		throw std::runtime_error(std::string("Failed to open ") + filename + ": " + std::strerror(errno));
+
+	iovec parts[2];
+	parts[0].iov_base = const_cast<RawFrameHeader*>(&header);
+	parts[0].iov_len = sizeof(header);
+	parts[1].iov_base = const_cast<uint8_t*>(pData);
+	parts[1].iov_len = static_cast<size_t>(header.dataSize);
+
+	uint8_t headerBlock[DIRECT_IO_ALIGNMENT];
+	if (directIo)
+	{
+		RawFrameHeader padded = header;
+		padded.headerSize = static_cast<uint16_t>(DIRECT_IO_ALIGNMENT);
+		std::memset(headerBlock, 0, sizeof(headerBlock));
+		std::memcpy(headerBlock, &padded, sizeof(padded));
+		parts[0].iov_base = headerBlock;
+		parts[0].iov_len = sizeof(headerBlock);
+	}
+
+	// with O_DIRECT unaligned pieces are staged through an aligned bounce buffer
+	int error = directIo ? WriteDirectAt(fd, parts, 2, 0) : WriteVectorAt(fd, parts, 2, 0);
+	if (error != 0)
+	{
+		close(fd);
+		throw std::runtime_error(std::string("Failed to write ") + filename + ": " + std::strerror(error));
+	}
+
+	if (close(fd) != 0)
+		throw std::runtime_error(std::string("Failed to close ") + filename + ": " + std::strerror(errno));
+}
+
+// prepares one camera before streaming
+// (1) enables multicast
+// (2) prepares settings on master, not on listener
+// (3) allocates the camera's frame pool, save queue and recording
+static void PrepareCamera(CameraContext& camera, const Options& options, size_t cameraCount, SaveWorkerPool& savePool, TraceFile* pTraceFile)
+{
+	Arena::IDevice* pDevice = camera.pDevice;
+	const std::string& outputDir = camera.outputDir;
+	const std::string& label = camera.label;
+
+	// get node values that will be changed in order to return their values at
+	// the end of the example
+	camera.acquisitionModeInitial = Arena::GetNodeValue<GenICam::gcstring>(pDevice->GetNodeMap(), "AcquisitionMode");
+
+	// Enable multicast
+	//    Multicast must be enabled on both the master and listener. A small
+	//    number of transport layer features will remain writable even though a
+	//    device's access mode might be read-only.
+	std::cout << TAB1 << label << "Enable multicast\n";
+
+	Arena::SetNodeValue<bool>(
+		pDevice->GetTLStreamNodeMap(),
+		"StreamMulticastEnable",
+		true);
+
+	// Prepare settings on master, not on listener
+	//    Device features must be set on the master rather than the listener.
+	//    This is because the listener is opened with a read-only access mode.
+	GenICam::gcstring deviceAccessStatus = Arena::GetNodeValue<GenICam::gcstring>(
+		pDevice->GetTLDeviceNodeMap(),
+		"DeviceAccessStatus");
+	camera.isMaster = (deviceAccessStatus == "ReadWrite");
+
+	// master
+	if (camera.isMaster)
+	{
+		std::cout << TAB1 << label << "Host streaming as 'master'\n";
+
+		// set acquisition mode
+		std::cout << TAB2 << "Set acquisition mode to 'Continuous'\n";
+
+		Arena::SetNodeValue<GenICam::gcstring>(
+			pDevice->GetNodeMap(),
+			"AcquisitionMode",
+			"Continuous");
+
+		// enable stream auto negotiate packet size
+		Arena::SetNodeValue<bool>(pDevice->GetTLStreamNodeMap(), "StreamAutoNegotiatePacketSize", true);
+
+		// enable stream packet resend
+		Arena::SetNodeValue<bool>(pDevice->GetTLStreamNodeMap(), "StreamPacketResendEnable", true);
+
+		// Stream to the camera's own group
+		//    With --cameras each camera gets a separate group so a host can
+		//    join only the cameras it needs. GevSCDA is the stream channel
+		//    destination; a camera that rejects it keeps its own address.
+		if (options.cameras)
+		{
+			in_addr address;
+			inet_pton(AF_INET, camera.group.c_str(), &address);
+			try
+			{
+				camera.streamDestinationInitial = Arena::GetNodeValue<int64_t>(pDevice->GetNodeMap(), "GevSCDA");
+				Arena::SetNodeValue<int64_t>(pDevice->GetNodeMap(), "GevSCDA", static_cast<int64_t>(ntohl(address.s_addr)));
+				camera.streamDestinationSet = true;
+				std::cout << TAB2 << "Set stream destination to " << camera.group << "\n";
+			}
+			catch (GenICam::GenericException& ge)
+			{
+				std::cout << TAB2 << "Failed to set stream destination to " << camera.group << ": " << ge.what() << "\n";
+			}
+		}
+	}
+
+	// listener
+	else
+	{
+		std::cout << TAB1 << label << "Host streaming as 'listener'\n";
+	}
+
+	// Prepare native receiver
+	//    Bind the joined socket to the port the master streams to. The SDK
+	//    stream is never started, so nothing else reads the port.
+	uint16_t gvspPort = options.gvspPort;
+	if (options.nativeGvsp)
+	{
+		if (camera.isMaster)
+			throw std::runtime_error("--native-gvsp needs a listener; the master streams through the SDK");
+		if (gvspPort == 0)
+			gvspPort = static_cast<uint16_t>(Arena::GetNodeValue<int64_t>(pDevice->GetNodeMap(), "GevSCPHostPort"));
+		camera.pMulticast->Bind(gvspPort);
+	}
+
+	// Prepare frame pool
+	//    Frames are copied into pre-allocated slots instead of heap copies so
+	//    the acquisition loop never allocates. Slots are sized from the
+	//    payload size before streaming starts. Each camera gets an equal share
+	//    of the pool slots and the save queue limits.
+	size_t payloadSize = static_cast<size_t>(Arena::GetNodeValue<int64_t>(pDevice->GetNodeMap(), "PayloadSize"));
+	SaveQueueLimits queueLimits = options.queueLimits;
+	queueLimits.maxJobs = (queueLimits.maxJobs + cameraCount - 1) / cameraCount;
+	queueLimits.maxBytes /= cameraCount;
+	size_t poolSlots = (options.poolSlots + cameraCount - 1) / cameraCount;
+	if (payloadSize > 0 && poolSlots > queueLimits.maxBytes / payloadSize)
+		poolSlots = static_cast<size_t>(queueLimits.maxBytes / payloadSize);
+	if (poolSlots == 0)
+		poolSlots = 1;
+	// frames the native receiver is still assembling hold slots too
+	if (options.nativeGvsp)
+		poolSlots += GVSP_MAX_ASSEMBLIES;
+
+	// Pre-trigger frames get their own slots on top of the save queue's
+	// share. After a trigger every slot may be queued at once, so the queue
+	// limits grow to cover the whole pool.
+	if (options.preTriggerFrames > 0)
+	{
+		poolSlots += options.preTriggerFrames;
+		if (queueLimits.maxJobs < poolSlots)
+			queueLimits.maxJobs = poolSlots;
+		if (queueLimits.maxBytes < static_cast<uint64_t>(poolSlots) * payloadSize)
+			queueLimits.maxBytes = static_cast<uint64_t>(poolSlots) * payloadSize;
+	}
+
+	camera.framePool.reset(new FramePool(poolSlots, payloadSize));
+	std::cout << TAB1 << label << "Allocate frame pool (" << camera.framePool->SlotCount() << " x " << camera.framePool->SlotBytes() << " bytes)\n";
+	if (options.nativeGvsp)
+	{
+		camera.gvspReceiver.reset(new GvspReceiver(camera.pMulticast->socketFd, camera.framePool.get()));
+		// another master on the same group and port must not feed this camera's frames
+		camera.gvspReceiver->SetSource(camera.address);
+		std::cout << TAB1 << label << "Receive GVSP on " << camera.group << ":" << gvspPort << " (" << GVSP_BATCH_PACKETS << " datagrams per recvmmsg)\n";
+
+		// Size the socket queue
+		//    From the expected stream rate. A listener can usually read the
+		//    frame rate; if not, the minimum size applies.
+		double frameRate = 0.0;
+		try
+		{
+			frameRate = Arena::GetNodeValue<double>(pDevice->GetNodeMap(), "AcquisitionFrameRate");
+		}
+		catch (GenICam::GenericException&)
+		{
+		}
+		double bytesPerSec = static_cast<double>(payloadSize) * frameRate;
+		double wanted = bytesPerSec * SOCKET_RCVBUF_MS / 1000.0;
+		if (wanted < SOCKET_RCVBUF_MIN_BYTES)
+			wanted = SOCKET_RCVBUF_MIN_BYTES;
+		if (wanted > SOCKET_RCVBUF_MAX_BYTES)
+			wanted = SOCKET_RCVBUF_MAX_BYTES;
+		size_t granted = camera.pMulticast->SizeReceiveBuffer(static_cast<size_t>(wanted));
+		camera.pMulticast->EnableDropCount();
+		std::cout << TAB2 << "Socket receive buffer " << (granted >> 20) << " MB for " << static_cast<uint64_t>(bytesPerSec / 1e6) << " MB/s\n";
+		if (granted < static_cast<size_t>(wanted))
+			std::cout << TAB2 << "Wanted " << (static_cast<size_t>(wanted) >> 20)
+					  << " MB; raise net.core.rmem_max or grant CAP_NET_ADMIN (sudo setcap cap_net_admin+ep Cpp_Multicast_Save)\n";
+		camera.streamPort = gvspPort;
+	}
+
+	// Prepare shared-memory ring
+	//    Local readers attach by name with ShmFrameReader.
+	if (options.shmName)
+	{
+		std::string shmName = options.shmName;
+		if (shmName.empty() || shmName[0] != '/')
+			shmName = "/" + shmName;
+		if (cameraCount > 1)
+			shmName += "-" + camera.serial;
+		camera.shmRing.reset(new ShmFrameWriter());
+		camera.shmRing->Create(shmName, options.shmSlots, payloadSize);
+		std::cout << TAB1 << label << "Publish frames to shared memory " << shmName << " (" << options.shmSlots << " x " << payloadSize << " bytes)\n";
+	}
+
+	// Prepare recording
+	//    In recording mode all frames are appended to large segment files in the
+	//    output directory instead of one file per frame.
+	SaveOutput& saveOutput = camera.saveOutput;
+	saveOutput.format = options.saveFormat;
+	saveOutput.pRecording = NULL;
+	saveOutput.useUring = (options.ioBackend == IO_BACKEND_URING);
+	saveOutput.uringDepth = options.ioDepth;
+	saveOutput.pFramePool = camera.framePool.get();
+	saveOutput.directIo = false;
+	saveOutput.pngThreads = options.pngThreads;
+	saveOutput.syncFiles = options.syncFiles;
+	saveOutput.pTraceFile = pTraceFile;
+	if (options.directIo && options.saveFormat == SAVE_FORMAT_PNG)
+	{
+		std::cout << TAB1 << label << "--direct-io only applies to raw and rec formats\n";
+	}
+	else if (options.directIo)
+	{
+		int error = ProbeDirectIo(outputDir);
+		if (error == 0)
+			saveOutput.directIo = true;
+		else
+			std::cout << TAB1 << label << "O_DIRECT not supported in " << outputDir << " (" << std::strerror(error) << "), using buffered writes\n";
+	}
+	if (options.saveFormat == SAVE_FORMAT_RECORDING)
+	{
+		std::cout << TAB1 << label << "Open recording in " << outputDir << "\n";
+		camera.recording.reset(new RecordingWriter(outputDir, options.segmentBytes, saveOutput.directIo));
+		saveOutput.pRecording = camera.recording.get();
+		if (saveOutput.useUring)
+			std::cout << TAB2 << "Write segments with io_uring (" << options.ioDepth << " records in flight per worker)\n";
+	}
+	else if (saveOutput.useUring)
+	{
+		std::cout << TAB1 << label << "io_uring backend only applies to rec format; using blocking writes\n";
+	}
+
+	if (options.syncFiles && options.saveFormat == SAVE_FORMAT_RECORDING)
+		std::cout << TAB1 << label << "--fsync only applies to png and raw formats\n";
+
+	// the camera's queue becomes one lane of the shared save workers
+	camera.saveQueue.reset(new SaveQueue(queueLimits, camera.framePool.get(), &savePool.workEvent, options.holdBuffers));
+	if (!options.stages.empty())
+	{
+		camera.pipeline.reset(new FramePipeline());
+		for (size_t i = 0; i < options.stages.size(); i++)
+			camera.pipeline->AddStage(CreatePipelineStage(options.stages[i]));
+		camera.saveQueue->pipeline = camera.pipeline.get();
+	}
+	SaveLane lane = { camera.saveQueue.get(), &camera.saveOutput };
+	savePool.lanes.push_back(lane);
+
+	camera.preTriggerRing.reset(new PreTriggerRing(options.preTriggerFrames));
+}
+
+// streams one camera until a stop is requested (or, on a listener, until its
+// frames are saved) and hands frames to its save queue
+static void RunNativeCamera(CameraContext& camera, const Options& options, ControlThread& control);
+
+static void RunCamera(CameraContext& camera, const Options& options, ControlThread& control)
+{
+	if (camera.gvspReceiver)
+	{
+		RunNativeCamera(camera, options, control);
+		return;
+	}
+
+	Arena::IDevice* pDevice = camera.pDevice;
+	const std::string& outputDir = camera.outputDir;
+	const char* label = camera.label.c_str();
+	SaveQueue* saveQueue = camera.saveQueue.get();
+	FramePool& framePool = *camera.framePool;
+	PreTriggerRing& preTriggerRing = *camera.preTriggerRing;
+	FrameGapTracker& frameGaps = camera.frameGaps;
+	FrameIntervalTracker& frameIntervals = camera.frameIntervals;
+	LiveFrameStats& liveStats = camera.liveStats;
+
+	bool usePreTrigger = (options.preTriggerFrames > 0);
+	uint64_t preTriggerWindowNs = options.preTriggerMs * 1000000ull;
+	// pre-trigger frames always live in pool slots
+	size_t holdLimit = usePreTrigger ? 0 : options.holdBuffers;
+	// triggers are counted by the control thread; every camera acts on each
+	uint64_t seenTriggers = control.TriggerCount();
+
+	Arena::IImage* pImage = NULL;
+
+	PlaceThread(camera.placement, camera.label + "Acquisition");
+
+	AsyncLog& log = AsyncLog::Instance();
+	LogRateLimiter frameLogLimiter(options.logRate);
+	LogRateLimiter gapLogLimiter(options.logRate);
+
+	while (true)
+	{
+		// give buffers of finished held jobs back to the stream
+		if (camera.heldBuffers > 0)
+			camera.heldBuffers -= RequeueReleasedBuffers(pDevice, saveQueue);
+
+		// save the pre-trigger frames when a trigger arrived
+		if (usePreTrigger && control.TriggerCount() != seenTriggers)
+		{
+			seenTriggers = control.TriggerCount();
+			size_t flushed = FlushPreTrigger(saveQueue, preTriggerRing, outputDir, options.saveFormat, camera.traceTid, camera.preTriggerStats);
+			log.WriteWithText(LOG_INFO, 0, label, TAB1 "%tTrigger: saving %u pre-trigger frame(s)\n", flushed);
+		}
+
+		if (options.statsSec > 0 && std::chrono::steady_clock::now() >= liveStats.next)
+		{
+			LogLiveFrameStats(frameGaps, frameIntervals, camera.unreceivedImageCount, liveStats);
+			if (camera.shmRing)
+				LogShmReaders(*camera.shmRing, camera.shmLostLogged, label);
+			liveStats.next += liveStats.interval;
+		}
+
+		// get image
+		camera.imageCount++;
+		uint64_t requestedNs = TraceNowNs();
+		try
+		{
+			pImage = pDevice->GetImage(TIMEOUT);
+		}
+		catch (GenICam::TimeoutException&)
+		{
+			log.WriteWithText(LOG_WARN, 0, label, TAB2 "%tNo image received\n");
+			camera.unreceivedImageCount++;
+			if (control.StopRequested())
+				break;
+			continue;
+		}
+
+		uint64_t receivedNs = TraceNowNs();
+		uint64_t frameId = pImage->GetFrameId();
+		uint64_t timestampNs = pImage->GetTimestampNs();
+
+		camera.receivedBytes.fetch_add(pImage->GetSizeFilled(), std::memory_order_relaxed);
+
+		uint64_t lostBefore = 0;
+		FrameGapKind gapKind = frameGaps.Record(frameId, pImage->IsIncomplete(), lostBefore);
+		frameIntervals.Record(timestampNs, gapKind == FRAME_GAP_NONE);
+
+		// one copy for every local reader; never waits for them
+		if (camera.shmRing && !pImage->IsIncomplete())
+			PublishFrame(*camera.shmRing, pImage);
+
+		// what happened to the frame, for the log line below
+		const char* frameAction = "";
+		std::string savedName;
+		bool kept = false;
+		bool held = false;
+
+		if (usePreTrigger)
+		{
+			kept = KeepPreTriggerFrame(pImage, framePool, preTriggerRing, preTriggerWindowNs, camera.preTriggerStats);
+			if (!kept)
+				frameAction = " - not kept (frame pool busy)";
+		}
+		else if (camera.savedImageCount < options.saveFrames)
+		{
+			uint64_t bytes = pImage->GetSizeFilled();
+			SaveAdmission admission = ReserveSave(saveQueue, bytes);
+			if (admission == SAVE_ADMITTED)
+			{
+				SaveJob job;
+				job.trace.Reset(frameId, camera.traceTid);
+				job.trace.stamps[TRACE_REQUESTED] = requestedNs;
+				job.trace.stamps[TRACE_RECEIVED] = receivedNs;
+				job.trace.Mark(TRACE_ADMITTED);
+				job.bytes = bytes;
+				job.pImage = NULL;
+				job.pSlot = NULL;
+				job.pProcessed = NULL;
+				// Keep the SDK buffer while enough free ones remain; otherwise
+				// copy image data so the buffer can be requeued immediately.
+				held = camera.heldBuffers < holdLimit;
+				job.heldBuffer = held;
+				if (held)
+				{
+					job.pImage = pImage;
+					camera.heldBuffers++;
+					camera.copyStats.held++;
+					if (camera.heldBuffers > camera.copyStats.peakHeld)
+						camera.copyStats.peakHeld = camera.heldBuffers;
+				}
+				else if ((job.pSlot = framePool.TryAcquire(bytes)) != NULL)
+				{
+					CopyToSlot(pImage, job.pSlot);
+					camera.copyStats.slotCopies++;
+				}
+				else
+				{
+					try
+					{
+						job.pImage = Arena::ImageFactory::Copy(pImage);
+					}
+					catch (...)
+					{
+						ReleaseSave(saveQueue, bytes);
+						throw;
+					}
+					camera.copyStats.imageCopies++;
+				}
+				job.filename = MakeSaveFilename(outputDir, timestampNs, frameId, options.saveFormat);
+				job.trace.Mark(TRACE_COPIED);
+				EnqueueSave(saveQueue, job);
+				camera.savedImageCount++;
+				if (options.saveFormat == SAVE_FORMAT_RECORDING)
+				{
+					frameAction = " - recorded";
+				}
+				else
+				{
+					frameAction = " - saved: ";
+					savedName = job.filename.substr(outputDir.size() + 1);
+				}
+			}
+			else
+			{
+				frameAction = admission == SAVE_DROPPED_THINNED ? " - save dropped (thinned)" : " - save dropped (queue full)";
+			}
+		}
+
+		// requeue buffer, unless a save job holds it
+		if (!held)
+			pDevice->RequeueBuffer(pImage);
+
+		if (gapKind == FRAME_GAP_DROP || gapKind == FRAME_GAP_RESTART)
+		{
+			uint32_t gapsSuppressed = 0;
+			if (log.Enabled(LOG_WARN) && gapLogLimiter.Allow(gapsSuppressed))
+			{
+				if (gapKind == FRAME_GAP_DROP)
+					log.WriteWithText(LOG_WARN, gapsSuppressed, label, TAB2 "%tFrame gap: %u frame(s) lost before frame ID %u\n", lostBefore, frameId);
+				else
+					log.WriteWithText(LOG_WARN, gapsSuppressed, label, TAB2 "%tFrame ID restarted at %u\n", frameId);
+			}
+		}
+
+		// Print identifying information
+		//    Using the frame ID and timestamp allows for the comparison of
+		//    images between multiple hosts. The line is handed to the async
+		//    logger, so a slow terminal cannot stall acquisition.
+		uint32_t suppressed = 0;
+		if (log.Enabled(LOG_INFO) && frameLogLimiter.Allow(suppressed))
+		{
+			if (kept)
+				log.WriteWithText(LOG_INFO, suppressed, label, TAB2 "%tImage retrieved (frame ID %u; timestamp (ns): %u) - kept (%u pre-trigger) and requeue\n",
+					frameId, timestampNs, preTriggerRing.Size());
+			else
+				log.WriteWithTexts(LOG_INFO, suppressed, label, savedName.c_str(), TAB2 "%tImage retrieved (frame ID %u; timestamp (ns): %u)%s%t%s\n",
+					frameId, timestampNs, frameAction, held ? " (buffer held)" : " and requeue");
+		}
+
+		// a relaxed load; the control thread does the waiting
+		if (control.StopRequested())
+			break;
+
+		if (!camera.isMaster && !usePreTrigger && camera.savedImageCount >= options.saveFrames)
+			break;
+	}
+}
+
+// receives a listener's stream with the native GVSP receiver and hands
+// complete frames to its save queue in the slots they were assembled in
+static void RunNativeCamera(CameraContext& camera, const Options& options, ControlThread& control)
+{
+	const std::string& outputDir = camera.outputDir;
+	const char* label = camera.label.c_str();
+	SaveQueue* saveQueue = camera.saveQueue.get();
+	FramePool& framePool = *camera.framePool;
+	PreTriggerRing& preTriggerRing = *camera.preTriggerRing;
+	GvspReceiver& receiver = *camera.gvspReceiver;
+	LiveFrameStats& liveStats = camera.liveStats;
+
+	bool usePreTrigger = (options.preTriggerFrames > 0);
+	uint64_t preTriggerWindowNs = options.preTriggerMs * 1000000ull;
+	uint64_t seenTriggers = control.TriggerCount();
+
+	PlaceThread(camera.placement, camera.label + "Acquisition");
+
+	AsyncLog& log = AsyncLog::Instance();
+	LogRateLimiter frameLogLimiter(options.logRate);
+	LogRateLimiter gapLogLimiter(options.logRate);
+
+	std::vector<GvspFrame> frames;
+	std::chrono::steady_clock::time_point lastFrame = std::chrono::steady_clock::now();
+
+	while (!control.StopRequested())
+	{
+		// save the pre-trigger frames when a trigger arrived
+		if (usePreTrigger && control.TriggerCount() != seenTriggers)
+		{
+			seenTriggers = control.TriggerCount();
+			size_t flushed = FlushPreTrigger(saveQueue, preTriggerRing, outputDir, options.saveFormat, camera.traceTid, camera.preTriggerStats);
+			log.WriteWithText(LOG_INFO, 0, label, TAB1 "%tTrigger: saving %u pre-trigger frame(s)\n", flushed);
+		}
+
+		if (options.statsSec > 0 && std::chrono::steady_clock::now() >= liveStats.next)
+		{
+			LogLiveFrameStats(camera.frameGaps, camera.frameIntervals, camera.unreceivedImageCount, liveStats);
+			if (camera.shmRing)
+				LogShmReaders(*camera.shmRing, camera.shmLostLogged, label);
+			liveStats.next += liveStats.interval;
+		}
+
+		// receive whatever arrived, in recvmmsg batches
+		frames.clear();
+		uint64_t requestedNs = TraceNowNs();
+		receiver.Receive(NATIVE_GVSP_POLL_MS, frames);
+		if (frames.empty())
+		{
+			if (std::chrono::steady_clock::now() - lastFrame >= std::chrono::milliseconds(TIMEOUT))
+			{
+				log.WriteWithText(LOG_WARN, 0, label, TAB2 "%tNo image received\n");
+				camera.imageCount++;
+				camera.unreceivedImageCount++;
+				lastFrame = std::chrono::steady_clock::now();
+			}
+			continue;
+		}
+		lastFrame = std::chrono::steady_clock::now();
+
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			const GvspFrame& frame = frames[i];
+			FrameSlot* pSlot = frame.pSlot;
+			uint64_t frameId = frame.blockId;
+			uint64_t timestampNs = pSlot ? pSlot->timestampNs : 0;
+			camera.imageCount++;
+
+			if (frame.pSlot)
+				camera.receivedBytes.fetch_add(frame.pSlot->size, std::memory_order_relaxed);
+
+			uint64_t lostBefore = 0;
+			FrameGapKind gapKind = camera.frameGaps.Record(frameId, frame.incomplete, lostBefore);
+			if (timestampNs != 0)
+				camera.frameIntervals.Record(timestampNs, gapKind == FRAME_GAP_NONE);
+
+			// what happened to the frame, for the log line below
+			const char* frameAction = "";
+			std::string savedName;
+			bool kept = false;
+
+			if (!pSlot)
+			{
+				frameAction = " - not kept (frame pool busy)";
+			}
+			else if (frame.incomplete)
+			{
+				frameAction = " - incomplete, not saved";
+			}
+			else
+			{
+				if (camera.shmRing)
+					camera.shmRing->Publish(MakeRawFrameHeader(pSlot->width, pSlot->height, pSlot->bitsPerPixel, pSlot->pixelFormat, frameId, timestampNs,
+						pSlot->size), pSlot->data);
+
+				if (usePreTrigger)
+				{
+					KeepPreTriggerSlot(pSlot, framePool, preTriggerRing, preTriggerWindowNs, camera.preTriggerStats);
+					kept = true;
+					pSlot = NULL;
+				}
+				else if (camera.savedImageCount < options.saveFrames)
+				{
+					SaveAdmission admission = ReserveSave(saveQueue, pSlot->size);
+					if (admission == SAVE_ADMITTED)
+					{
+						// the frame was assembled in its slot; no copy
+						SaveJob job;
+						job.trace.Reset(frameId, camera.traceTid);
+						job.trace.stamps[TRACE_REQUESTED] = requestedNs;
+						job.trace.stamps[TRACE_RECEIVED] = frame.receivedNs;
+						job.trace.Mark(TRACE_ADMITTED);
+						job.bytes = pSlot->size;
+						job.pImage = NULL;
+						job.pSlot = pSlot;
+						job.pProcessed = NULL;
+						job.heldBuffer = false;
+						job.filename = MakeSaveFilename(outputDir, timestampNs, frameId, options.saveFormat);
+						job.trace.Mark(TRACE_COPIED);
+						EnqueueSave(saveQueue, job);
+						pSlot = NULL;
+						camera.savedImageCount++;
+						if (options.saveFormat == SAVE_FORMAT_RECORDING)
+						{
+							frameAction = " - recorded";
+						}
+						else
+						{
+							frameAction = " - saved: ";
+							savedName = job.filename.substr(outputDir.size() + 1);
+						}
+					}
+					else
+					{
+						frameAction = admission == SAVE_DROPPED_THINNED ? " - save dropped (thinned)" : " - save dropped (queue full)";
+					}
+				}
+			}
+
+			// release the slot unless a save job or the pre-trigger ring took it
+			if (pSlot)
+				framePool.Release(pSlot);
+
+			if (gapKind == FRAME_GAP_DROP || gapKind == FRAME_GAP_RESTART)
+			{
+				uint32_t gapsSuppressed = 0;
+				if (log.Enabled(LOG_WARN) && gapLogLimiter.Allow(gapsSuppressed))
+				{
+					if (gapKind == FRAME_GAP_DROP)
+						log.WriteWithText(LOG_WARN, gapsSuppressed, label, TAB2 "%tFrame gap: %u frame(s) lost before frame ID %u\n", lostBefore, frameId);
+					else
+						log.WriteWithText(LOG_WARN, gapsSuppressed, label, TAB2 "%tFrame ID restarted at %u\n", frameId);
+				}
+			}
+
+			uint32_t suppressed = 0;
+			if (log.Enabled(LOG_INFO) && frameLogLimiter.Allow(suppressed))
+			{
+				if (kept)
+					log.WriteWithText(LOG_INFO, suppressed, label, TAB2 "%tImage received (frame ID %u; timestamp (ns): %u) - kept (%u pre-trigger)\n",
+						frameId, timestampNs, preTriggerRing.Size());
+				else if (frame.incomplete)
+					log.WriteWithText(LOG_INFO, suppressed, label, TAB2 "%tImage received (frame ID %u; timestamp (ns): %u)%s (%u packets missing)\n",
+						frameId, timestampNs, frameAction, frame.missingPackets);
+				else
+					log.WriteWithTexts(LOG_INFO, suppressed, label, savedName.c_str(), TAB2 "%tImage received (frame ID %u; timestamp (ns): %u)%s%t\n",
+						frameId, timestampNs, frameAction);
+			}
+		}
+
+		if (!usePreTrigger && camera.savedImageCount >= options.saveFrames)
+			break;
+	}
 
-	// Prepare image parameters
-	//    An image's width, height, and bits per pixel are required to save to
-	//    disk. Its size and stride (i.e. pitch) can be calculated from those 3
-	//    inputs. Notice that an image's size and stride use bytes as a unit
-	//    while the bits per pixel uses bits.
-	std::cout << TAB1 << "Prepare image parameters\n";
+	// frames still being assembled are incomplete
+	frames.clear();
+	receiver.Flush(frames);
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		if (frames[i].pSlot)
+			framePool.Release(frames[i].pSlot);
+	}
+}
 
-	Save::ImageParams params(
-		pConverted->GetWidth(),
-		pConverted->GetHeight(),
-		pConverted->GetBitsPerPixel());
+static void RunCameraThread(CameraContext* camera, const Options* options, ControlThread* control)
+{
+	try
+	{
+		RunCamera(*camera, *options, *control);
+	}
+	catch (...)
+	{
+		// a failed camera ends the run, as it would with a single camera
+		camera->error = std::current_exception();
+		control->RequestStop();
+	}
+	camera->finished.store(true, std::memory_order_release);
+}
 
-	// Prepare image writer
-	//    The image writer requires 3 arguments to save an image: the image's
-	//    parameters, a specified file name or pattern, and the image data to
-	//    save. Providing these should result in a successfully saved file on the
-	//    disk. Because an image's parameters and file name pattern may repeat,
-	//    they can be passed into the image writer's constructor.
-	std::cout << TAB1 << "Prepare image writer\n";
+static void StopCamera(CameraContext& camera)
+{
+	if (camera.unreceivedImageCount == camera.imageCount)
+	{
+		std::cout << "\n" << camera.label << "No images were received, this can be caused by firewall or VPN settings\n";
+		std::cout << "Please add the application to firewall exception\n\n";
+	}
+	// held buffers are all released once the save workers have stopped
+	camera.heldBuffers -= RequeueReleasedBuffers(camera.pDevice, camera.saveQueue.get());
 
-	Save::ImageWriter writer(
-		params,
-		filename);
+	// stop stream
+	if (!camera.gvspReceiver)
+	{
+		std::cout << TAB1 << camera.label << "Stop stream\n";
 
-	// Save image
-	//    Passing image data into the image writer using the cascading I/O
-	//    operator (<<) triggers a save. Notice that the << operator accepts the
-	//    image data as a constant unsigned 8-bit integer pointer (const
-	//    uint8_t*) and the file name as a character string (const char*).
-	std::cout << TAB1 << "Save image\n";
+		camera.pDevice->StopStream();
+	}
 
-	writer << pConverted->GetData();
+	// frames still waiting for a trigger are not saved
+	camera.preTriggerDiscarded = camera.preTriggerRing->Size();
+	for (FrameSlot* pSlot = camera.preTriggerRing->PopOldest(); pSlot; pSlot = camera.preTriggerRing->PopOldest())
+		camera.framePool->Release(pSlot);
+}
 
-	// destroy converted image
-	Arena::ImageFactory::Destroy(pConverted);
+// returns the camera's nodes to their initial values
+static void RestoreCamera(CameraContext& camera)
+{
+	if (camera.isMaster)
+	{
+		Arena::SetNodeValue<GenICam::gcstring>(camera.pDevice->GetNodeMap(), "AcquisitionMode", camera.acquisitionModeInitial);
+	}
+	if (camera.streamDestinationSet)
+	{
+		Arena::SetNodeValue<int64_t>(camera.pDevice->GetNodeMap(), "GevSCDA", camera.streamDestinationInitial);
+		camera.streamDestinationSet = false;
+	}
 }
 
-void AcquireImages(Arena::IDevice* pDevice, const std::string& outputDir)
+// restores every camera on an error path, where the error being reported
+// matters more than a camera that no longer answers
+static void RestoreCameras(std::vector<std::unique_ptr<CameraContext> >& cameras)
 {
-	// get node values that will be changed in order to return their values at
-	// the end of the example
-	GenICam::gcstring acquisitionModeInitial = Arena::GetNodeValue<GenICam::gcstring>(pDevice->GetNodeMap(), "AcquisitionMode");
+	for (size_t i = 0; i < cameras.size(); i++)
+	{
+		try
+		{
+			RestoreCamera(*cameras[i]);
+		}
+		catch (...)
+		{
+		}
+	}
+}
 
-	// Enable multicast
-	//    Multicast must be enabled on both the master and listener. A small
-	//    number of transport layer features will remain writable even though a
-	//    device's access mode might be read-only.
-	std::cout << TAB1 << "Enable multicast\n";
+// prints a camera's statistics once the save workers are stopped, closes its
+// recording and restores its settings
+static void FinishCamera(CameraContext& camera, const Options& options)
+{
+	if (!camera.label.empty())
+		std::cout << TAB1 << "Camera " << camera.serial << " (" << camera.group << " on " << camera.interfaceName << ")\n";
+	camera.kernelDrops.Sample();
+	PrintFrameGapStats(camera.frameGaps, camera.unreceivedImageCount, camera.kernelDrops);
+	PrintFrameIntervalStats(camera.frameIntervals);
+	if (camera.liveStats.pStatsFile)
+	{
+		double elapsedSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - camera.liveStats.start).count();
+		WriteStatsRecord(camera.liveStats.pStatsFile, "final", camera.liveStats.camera, elapsedSec, camera.frameGaps, camera.frameIntervals.Total(),
+			camera.unreceivedImageCount, &camera.kernelDrops);
+	}
+	PrintSaveQueueStats(camera.saveQueue.get());
+	if (camera.pipeline)
+		PrintPipelineStats(*camera.pipeline);
+	if (camera.gvspReceiver)
+		PrintGvspReceiverStats(camera.gvspReceiver->Stats());
+	else
+		PrintFrameCopyStats(camera.copyStats, options.holdBuffers);
+	PrintFramePoolStats(*camera.framePool);
+	if (options.preTriggerFrames > 0)
+		PrintPreTriggerStats(camera.preTriggerStats, camera.preTriggerDiscarded);
+	if (camera.shmRing)
+	{
+		PrintShmRingStats(*camera.shmRing);
+		camera.shmRing->Close();
+	}
 
-	Arena::SetNodeValue<bool>(
-		pDevice->GetTLStreamNodeMap(),
-		"StreamMulticastEnable",
-		true);
+	if (camera.recording)
+	{
+		camera.recording->Close();
+		std::cout << TAB1 << "Recording: " << camera.recording->FramesWritten() << " frames, " << (camera.recording->BytesWritten() >> 20) << " MB in "
+				  << camera.recording->SegmentsClosed() << " segment(s)\n";
+	}
 
-	// Prepare settings on master, not on listener
-	//    Device features must be set on the master rather than the listener.
-	//    This is because the listener is opened with a read-only access mode.
-	GenICam::gcstring deviceAccessStatus = Arena::GetNodeValue<GenICam::gcstring>(
-		pDevice->GetTLDeviceNodeMap(),
-		"DeviceAccessStatus");
+	RestoreCamera(camera);
+}
 
-	// master
-	if (deviceAccessStatus == "ReadWrite")
-	{
-		std::cout << TAB1 << "Host streaming as 'master'\n";
+struct InterfaceReport
+{
+	// Cameras received through one interface, and the NIC's counters at the
+	// start and at the last report.
+	std::string name;
+	std::vector<const CameraContext*> cameras;
+	bool haveCounters;
+	NicCounters start;
+	NicCounters last;
+	uint64_t lastFrameBytes;
+};
 
-		// set acquisition mode
-		std::cout << TAB2 << "Set acquisition mode to 'Continuous'\n";
+static std::vector<InterfaceReport> CreateInterfaceReports(const std::vector<std::unique_ptr<CameraContext> >& cameras)
+{
+	std::vector<InterfaceReport> reports;
+	for (size_t i = 0; i < cameras.size(); i++)
+	{
+		size_t found = 0;
+		while (found < reports.size() && reports[found].name != cameras[i]->interfaceName)
+			found++;
+		if (found == reports.size())
+		{
+			InterfaceReport report;
+			report.name = cameras[i]->interfaceName;
+			report.haveCounters = ReadNicCounters(report.name, report.start);
+			report.last = report.start;
+			report.lastFrameBytes = 0;
+			reports.push_back(report);
+		}
+		reports[found].cameras.push_back(cameras[i].get());
+	}
+	return reports;
+}
 
-		Arena::SetNodeValue<GenICam::gcstring>(
-			pDevice->GetNodeMap(),
-			"AcquisitionMode",
-			"Continuous");
+static uint64_t GetInterfaceFrameBytes(const InterfaceReport& report)
+{
+	uint64_t bytes = 0;
+	for (size_t i = 0; i < report.cameras.size(); i++)
+		bytes += report.cameras[i]->receivedBytes.load(std::memory_order_relaxed);
+	return bytes;
+}
 
-		// enable stream auto negotiate packet size
-		Arena::SetNodeValue<bool>(pDevice->GetTLStreamNodeMap(), "StreamAutoNegotiatePacketSize", true);
+static void LogInterfaceThroughput(std::vector<InterfaceReport>& reports, double seconds)
+{
+	AsyncLog& log = AsyncLog::Instance();
+	for (size_t i = 0; i < reports.size(); i++)
+	{
+		InterfaceReport& report = reports[i];
+		uint64_t frameBytes = GetInterfaceFrameBytes(report);
+		double frameMBps = static_cast<double>(frameBytes - report.lastFrameBytes) / seconds / 1e6;
+		report.lastFrameBytes = frameBytes;
 
-		// enable stream packet resend
-		Arena::SetNodeValue<bool>(pDevice->GetTLStreamNodeMap(), "StreamPacketResendEnable", true);
+		NicCounters now;
+		if (report.haveCounters && ReadNicCounters(report.name, now))
+		{
+			log.WriteWithText(LOG_INFO, 0, report.name.c_str(),
+				TAB1 "Interface %t: %.1f MB/s of frames from %u camera(s), NIC %.1f MB/s, %u dropped (+%u), %u missed (+%u)\n", frameMBps,
+				report.cameras.size(), static_cast<double>(now.rxBytes - report.last.rxBytes) / seconds / 1e6, now.rxDropped - report.start.rxDropped,
+				now.rxDropped - report.last.rxDropped, now.rxMissed - report.start.rxMissed, now.rxMissed - report.last.rxMissed);
+			report.last = now;
+		}
+		else
+		{
+			log.WriteWithText(LOG_INFO, 0, report.name.c_str(), TAB1 "Interface %t: %.1f MB/s of frames from %u camera(s)\n", frameMBps,
+				report.cameras.size());
+		}
 	}
+}
 
-	// listener
-	else
+static void PrintInterfaceStats(const std::vector<InterfaceReport>& reports, double elapsedSec)
+{
+	std::ios::fmtflags flags = std::cout.flags();
+	std::streamsize precision = std::cout.precision();
+	std::cout << std::fixed << std::setprecision(1);
+	for (size_t i = 0; i < reports.size(); i++)
 	{
-		std::cout << TAB1 << "Host streaming as 'listener'\n";
-	}	
+		const InterfaceReport& report = reports[i];
+		uint64_t frameBytes = GetInterfaceFrameBytes(report);
+		std::cout << TAB1 << "Interface " << report.name << " (" << report.cameras.size() << " camera(s))\n";
+		std::cout << TAB2 << "frames: " << (frameBytes >> 20) << " MB, " << static_cast<double>(frameBytes) / elapsedSec / 1e6 << " MB/s\n";
 
-	// start stream
-	std::cout << TAB1 << "Start stream\n";
+		NicCounters now;
+		if (report.haveCounters && ReadNicCounters(report.name, now))
+		{
+			uint64_t rxBytes = now.rxBytes - report.start.rxBytes;
+			std::cout << TAB2 << "NIC received: " << (rxBytes >> 20) << " MB, " << static_cast<double>(rxBytes) / elapsedSec / 1e6 << " MB/s, "
+					  << now.rxPackets - report.start.rxPackets << " packets, " << now.rxDropped - report.start.rxDropped << " dropped, "
+					  << now.rxMissed - report.start.rxMissed << " missed\n";
+		}
+	}
+	std::cout.flags(flags);
+	std::cout.precision(precision);
+}
 
-	pDevice->StartStream();
+void AcquireImages(const std::vector<CameraDevice>& devices, const std::string& outputDir, const Options& options, ControlThread& control)
+{
+	size_t cameraCount = devices.size();
 
-	SaveQueue saveQueue;
-	saveQueue.stop = false;
-	std::thread saveThread(SaveWorker, &saveQueue);
-	SaveWorkerGuard saveGuard = { &saveQueue, &saveThread };
+	std::string cpuCapacities = DescribeCpuCapacities();
+	if (!cpuCapacities.empty())
+		std::cout << TAB1 << "CPUs: " << cpuCapacities << "\n";
 
-	TerminalGuard terminalGuard = { SetupTerminalForEsc() };
+	TraceFile traceFile;
+	if (options.traceFile)
+	{
+		traceFile.Open(options.traceFile);
+		std::cout << TAB1 << "Trace saved frames to " << options.traceFile << "\n";
+	}
+	TraceFile* pTraceFile = options.traceFile ? &traceFile : NULL;
 
-	// define image count to detect if all images are not received
-	int imageCount = 0;
-	int unreceivedImageCount = 0;
-	int savedImageCount = 0;
-	bool isMaster = (deviceAccessStatus == "ReadWrite");
+	StatsFile statsFile;
+	if (options.statsFile)
+	{
+		statsFile.out.open(options.statsFile, std::ios::out | std::ios::trunc);
+		if (!statsFile.out)
+			throw std::runtime_error(std::string("Failed to open stats file ") + options.statsFile + ": " + std::strerror(errno));
+	}
 
-	// get images
-	if (isMaster)
-		std::cout << TAB1 << "Getting images until ESC\n";
-	else
-		std::cout << TAB1 << "Getting images until 10 saves or ESC\n";
+	// Prepare cameras
+	//    With several cameras each one writes to a subdirectory named after its
+	//    serial number and its lines are prefixed with it. The cameras are
+	//    declared before the save worker guard, so the workers stop first.
+	std::vector<std::unique_ptr<CameraContext> > cameras;
+	SaveWorkerPool savePool;
+
+	// Acquisition CPUs by interface
+	//    With --acq-cpus nic, or by default once cameras are spread over
+	//    several interfaces, each acquisition thread runs on the CPUs that
+	//    handle its NIC's interrupts, so received data is still in their
+	//    caches. Cameras on one interface split those CPUs.
+	bool useNicCpus = options.acquisitionNicCpus;
+	for (size_t i = 1; i < cameraCount && options.acquisitionPlacement.cpus.empty(); i++)
+	{
+		if (devices[i].interfaceName != devices[0].interfaceName)
+			useNicCpus = true;
+	}
 
-	Arena::IImage* pImage = NULL;
+	// a camera that fails to prepare leaves the ones before it as masters
+	// with this run's settings; put them back
+	try
+	{
+		for (size_t i = 0; i < cameraCount; i++)
+		{
+			std::unique_ptr<CameraContext> camera(new CameraContext());
+			camera->pDevice = devices[i].pDevice;
+			camera->serial = devices[i].serial;
+			camera->group = devices[i].group;
+			camera->interfaceName = devices[i].interfaceName;
+			camera->address = devices[i].address;
+			camera->pMulticast = devices[i].pMulticast;
+			camera->outputDir = outputDir;
+			camera->traceTid = static_cast<uint32_t>(i);
+			camera->placement = options.acquisitionPlacement;
+			// with enough CPUs each camera gets its own share of the list
+			std::vector<int> acquisitionCpus = options.acquisitionPlacement.cpus;
+			size_t sharing = cameraCount;
+			size_t position = i;
+			if (useNicCpus)
+			{
+				acquisitionCpus = GetInterfaceIrqCpus(camera->interfaceName);
+				camera->placement.cpus = acquisitionCpus;
+				sharing = 0;
+				position = 0;
+				for (size_t j = 0; j < cameraCount; j++)
+				{
+					if (devices[j].interfaceName != camera->interfaceName)
+						continue;
+					if (j < i)
+						position++;
+					sharing++;
+				}
+			}
+			if (sharing > 1 && acquisitionCpus.size() >= sharing)
+			{
+				camera->placement.cpus.clear();
+				for (size_t j = position; j < acquisitionCpus.size(); j += sharing)
+					camera->placement.cpus.push_back(acquisitionCpus[j]);
+			}
+			if (cameraCount > 1)
+			{
+				camera->label = "[" + camera->serial + "] ";
+				camera->outputDir = outputDir + "/" + camera->serial;
+				if (!EnsureDir(camera->outputDir))
+					throw std::runtime_error("Failed to create output directory: " + camera->outputDir + " (" + std::strerror(errno) + ")");
+			}
+			if (pTraceFile)
+				pTraceFile->NameThread(camera->traceTid, cameraCount > 1 ? "acquisition " + camera->serial : std::string("acquisition"));
+			if (useNicCpus)
+			{
+				std::cout << TAB1 << camera->label << "Acquisition CPUs near " << camera->interfaceName << " IRQs: ";
+				if (camera->placement.cpus.empty())
+					std::cout << "none found, not pinned\n";
+				else
+					std::cout << FormatCpuList(camera->placement.cpus) << "\n";
+			}
 
-	bool escPressed = false;
+			cameras.push_back(std::move(camera));
+			PrepareCamera(*cameras.back(), options, cameraCount, savePool, pTraceFile);
+		}
+	}
+	catch (...)
+	{
+		RestoreCameras(cameras);
+		throw;
+	}
 
-	while (true)
+	// start streams
+	for (size_t i = 0; i < cameraCount && !options.nativeGvsp; i++)
 	{
-		// get image
-		imageCount++;
+		std::cout << TAB1 << cameras[i]->label << "Start stream";
+		if (options.streamBuffers > 0)
+		{
+			std::cout << " with " << options.streamBuffers << " buffers";
+			if (options.holdBuffers > 0)
+				std::cout << ", up to " << options.holdBuffers << " held by save jobs";
+			std::cout << "\n";
+			cameras[i]->pDevice->StartStream(options.streamBuffers);
+		}
+		else
+		{
+			std::cout << "\n";
+			cameras[i]->pDevice->StartStream();
+		}
+	}
+	if (options.holdBuffers > 0 && options.preTriggerFrames > 0)
+		std::cout << TAB1 << "--hold-buffers does not apply to pre-trigger frames\n";
+
+	std::cout << TAB1 << "Start " << options.saveWorkers << " save worker(s)";
+	if (cameraCount > 1)
+		std::cout << " shared by " << cameraCount << " cameras";
+	std::cout << "\n";
+	StartSaveWorkers(savePool, options.saveWorkers, pTraceFile, options.savePlacement);
+	SaveWorkerGuard saveGuard = { &savePool };
+
+	// ESC and the trigger key are read by the control thread
+	control.WatchStdin();
+	StdinWatchGuard stdinGuard = { &control };
+
+	// Prepare pre-trigger trigger source
+	//    Frames are kept in pool slots until a trigger hands them to the save
+	//    workers. The trigger socket is optional; the key and signal always work.
+	//    All three are watched by the control thread, and each trigger saves
+	//    the frames of every camera.
+	TriggerSource triggerSource;
+	if (options.preTriggerFrames > 0)
+	{
+		std::cout << TAB1 << "Keep the last " << options.preTriggerFrames << " frames";
+		if (cameraCount > 1)
+			std::cout << " per camera";
+		if (options.preTriggerMs > 0)
+			std::cout << " (at most " << options.preTriggerMs << " ms)";
+		std::cout << " until a trigger\n";
 		try
 		{
-			pImage = pDevice->GetImage(TIMEOUT);
+			triggerSource.Open(outputDir + "/" + TRIGGER_SOCKET_NAME);
+			control.WatchTriggerSocket(triggerSource.Fd());
+			std::cout << TAB2 << "Trigger with '" << TRIGGER_KEY << "', SIGUSR1 (pid " << getpid() << ") or a datagram to "
+					  << triggerSource.SocketPath() << "\n";
 		}
-		catch (GenICam::TimeoutException&)
+		catch (std::exception& ex)
+		{
+			std::cout << TAB2 << ex.what() << "\n";
+			std::cout << TAB2 << "Trigger with '" << TRIGGER_KEY << "' or SIGUSR1 (pid " << getpid() << ")\n";
+		}
+	}
+
+	// get images
+	for (size_t i = 0; i < cameraCount; i++)
+	{
+		CameraContext& camera = *cameras[i];
+		if (camera.isMaster || options.preTriggerFrames > 0)
+			std::cout << TAB1 << camera.label << "Getting images until ESC or SIGINT/SIGTERM\n";
+		else
+			std::cout << TAB1 << camera.label << "Getting images until " << options.saveFrames << " saves, ESC or SIGINT/SIGTERM\n";
+
+		LiveFrameStats& liveStats = camera.liveStats;
+		liveStats.start = std::chrono::steady_clock::now();
+		liveStats.interval = std::chrono::seconds(options.statsSec);
+		liveStats.next = liveStats.start + liveStats.interval;
+		liveStats.pStatsFile = options.statsFile ? &statsFile : NULL;
+		liveStats.label = camera.label.c_str();
+		liveStats.camera = cameraCount > 1 ? camera.serial.c_str() : "";
+
+		// Track kernel drops on the stream port
+		//    The SDK picks its port when the stream starts; the native
+		//    receiver already knows its own.
+		if (camera.streamPort == 0)
 		{
-			std::cout << TAB2 << "No image received\n";
-			unreceivedImageCount++;
-			if (CheckForEsc(terminalGuard.settings))
+			try
+			{
+				camera.streamPort = static_cast<uint16_t>(Arena::GetNodeValue<int64_t>(camera.pDevice->GetNodeMap(), "GevSCPHostPort"));
+			}
+			catch (GenICam::GenericException&)
 			{
-				escPressed = true;
-				break;
 			}
-			continue;
 		}
+		camera.kernelDrops.Start(camera.streamPort);
+		liveStats.pKernelDrops = &camera.kernelDrops;
+	}
 
-		// Print identifying information
-		//    Using the frame ID and timestamp allows for the comparison of
-		//    images between multiple hosts.
-		std::cout << TAB2 << "Image retrieved";
-
-		uint64_t frameId = pImage->GetFrameId();
-		uint64_t timestampNs = pImage->GetTimestampNs();
+	std::vector<InterfaceReport> interfaces = CreateInterfaceReports(cameras);
+	std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
 
-		std::cout << " (frame ID " << frameId << "; timestamp (ns): " << timestampNs << ")";
+	// One acquisition thread per camera, even with a single camera, so its
+	// placement never applies to the main thread.
+	std::vector<std::thread> threads;
+	try
+	{
+		for (size_t i = 0; i < cameraCount; i++)
+			threads.push_back(std::thread(RunCameraThread, cameras[i].get(), &options, &control));
+	}
+	catch (...)
+	{
+		control.RequestStop();
+		for (size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+		throw;
+	}
 
-		if (savedImageCount < 10)
+	// Report interface throughput until every camera is done
+	//    The acquisition threads only add up their frame bytes; main reads
+	//    the NIC counters.
+	std::chrono::steady_clock::time_point lastReport = runStart;
+	std::chrono::steady_clock::time_point nextReport = runStart + std::chrono::seconds(options.statsSec);
+	for (size_t i = 0; i < cameraCount;)
+	{
+		if (cameras[i]->finished.load(std::memory_order_acquire))
 		{
-			std::ostringstream filename;
-			filename << outputDir << "/" << timestampNs << "-" << frameId << ".png";
-			SaveJob job;
-			// Copy image data so the buffer can be requeued immediately.
-			job.pImage = Arena::ImageFactory::Copy(pImage);
-			job.filename = filename.str();
-			EnqueueSave(&saveQueue, job);
-			savedImageCount++;
-			std::cout << " - saved: " << filename.str();
+			i++;
+			continue;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(STATS_MAIN_POLL_MS));
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (options.statsSec > 0 && now >= nextReport)
+		{
+			LogInterfaceThroughput(interfaces, std::chrono::duration<double>(now - lastReport).count());
+			lastReport = now;
+			nextReport += std::chrono::seconds(options.statsSec);
 		}
+	}
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	double runSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
 
-		// requeue buffer
-		std::cout << " and requeue\n";
-		pDevice->RequeueBuffer(pImage);
+	// a failed camera thread is rethrown only once every stream is stopped,
+	// its held buffers are back and the settings are restored
+	std::exception_ptr threadError;
+	for (size_t i = 0; i < cameraCount && !threadError; i++)
+		threadError = cameras[i]->error;
 
-		if (CheckForEsc(terminalGuard.settings))
-			escPressed = true;
+	control.WatchTriggerSocket(-1);
+	AsyncLog::Instance().Flush();
 
-		if (escPressed)
-			break;
+	if (control.StopSignal() != 0)
+		std::cout << TAB1 << "Stopping on " << strsignal(control.StopSignal()) << "\n";
 
-		if (!isMaster && savedImageCount >= 10)
-			break;
+	// flush pending saves; held SDK buffers must be back before their
+	// stream stops, so then the workers finish first
+	if (options.holdBuffers > 0)
+	{
+		std::cout << TAB1 << "Flush save queue\n";
+		StopSaveWorkers(savePool);
 	}
 
-	if (unreceivedImageCount == imageCount)
+	for (size_t i = 0; i < cameraCount; i++)
 	{
-		std::cout << "\nNo images were received, this can be caused by firewall or VPN settings\n";
-		std::cout << "Please add the application to firewall exception\n\n";
+		try
+		{
+			StopCamera(*cameras[i]);
+		}
+		catch (...)
+		{
+			// the failed camera may no longer answer; stop the others
+			if (!threadError)
+				throw;
+		}
 	}
-	// stop stream
-	std::cout << TAB1 << "Stop stream\n";
 
-	pDevice->StopStream();
+	if (options.holdBuffers == 0)
+	{
+		std::cout << TAB1 << "Flush save queue\n";
+		StopSaveWorkers(savePool);
+	}
+	AsyncLog::Instance().Flush();
 
-	// return node to its initial value
-	if (deviceAccessStatus == "ReadWrite")
+	if (threadError)
 	{
-		Arena::SetNodeValue<GenICam::gcstring>(pDevice->GetNodeMap(), "AcquisitionMode", acquisitionModeInitial);
+		RestoreCameras(cameras);
+		std::rethrow_exception(threadError);
 	}
+	for (size_t i = 0; i < cameraCount; i++)
+		FinishCamera(*cameras[i], options);
+	PrintInterfaceStats(interfaces, runSec);
+	if (options.statsFile)
+		std::cout << TAB1 << "Frame statistics written to " << options.statsFile << "\n";
+	PrintSaveWorkerStats(savePool);
+	PrintStageLatency(savePool);
 }
 
 // =-=-=-=-=-=-=-=-=-
@@ -579,6 +3586,138 @@ void AcquireImages(Arena::IDevice* pDevice, const std::string& outputDir)
 // =- & CLEAN UP =-=-
 // =-=-=-=-=-=-=-=-=-
 
+struct CameraSelection
+{
+	Arena::DeviceInfo info;
+	std::string serial;
+	std::string group;
+	// empty for the interface given first on the command line
+	std::string interfaceName;
+};
+
+// Default multicast group of the camera at the given position: the base
+// group (--group) plus the index.
+static std::string GetCameraGroup(const char* baseGroup, size_t index)
+{
+	in_addr address;
+	inet_pton(AF_INET, baseGroup, &address);
+	address.s_addr = htonl(ntohl(address.s_addr) + static_cast<uint32_t>(index));
+	char text[INET_ADDRSTRLEN];
+	inet_ntop(AF_INET, &address, text, sizeof(text));
+	return text;
+}
+
+static bool IsGroupTaken(const std::vector<CameraSelection>& selections, const std::string& group)
+{
+	for (size_t i = 0; i < selections.size(); i++)
+	{
+		if (selections[i].group == group)
+			return true;
+	}
+	return false;
+}
+
+// Pick the devices named by --cameras: "all", or serial numbers separated by
+// commas, each optionally followed by @GROUP and %INTERFACE.
+static std::vector<CameraSelection> SelectCameras(const std::vector<Arena::DeviceInfo>& deviceInfos, const std::string& list, const char* baseGroup)
+{
+	std::vector<CameraSelection> selections;
+	if (list == "all")
+	{
+		for (size_t i = 0; i < deviceInfos.size(); i++)
+		{
+			CameraSelection selection = { deviceInfos[i], deviceInfos[i].SerialNumber().c_str(), GetCameraGroup(baseGroup, i), "" };
+			selections.push_back(selection);
+		}
+	}
+	else
+	{
+		std::istringstream entries(list);
+		std::string entry;
+		while (std::getline(entries, entry, ','))
+		{
+			if (entry.empty())
+				continue;
+			std::string interfaceName;
+			size_t percent = entry.find('%');
+			if (percent != std::string::npos)
+			{
+				interfaceName = entry.substr(percent + 1);
+				entry.erase(percent);
+			}
+			size_t at = entry.find('@');
+			std::string serial = entry.substr(0, at);
+			// cameras without @GROUP get theirs once all explicit groups are known
+			std::string group;
+			if (at != std::string::npos)
+			{
+				group = entry.substr(at + 1);
+				in_addr address;
+				if (inet_pton(AF_INET, group.c_str(), &address) != 1 || !IN_MULTICAST(ntohl(address.s_addr)))
+					throw std::runtime_error("Invalid multicast group for camera " + serial + ": " + group);
+				char text[INET_ADDRSTRLEN];
+				inet_ntop(AF_INET, &address, text, sizeof(text));
+				group = text;
+				if (IsGroupTaken(selections, group))
+					throw std::runtime_error("Multicast group " + group + " given to more than one camera");
+			}
+			if (!interfaceName.empty() && if_nametoindex(interfaceName.c_str()) == 0)
+				throw std::runtime_error("Invalid interface for camera " + serial + ": " + interfaceName);
+			for (size_t i = 0; i < selections.size(); i++)
+			{
+				if (selections[i].serial == serial)
+					throw std::runtime_error("Camera listed twice: " + serial);
+			}
+
+			size_t found = deviceInfos.size();
+			for (size_t i = 0; i < deviceInfos.size() && found == deviceInfos.size(); i++)
+			{
+				if (serial == deviceInfos[i].SerialNumber().c_str())
+					found = i;
+			}
+			if (found == deviceInfos.size())
+				throw std::runtime_error("Camera not found: " + serial);
+
+			CameraSelection selection = { deviceInfos[found], serial, group, interfaceName };
+			selections.push_back(selection);
+		}
+
+		// Default groups
+		//    Two cameras on one group would reach every listener of either,
+		//    so defaults skip the groups already taken.
+		for (size_t i = 0; i < selections.size(); i++)
+		{
+			if (!selections[i].group.empty())
+				continue;
+			std::string group;
+			for (size_t index = i; group.empty(); index++)
+			{
+				std::string candidate = GetCameraGroup(baseGroup, index);
+				if (!IsGroupTaken(selections, candidate))
+					group = candidate;
+			}
+			in_addr address;
+			inet_pton(AF_INET, group.c_str(), &address);
+			if (!IN_MULTICAST(ntohl(address.s_addr)))
+				throw std::runtime_error("No multicast group left after " + std::string(baseGroup) + " for camera " + selections[i].serial);
+			selections[i].group = group;
+		}
+	}
+	if (selections.empty())
+		throw std::runtime_error("No cameras selected: " + list);
+
+	std::cout << "\n" << TAB1 << "Selected " << selections.size() << " camera(s):\n";
+	for (size_t i = 0; i < selections.size(); i++)
+	{
+		const Arena::DeviceInfo& info = selections[i].info;
+		std::cout << TAB2 << info.ModelName() << TAB1 << info.SerialNumber() << TAB1 << info.IpAddressStr() << TAB1 << "group " << selections[i].group;
+		if (!selections[i].interfaceName.empty())
+			std::cout << " on " << selections[i].interfaceName;
+		std::cout << "\n";
+	}
+	return selections;
+}
+
 Arena::DeviceInfo SelectDevice(std::vector<Arena::DeviceInfo>& deviceInfos)
 {
 	if (deviceInfos.size() == 1)
@@ -627,15 +3766,26 @@ int main(int argc, char** argv)
 
 	if (argc < 2)
 	{
-		std::cout << "\nUsage: " << argv[0] << " <interface>\n";
-		std::cout << "Example: " << argv[0] << " eno1\n";
+		PrintUsage(argv[0]);
 		return 0;
 	}
 
-	const char* interfaceName = argv[1];
+	// Stop and trigger signals are read by the control thread; block them
+	// before any other thread exists so every thread inherits the mask.
+	BlockControlSignals();
 
 	try
 	{
+		Options options = ParseOptions(argc, argv);
+		const char* interfaceName = options.interfaceName;
+
+		AsyncLog::Instance().SetLevel(options.logLevel);
+		AsyncLog::Instance().Start();
+		LogGuard logGuard;
+
+		ControlThread control(TRIGGER_KEY);
+		control.Start();
+
 		// prepare example
 		Arena::ISystem* pSystem = Arena::OpenSystem();
 		pSystem->UpdateDevices(100);
@@ -646,23 +3796,62 @@ int main(int argc, char** argv)
 			std::getchar();
 			return 0;
 		}
-		Arena::DeviceInfo selectedDeviceInfo = SelectDevice(deviceInfos);
-		Arena::IDevice* pDevice = pSystem->CreateDevice(selectedDeviceInfo);
+		std::vector<CameraSelection> selections;
+		if (options.cameras)
+		{
+			selections = SelectCameras(deviceInfos, options.cameras, options.group);
+		}
+		else
+		{
+			CameraSelection selection = { SelectDevice(deviceInfos), "", options.group, "" };
+			selection.serial = selection.info.SerialNumber().c_str();
+			selections.push_back(selection);
+		}
+
+		std::vector<CameraDevice> devices;
+		for (size_t i = 0; i < selections.size(); i++)
+		{
+			const std::string& cameraInterface = selections[i].interfaceName;
+			CameraDevice device = { pSystem->CreateDevice(selections[i].info), selections[i].serial, selections[i].group,
+				cameraInterface.empty() ? std::string(interfaceName) : cameraInterface, selections[i].info.IpAddress(), NULL };
+			devices.push_back(device);
+		}
 
 		std::string outputDir = CreateOutputDir();
 		std::cout << TAB1 << "Output directory: " << outputDir << "\n";
 
-		std::cout << TAB1 << "Join multicast group " << MULTICAST_GROUP_IP << " on " << interfaceName << "\n";
-		MulticastGuard multicastGuard;
-		multicastGuard.Join(interfaceName);
+		std::vector<std::unique_ptr<MulticastGuard> > multicastGuards;
+		for (size_t i = 0; i < devices.size(); i++)
+		{
+			// the camera's own address is the only sender of its stream
+			std::string source;
+			if (options.sourceSpecific)
+				source = selections[i].info.IpAddressStr().c_str();
+
+			std::cout << TAB1 << "Join multicast group " << devices[i].group;
+			if (!source.empty())
+				std::cout << " for source " << source;
+			std::cout << " on " << devices[i].interfaceName << "\n";
+			multicastGuards.push_back(std::unique_ptr<MulticastGuard>(new MulticastGuard()));
+			multicastGuards.back()->Join(devices[i].interfaceName.c_str(), devices[i].group, source);
+			devices[i].pMulticast = multicastGuards.back().get();
+		}
 
 		// run example
 		std::cout << "Commence example\n\n";
-		AcquireImages(pDevice, outputDir);
+		if (!control.StopRequested())
+			AcquireImages(devices, outputDir, options, control);
 		std::cout << "\nExample complete\n";
 
 		// clean up example
-		pSystem->DestroyDevice(pDevice);
+		for (size_t i = 0; i < multicastGuards.size(); i++)
+		{
+			int error = multicastGuards[i]->Leave();
+			if (error != 0)
+				std::cout << TAB1 << "Failed to leave multicast group " << devices[i].group << ": " << std::strerror(error) << "\n";
+		}
+		for (size_t i = 0; i < devices.size(); i++)
+			pSystem->DestroyDevice(devices[i].pDevice);
 		Arena::CloseSystem(pSystem);
 	}
 	catch (GenICam::GenericException& ge)
@@ -681,6 +3870,8 @@ int main(int argc, char** argv)
 		exceptionThrown = true;
 	}
 
+	UnblockControlSignals();
+
 	std::cout << "Press enter to complete\n";
 	std::cin.ignore();
 	std::getchar();
@@ -0,0 +1,182 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-=- DIRECT I/O -=-=-=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// O_DIRECT writes bypass the page cache, so a sustained recording does not
+// build up gigabytes of dirty pages that the kernel later flushes in long
+// stalls. The price is that every write must use an aligned file offset,
+// length and memory address. 4096 satisfies both 512-byte and 4K-sector
+// devices. Frame pool slots and recording records are already aligned;
+// anything else is staged through a per-thread bounce buffer.
+#define DIRECT_IO_ALIGNMENT 4096
+#define DIRECT_IO_BOUNCE_BYTES (1 << 20)
+
+inline bool IsDirectAligned(uint64_t value)
+{
+	return (value & (DIRECT_IO_ALIGNMENT - 1)) == 0;
+}
+
+// Aligned staging buffer for data that cannot be written in place.
+class DirectBounce
+{
+public:
+	DirectBounce()
+		: data(NULL)
+		, used(0)
+	{
+		void* buffer = NULL;
+		if (posix_memalign(&buffer, DIRECT_IO_ALIGNMENT, DIRECT_IO_BOUNCE_BYTES) == 0)
+			data = static_cast<uint8_t*>(buffer);
+	}
+
+	~DirectBounce()
+	{
+		std::free(data);
+	}
+
+	uint8_t* data;
+	size_t used;
+
+private:
+	DirectBounce(const DirectBounce&);
+	DirectBounce& operator=(const DirectBounce&);
+};
+
+// Bounce buffer owned by the calling thread, allocated on first use.
+inline DirectBounce& GetThreadBounce()
+{
+	static thread_local DirectBounce bounce;
+	return bounce;
+}
+
+// Write a whole buffer at an aligned offset, retrying short writes and EINTR.
+// Returns 0 or an errno value.
+inline int WriteDirectBlock(int fd, const uint8_t* pData, size_t bytes, uint64_t offset)
+{
+	while (bytes > 0)
+	{
+		ssize_t written = pwrite(fd, pData, bytes, static_cast<off_t>(offset));
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		if (written == 0)
+			return EIO;
+		pData += written;
+		bytes -= static_cast<size_t>(written);
+		offset += static_cast<uint64_t>(written);
+	}
+	return 0;
+}
+
+// Write an iovec list at an aligned offset on an O_DIRECT descriptor.
+// Aligned runs of the source go straight to the device; the rest is copied
+// into the thread's bounce buffer and written in aligned chunks. If the total
+// length is not a multiple of DIRECT_IO_ALIGNMENT, the last block is written
+// zero padded and the file is then truncated to offset + total, so an
+// unaligned tail is only allowed at the end of the file. Returns 0 or an
+// errno value.
+inline int WriteDirectAt(int fd, const iovec* parts, int count, uint64_t offset)
+{
+	DirectBounce& bounce = GetThreadBounce();
+	if (!bounce.data)
+		return ENOMEM;
+	bounce.used = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		const uint8_t* pSource = static_cast<const uint8_t*>(parts[i].iov_base);
+		size_t remaining = parts[i].iov_len;
+		while (remaining > 0)
+		{
+			size_t direct = remaining & ~static_cast<size_t>(DIRECT_IO_ALIGNMENT - 1);
+			if (bounce.used == 0 && direct > 0 && IsDirectAligned(reinterpret_cast<uintptr_t>(pSource)))
+			{
+				int error = WriteDirectBlock(fd, pSource, direct, offset);
+				if (error != 0)
+					return error;
+				pSource += direct;
+				remaining -= direct;
+				offset += direct;
+				continue;
+			}
+
+			// stage until the bounce buffer is full or reaches an aligned
+			// length, then flush so aligned source data can go direct again
+			size_t room = DIRECT_IO_BOUNCE_BYTES - bounce.used;
+			size_t toAligned = DIRECT_IO_ALIGNMENT - (bounce.used & (DIRECT_IO_ALIGNMENT - 1));
+			size_t copy = remaining;
+			if (copy > room)
+				copy = room;
+			if (bounce.used & (DIRECT_IO_ALIGNMENT - 1) && copy > toAligned)
+				copy = toAligned;
+			std::memcpy(bounce.data + bounce.used, pSource, copy);
+			bounce.used += copy;
+			pSource += copy;
+			remaining -= copy;
+
+			if (IsDirectAligned(bounce.used))
+			{
+				int error = WriteDirectBlock(fd, bounce.data, bounce.used, offset);
+				if (error != 0)
+					return error;
+				offset += bounce.used;
+				bounce.used = 0;
+			}
+		}
+	}
+
+	if (bounce.used > 0)
+	{
+		size_t tail = bounce.used;
+		size_t padded = (tail + DIRECT_IO_ALIGNMENT - 1) & ~static_cast<size_t>(DIRECT_IO_ALIGNMENT - 1);
+		std::memset(bounce.data + tail, 0, padded - tail);
+		int error = WriteDirectBlock(fd, bounce.data, padded, offset);
+		bounce.used = 0;
+		if (error != 0)
+			return error;
+		if (ftruncate(fd, static_cast<off_t>(offset + tail)) != 0)
+			return errno;
+	}
+	return 0;
+}
+
+// Check whether files in a directory can be opened with O_DIRECT (tmpfs and
+// some network filesystems refuse it). Returns 0 or an errno value.
+inline int ProbeDirectIo(const std::string& directory)
+{
+	std::string path = directory + "/.direct-io-probe";
+	int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+	int error = fd < 0 ? errno : 0;
+	if (fd >= 0)
+		close(fd);
+	unlink(path.c_str());
+	return error;
+}
@@ -0,0 +1,494 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include "LatencyHistogram.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-= PIPELINE FRAME -=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// The frame a pipeline stage works on. It starts as a read-only view of the
+// saved frame; a stage that transforms it writes its result into a buffer
+// from Replace, and later stages and the save see the new pixels. One frame
+// object is reused per worker, so the buffers are only allocated once.
+struct PipelineFrame
+{
+	const uint8_t* data;
+	size_t size;
+	size_t width;
+	size_t height;
+	size_t bitsPerPixel;
+	uint64_t pixelFormat;
+	uint64_t frameId;
+	uint64_t timestampNs;
+
+	PipelineFrame()
+		: data(NULL)
+		, size(0)
+		, width(0)
+		, height(0)
+		, bitsPerPixel(0)
+		, pixelFormat(0)
+		, frameId(0)
+		, timestampNs(0)
+		, current(-1)
+	{
+	}
+
+	// Start a new frame viewing the given pixels.
+	void Reset(const uint8_t* pixels, size_t bytes, size_t frameWidth, size_t frameHeight, size_t bits, uint64_t format, uint64_t id, uint64_t timestamp)
+	{
+		data = pixels;
+		size = bytes;
+		width = frameWidth;
+		height = frameHeight;
+		bitsPerPixel = bits;
+		pixelFormat = format;
+		frameId = id;
+		timestampNs = timestamp;
+		current = -1;
+	}
+
+	// Return a buffer of the given size that becomes the frame's data. The
+	// previous data stays valid until the next call, so keep a pointer to it
+	// before calling. The caller updates the geometry fields.
+	uint8_t* Replace(size_t bytes)
+	{
+		current = current == 0 ? 1 : 0;
+		std::vector<uint8_t>& buffer = buffers[current];
+		if (buffer.size() < bytes)
+			buffer.resize(bytes);
+		data = buffer.data();
+		size = bytes;
+		return buffer.data();
+	}
+
+	// True once a stage has replaced the original pixels.
+	bool Transformed() const
+	{
+		return current >= 0;
+	}
+
+private:
+	std::vector<uint8_t> buffers[2];
+	int current;
+};
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-= PIPELINE STAGES -=-=
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+enum StageOrder
+{
+	// How a stage may be run by several save workers.
+	STAGE_UNORDERED, // frames run concurrently, in any order
+	STAGE_ORDERED    // one frame at a time, in the order frames were queued
+};
+
+// One step of frame processing, run on the save workers between dequeue and
+// the save. Unordered stages must be thread-safe; ordered stages are never
+// entered by two workers at once and see frames in queue order, so they may
+// keep state across frames without locking.
+class PipelineStage
+{
+public:
+	virtual ~PipelineStage()
+	{
+	}
+
+	virtual const char* Name() const = 0;
+
+	virtual StageOrder Order() const
+	{
+		return STAGE_UNORDERED;
+	}
+
+	// Process one frame. Return false to drop it: later stages and the save
+	// are skipped. May throw, which fails the frame's save job.
+	virtual bool Process(PipelineFrame& frame) = 0;
+
+	// One-line summary printed at shutdown, after the workers have stopped.
+	virtual std::string Summary() const
+	{
+		return std::string();
+	}
+};
+
+// Admits frames to an ordered stage in sequence order. Frames that will
+// never reach the stage are passed with Done too, so later ones go on.
+class StageSequencer
+{
+public:
+	StageSequencer()
+		: next(0)
+	{
+	}
+
+	void WaitTurn(uint64_t sequence)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (next != sequence)
+			turn.wait(lock);
+	}
+
+	void Done(uint64_t sequence)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (sequence != next)
+			{
+				// finished ahead of its turn (skipped); remembered until reached
+				finished.insert(sequence);
+				return;
+			}
+			next++;
+			while (!finished.empty() && *finished.begin() == next)
+			{
+				finished.erase(finished.begin());
+				next++;
+			}
+		}
+		turn.notify_all();
+	}
+
+private:
+	std::mutex mutex;
+	std::condition_variable turn;
+	uint64_t next;
+	std::set<uint64_t> finished;
+};
+
+// Ordered chain of stages for one camera's frames. Every queued frame must
+// go through Run or Skip exactly once, with sequence numbers 0, 1, 2, ...
+// in queue order, so ordered stages never wait for a frame that is gone.
+class FramePipeline
+{
+public:
+	// Takes ownership of the stage.
+	void AddStage(PipelineStage* stage)
+	{
+		std::unique_ptr<Entry> entry(new Entry());
+		entry->stage.reset(stage);
+		if (stage->Order() == STAGE_ORDERED)
+			entry->sequencer.reset(new StageSequencer());
+		entry->dropped = 0;
+		entries.push_back(std::move(entry));
+	}
+
+	bool Empty() const
+	{
+		return entries.empty();
+	}
+
+	// Run every stage on a frame. Returns false if a stage dropped it.
+	bool Run(PipelineFrame& frame, uint64_t sequence)
+	{
+		size_t i = 0;
+		try
+		{
+			for (; i < entries.size(); i++)
+			{
+				Entry& entry = *entries[i];
+				uint64_t waitNs = 0;
+				if (entry.sequencer)
+				{
+					uint64_t begin = NowNs();
+					entry.sequencer->WaitTurn(sequence);
+					waitNs = NowNs() - begin;
+				}
+
+				uint64_t begin = NowNs();
+				bool keep = false;
+				try
+				{
+					keep = entry.stage->Process(frame);
+				}
+				catch (...)
+				{
+					if (entry.sequencer)
+						entry.sequencer->Done(sequence);
+					throw;
+				}
+				uint64_t runNs = NowNs() - begin;
+				if (entry.sequencer)
+					entry.sequencer->Done(sequence);
+
+				std::lock_guard<std::mutex> lock(entry.statsMutex);
+				entry.run.Record(runNs);
+				if (entry.sequencer)
+					entry.wait.Record(waitNs);
+				if (!keep)
+				{
+					entry.dropped++;
+					break;
+				}
+			}
+		}
+		catch (...)
+		{
+			SkipFrom(i + 1, sequence);
+			throw;
+		}
+
+		if (i == entries.size())
+			return true;
+		SkipFrom(i + 1, sequence);
+		return false;
+	}
+
+	// Pass a frame that never reaches the pipeline, e.g. evicted from the queue.
+	void Skip(uint64_t sequence)
+	{
+		SkipFrom(0, sequence);
+	}
+
+	// Reporting; call after the workers have stopped.
+	size_t StageCount() const
+	{
+		return entries.size();
+	}
+
+	const PipelineStage& Stage(size_t index) const
+	{
+		return *entries[index]->stage;
+	}
+
+	// time spent in Process
+	const LatencyHistogram& RunLatency(size_t index) const
+	{
+		return entries[index]->run;
+	}
+
+	// time ordered stages waited for the frame's turn
+	const LatencyHistogram& WaitLatency(size_t index) const
+	{
+		return entries[index]->wait;
+	}
+
+	uint64_t Dropped(size_t index) const
+	{
+		return entries[index]->dropped;
+	}
+
+private:
+	struct Entry
+	{
+		std::unique_ptr<PipelineStage> stage;
+		std::unique_ptr<StageSequencer> sequencer;
+		// guards the timing below; recorded once per frame and stage
+		std::mutex statsMutex;
+		LatencyHistogram run;
+		LatencyHistogram wait;
+		uint64_t dropped;
+	};
+
+	static uint64_t NowNs()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	void SkipFrom(size_t first, uint64_t sequence)
+	{
+		for (size_t i = first; i < entries.size(); i++)
+		{
+			if (entries[i]->sequencer)
+				entries[i]->sequencer->Done(sequence);
+		}
+	}
+
+	std::vector<std::unique_ptr<Entry> > entries;
+};
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-= BUILT-IN STAGES -=-=
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// crop=X,Y,W,H: keep a region of interest. Unordered. Needs whole-byte
+// pixels; the region is clipped to the frame.
+class CropStage : public PipelineStage
+{
+public:
+	CropStage(size_t x, size_t y, size_t width, size_t height)
+		: x(x)
+		, y(y)
+		, width(width)
+		, height(height)
+	{
+	}
+
+	const char* Name() const
+	{
+		return "crop";
+	}
+
+	bool Process(PipelineFrame& frame)
+	{
+		if (frame.bitsPerPixel == 0 || frame.bitsPerPixel % 8 != 0)
+			throw std::runtime_error("crop needs whole-byte pixels");
+		if (x >= frame.width || y >= frame.height)
+			return false;
+
+		size_t pixelBytes = frame.bitsPerPixel / 8;
+		size_t sourceStride = frame.width * pixelBytes;
+		size_t cropWidth = x + width > frame.width ? frame.width - x : width;
+		size_t cropHeight = y + height > frame.height ? frame.height - y : height;
+		size_t rowBytes = cropWidth * pixelBytes;
+
+		const uint8_t* source = frame.data;
+		uint8_t* target = frame.Replace(rowBytes * cropHeight);
+		for (size_t row = 0; row < cropHeight; row++)
+			std::memcpy(target + row * rowBytes, source + (y + row) * sourceStride + x * pixelBytes, rowBytes);
+		frame.width = cropWidth;
+		frame.height = cropHeight;
+		return true;
+	}
+
+private:
+	size_t x;
+	size_t y;
+	size_t width;
+	size_t height;
+};
+
+// stats: mean pixel level of every frame, and the largest change between
+// consecutive frames (e.g. to spot exposure jumps or a covered lens).
+// Ordered, so "consecutive" follows the queue order. 8- and 16-bit
+// samples only; colour channels are averaged together.
+class LevelStatsStage : public PipelineStage
+{
+public:
+	LevelStatsStage()
+		: frames(0)
+		, sumLevel(0.0)
+		, minLevel(0.0)
+		, maxLevel(0.0)
+		, lastLevel(0.0)
+		, maxChange(0.0)
+		, maxChangeFrameId(0)
+	{
+	}
+
+	const char* Name() const
+	{
+		return "stats";
+	}
+
+	StageOrder Order() const
+	{
+		return STAGE_ORDERED;
+	}
+
+	bool Process(PipelineFrame& frame)
+	{
+		double level = MeanLevel(frame);
+		if (frames == 0 || level < minLevel)
+			minLevel = level;
+		if (frames == 0 || level > maxLevel)
+			maxLevel = level;
+		double change = level > lastLevel ? level - lastLevel : lastLevel - level;
+		if (frames > 0 && change > maxChange)
+		{
+			maxChange = change;
+			maxChangeFrameId = frame.frameId;
+		}
+		lastLevel = level;
+		sumLevel += level;
+		frames++;
+		return true;
+	}
+
+	std::string Summary() const
+	{
+		std::ostringstream out;
+		out.setf(std::ios::fixed);
+		out.precision(1);
+		out << frames << " frames, mean level " << (frames ? sumLevel / frames : 0.0) << " (min " << minLevel << ", max " << maxLevel
+			<< "), largest change " << maxChange << " at frame ID " << maxChangeFrameId;
+		return out.str();
+	}
+
+private:
+	static double MeanLevel(const PipelineFrame& frame)
+	{
+		size_t pixels = frame.width * frame.height;
+		if (pixels == 0)
+			return 0.0;
+		// Mono16, RGB16 and RGBa16; 24- and 32-bit formats have 8-bit channels
+		if (frame.bitsPerPixel == 16 || frame.bitsPerPixel == 48 || frame.bitsPerPixel == 64)
+		{
+			size_t samples = frame.size / 2;
+			const uint16_t* p = reinterpret_cast<const uint16_t*>(frame.data);
+			uint64_t sum = 0;
+			for (size_t i = 0; i < samples; i++)
+				sum += p[i];
+			return samples ? static_cast<double>(sum) / samples : 0.0;
+		}
+		if (frame.bitsPerPixel % 8 == 0)
+		{
+			uint64_t sum = 0;
+			for (size_t i = 0; i < frame.size; i++)
+				sum += frame.data[i];
+			return frame.size ? static_cast<double>(sum) / frame.size : 0.0;
+		}
+		throw std::runtime_error("stats needs 8- or 16-bit samples");
+	}
+
+	uint64_t frames;
+	double sumLevel;
+	double minLevel;
+	double maxLevel;
+	double lastLevel;
+	double maxChange;
+	uint64_t maxChangeFrameId;
+};
+
+// Create a built-in stage from a --stage value: "crop=X,Y,W,H" or "stats".
+// Throws on an unknown or malformed spec.
+inline PipelineStage* CreatePipelineStage(const std::string& spec)
+{
+	if (spec == "stats")
+		return new LevelStatsStage();
+
+	if (spec.compare(0, 5, "crop=") == 0)
+	{
+		size_t values[4];
+		const char* p = spec.c_str() + 5;
+		for (int i = 0; i < 4; i++)
+		{
+			char* end = NULL;
+			unsigned long long value = std::strtoull(p, &end, 10);
+			if (end == p || *end != (i < 3 ? ',' : '\0') || (i >= 2 && value == 0))
+				throw std::runtime_error("Invalid stage: " + spec + " (expected crop=X,Y,W,H)");
+			values[i] = static_cast<size_t>(value);
+			p = end + 1;
+		}
+		return new CropStage(values[0], values[1], values[2], values[3]);
+	}
+
+	throw std::runtime_error("Unknown stage: " + spec);
+}
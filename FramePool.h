@@ -0,0 +1,195 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include "BoundedRing.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+// Slot sizes are rounded up to this so every slot start and length is valid
+// for O_DIRECT and buffer registration, even with 16K/64K ARM64 pages.
+#define FRAME_POOL_ALIGNMENT 4096
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-= FRAME BUFFER POOL =-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+struct FrameSlot
+{
+	// Page-aligned frame storage plus the image fields needed to save it.
+	uint8_t* data;
+	size_t capacity;
+	size_t size;
+	size_t width;
+	size_t height;
+	size_t bitsPerPixel;
+	uint64_t pixelFormat;
+	uint64_t frameId;
+	uint64_t timestampNs;
+	uint32_t index;
+};
+
+// Fixed set of frame slots carved out of one pre-faulted mapping. Acquire is
+// called by the acquisition thread, Release by any save worker; neither
+// allocates or takes a lock.
+class FramePool
+{
+public:
+	FramePool(size_t slotCount, size_t slotBytes)
+		: freeSlots(slotCount)
+		, slots(slotCount)
+		, region(NULL)
+		, regionBytes(0)
+		, slotStride(RoundUp(slotBytes < 1 ? 1 : slotBytes))
+		, inUse(0)
+		, peakInUse(0)
+		, acquiredCount(0)
+		, exhaustedCount(0)
+		, oversizeCount(0)
+	{
+		regionBytes = slotStride * slotCount;
+		// MAP_POPULATE faults the pages in now rather than on the first frames
+		void* mapping = mmap(NULL, regionBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+		if (mapping == MAP_FAILED)
+			throw std::runtime_error(std::string("Failed to allocate frame pool: ") + std::strerror(errno));
+		region = static_cast<uint8_t*>(mapping);
+
+		for (size_t i = 0; i < slotCount; i++)
+		{
+			FrameSlot& slot = slots[i];
+			std::memset(&slot, 0, sizeof(slot));
+			slot.data = region + i * slotStride;
+			slot.capacity = slotStride;
+			slot.index = static_cast<uint32_t>(i);
+
+			uint32_t index = slot.index;
+			freeSlots.TryPush(index);
+		}
+	}
+
+	~FramePool()
+	{
+		if (region)
+			munmap(region, regionBytes);
+	}
+
+	// Take a free slot able to hold the given number of bytes, or NULL if the
+	// pool is exhausted or the frame is larger than a slot.
+	FrameSlot* TryAcquire(size_t bytes)
+	{
+		if (bytes > slotStride)
+		{
+			oversizeCount.fetch_add(1, std::memory_order_relaxed);
+			return NULL;
+		}
+
+		uint32_t index = 0;
+		if (!freeSlots.TryPop(index))
+		{
+			exhaustedCount.fetch_add(1, std::memory_order_relaxed);
+			return NULL;
+		}
+
+		acquiredCount.fetch_add(1, std::memory_order_relaxed);
+		size_t current = inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+		size_t peak = peakInUse.load(std::memory_order_relaxed);
+		while (current > peak && !peakInUse.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+			;
+		return &slots[index];
+	}
+
+	void Release(FrameSlot* slot)
+	{
+		inUse.fetch_sub(1, std::memory_order_relaxed);
+		uint32_t index = slot->index;
+		freeSlots.TryPush(index);
+	}
+
+	size_t SlotCount() const
+	{
+		return slots.size();
+	}
+
+	size_t SlotBytes() const
+	{
+		return slotStride;
+	}
+
+	uint8_t* RegionBase() const
+	{
+		return region;
+	}
+
+	size_t RegionBytes() const
+	{
+		return regionBytes;
+	}
+
+	size_t InUse() const
+	{
+		return inUse.load(std::memory_order_relaxed);
+	}
+
+	size_t PeakInUse() const
+	{
+		return peakInUse.load(std::memory_order_relaxed);
+	}
+
+	uint64_t AcquiredCount() const
+	{
+		return acquiredCount.load(std::memory_order_relaxed);
+	}
+
+	uint64_t ExhaustedCount() const
+	{
+		return exhaustedCount.load(std::memory_order_relaxed);
+	}
+
+	uint64_t OversizeCount() const
+	{
+		return oversizeCount.load(std::memory_order_relaxed);
+	}
+
+private:
+	FramePool(const FramePool&);
+	FramePool& operator=(const FramePool&);
+
+	static size_t RoundUp(size_t bytes)
+	{
+		size_t alignment = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+		if (alignment < FRAME_POOL_ALIGNMENT)
+			alignment = FRAME_POOL_ALIGNMENT;
+		return (bytes + alignment - 1) / alignment * alignment;
+	}
+
+	BoundedRing<uint32_t> freeSlots;
+	std::vector<FrameSlot> slots;
+	uint8_t* region;
+	size_t regionBytes;
+	size_t slotStride;
+
+	std::atomic<size_t> inUse;
+	std::atomic<size_t> peakInUse;
+	std::atomic<uint64_t> acquiredCount;
+	std::atomic<uint64_t> exhaustedCount;
+	std::atomic<uint64_t> oversizeCount;
+};
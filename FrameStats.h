@@ -0,0 +1,302 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include "LatencyHistogram.h"
+#include <cstdint>
+#include <cstring>
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- FRAME ID GAPS -=-=-=-=
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// GigE Vision block IDs are 16 bits unless the device uses extended IDs; the
+// 16-bit counter skips 0 when it wraps, so 65535 is followed by 1. A backward
+// step from within FRAME_ID_WRAP_WINDOW of the top to within the same
+// distance of 1 is taken as a wrap. Any other backward step is a stream
+// restart and is not counted as loss.
+#define FRAME_ID_16BIT_MAX 0xFFFFull
+#define FRAME_ID_WRAP_WINDOW 4096
+
+// drop runs are histogrammed by power of two: 1, 2-3, 4-7, ..., the last
+// bucket holds everything from 2^(FRAME_GAP_RUN_BUCKETS - 1) up
+#define FRAME_GAP_RUN_BUCKETS 12
+
+enum FrameGapKind
+{
+	FRAME_GAP_NONE,
+	FRAME_GAP_DROP,     // frames missing before this one
+	FRAME_GAP_RESTART,  // ID went backwards without wrapping
+	FRAME_GAP_DUPLICATE // same ID as the previous frame
+};
+
+// Tracks gaps between consecutive frame IDs seen by the acquisition loop.
+// Record is a few compares and adds; not thread-safe.
+class FrameGapTracker
+{
+public:
+	FrameGapTracker()
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		std::memset(runBuckets, 0, sizeof(runBuckets));
+		haveLast = false;
+		wideIds = false;
+		lastId = 0;
+		received = 0;
+		dropped = 0;
+		incomplete = 0;
+		restarts = 0;
+		duplicates = 0;
+		runs = 0;
+		longestRun = 0;
+		longestRunBeforeId = 0;
+	}
+
+	// Account for one received frame. lostBefore is set to the number of
+	// frames missing between the previous frame and this one.
+	FrameGapKind Record(uint64_t frameId, bool isIncomplete, uint64_t& lostBefore)
+	{
+		lostBefore = 0;
+		received++;
+		if (isIncomplete)
+			incomplete++;
+		if (frameId > FRAME_ID_16BIT_MAX)
+			wideIds = true;
+
+		if (!haveLast)
+		{
+			haveLast = true;
+			lastId = frameId;
+			return FRAME_GAP_NONE;
+		}
+
+		FrameGapKind kind = FRAME_GAP_NONE;
+		if (frameId == lastId)
+		{
+			duplicates++;
+			kind = FRAME_GAP_DUPLICATE;
+		}
+		else if (frameId > lastId)
+		{
+			lostBefore = frameId - lastId - 1;
+		}
+		else if (IsWrap(lastId, frameId))
+		{
+			// 0 is not a valid 16-bit block ID, but do not count it as lost
+			lostBefore = (FRAME_ID_16BIT_MAX - lastId) + (frameId == 0 ? 0 : frameId - 1);
+		}
+		else
+		{
+			restarts++;
+			kind = FRAME_GAP_RESTART;
+		}
+
+		if (lostBefore > 0)
+		{
+			AddRun(lostBefore, frameId);
+			kind = FRAME_GAP_DROP;
+		}
+		lastId = frameId;
+		return kind;
+	}
+
+	uint64_t Received() const
+	{
+		return received;
+	}
+
+	uint64_t Dropped() const
+	{
+		return dropped;
+	}
+
+	// Dropped frames as a percentage of received + dropped.
+	double DropPercent() const
+	{
+		uint64_t expected = received + dropped;
+		return expected ? 100.0 * static_cast<double>(dropped) / static_cast<double>(expected) : 0.0;
+	}
+
+	uint64_t Incomplete() const
+	{
+		return incomplete;
+	}
+
+	uint64_t Restarts() const
+	{
+		return restarts;
+	}
+
+	uint64_t Duplicates() const
+	{
+		return duplicates;
+	}
+
+	// Number of separate drop runs (bursts of consecutive missing IDs).
+	uint64_t Runs() const
+	{
+		return runs;
+	}
+
+	uint64_t LongestRun() const
+	{
+		return longestRun;
+	}
+
+	// ID of the frame received right after the longest run.
+	uint64_t LongestRunBeforeId() const
+	{
+		return longestRunBeforeId;
+	}
+
+	uint64_t RunBucketCount(int bucket) const
+	{
+		return runBuckets[bucket];
+	}
+
+	// Smallest run length counted in a bucket.
+	static uint64_t RunBucketLower(int bucket)
+	{
+		return 1ull << bucket;
+	}
+
+private:
+	bool IsWrap(uint64_t previous, uint64_t current) const
+	{
+		return !wideIds && previous > FRAME_ID_16BIT_MAX - FRAME_ID_WRAP_WINDOW && current < FRAME_ID_WRAP_WINDOW;
+	}
+
+	void AddRun(uint64_t length, uint64_t nextId)
+	{
+		dropped += length;
+		runs++;
+		if (length > longestRun)
+		{
+			longestRun = length;
+			longestRunBeforeId = nextId;
+		}
+
+		int bucket = 0;
+		while (bucket < FRAME_GAP_RUN_BUCKETS - 1 && (length >> (bucket + 1)) != 0)
+			bucket++;
+		runBuckets[bucket]++;
+	}
+
+	uint64_t runBuckets[FRAME_GAP_RUN_BUCKETS];
+	bool haveLast;
+	bool wideIds;
+	uint64_t lastId;
+	uint64_t received;
+	uint64_t dropped;
+	uint64_t incomplete;
+	uint64_t restarts;
+	uint64_t duplicates;
+	uint64_t runs;
+	uint64_t longestRun;
+	uint64_t longestRunBeforeId;
+};
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- FRAME INTERVALS -=-=-=
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// 7 sub-bucket bits keep percentiles within 1/128 (about 0.2 ms at 30 fps)
+// in 58 KB per histogram. Min, max and mean are exact.
+#define FRAME_INTERVAL_SUB_BUCKET_BITS 7
+typedef LogLinearHistogram<FRAME_INTERVAL_SUB_BUCKET_BITS> IntervalHistogram;
+
+// Histograms of the device timestamp delta between consecutive frames: one
+// for the whole run and one for the current reporting window. Intervals that
+// span dropped frames or a restart are skipped so they do not show up as
+// jitter; those are already counted by FrameGapTracker.
+class FrameIntervalTracker
+{
+public:
+	FrameIntervalTracker()
+		: haveLast(false)
+		, lastTimestampNs(0)
+		, skipped(0)
+	{
+	}
+
+	// consecutive is false when frames were lost since the previous call.
+	void Record(uint64_t timestampNs, bool consecutive)
+	{
+		if (haveLast)
+		{
+			if (consecutive && timestampNs > lastTimestampNs)
+			{
+				uint64_t interval = timestampNs - lastTimestampNs;
+				total.Record(interval);
+				window.Record(interval);
+			}
+			else
+			{
+				skipped++;
+			}
+		}
+		haveLast = true;
+		lastTimestampNs = timestampNs;
+	}
+
+	const IntervalHistogram& Total() const
+	{
+		return total;
+	}
+
+	const IntervalHistogram& Window() const
+	{
+		return window;
+	}
+
+	void ResetWindow()
+	{
+		window.Reset();
+	}
+
+	// Intervals not recorded because they spanned a gap.
+	uint64_t Skipped() const
+	{
+		return skipped;
+	}
+
+	static double Fps(const IntervalHistogram& intervals)
+	{
+		uint64_t mean = intervals.Mean();
+		return mean ? 1e9 / static_cast<double>(mean) : 0.0;
+	}
+
+	// Largest distance of any interval from the mean interval.
+	static uint64_t MaxJitter(const IntervalHistogram& intervals)
+	{
+		if (intervals.Count() == 0)
+			return 0;
+		uint64_t mean = intervals.Mean();
+		uint64_t above = intervals.Max() - mean;
+		uint64_t below = mean - intervals.Min();
+		return above > below ? above : below;
+	}
+
+private:
+	IntervalHistogram total;
+	IntervalHistogram window;
+	bool haveLast;
+	uint64_t lastTimestampNs;
+	uint64_t skipped;
+};
@@ -0,0 +1,797 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include "FramePool.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+
+// largest GVSP datagram accepted (jumbo frames, 9000 byte MTU)
+#define GVSP_MAX_PACKET_BYTES 9000
+// datagrams read per recvmmsg call
+#define GVSP_BATCH_PACKETS 64
+// recvmmsg calls per Receive before returning to the caller
+#define GVSP_MAX_BATCHES_PER_RECEIVE 64
+// frames reassembled at the same time; the oldest is given up when a new
+// block arrives and all are busy
+#define GVSP_MAX_ASSEMBLIES 4
+// recently finished block IDs remembered to recognise late packets
+#define GVSP_RECENT_BLOCKS 16
+// control bytes per datagram, room for the SO_RXQ_OVFL drop counter
+#define GVSP_CONTROL_BYTES 64
+
+#define GVSP_STANDARD_HEADER_BYTES 8
+#define GVSP_EXTENDED_HEADER_BYTES 20
+#define GVSP_EXTENDED_ID_FLAG 0x80
+#define GVSP_PAYLOAD_TYPE_IMAGE 0x0001
+#define GVSP_IMAGE_LEADER_BYTES 36
+#define GVSP_IMAGE_TRAILER_BYTES 8
+
+enum GvspPacketFormat
+{
+	GVSP_FORMAT_LEADER = 1,
+	GVSP_FORMAT_TRAILER = 2,
+	GVSP_FORMAT_PAYLOAD = 3
+};
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-= GVSP PACKET CODEC -=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// GigE Vision Stream Protocol, the subset a passive listener needs: image
+// leader, generic payload and image trailer packets with standard (16-bit
+// block, 24-bit packet) or extended (64-bit block, 32-bit packet) IDs. All
+// fields are big-endian. A frame (block) is a leader with packet ID 0,
+// payload packets 1..N carrying consecutive equal-sized pieces of the image
+// (the last may be shorter) and a trailer with ID N+1.
+
+inline uint16_t GvspLoad16(const uint8_t* p)
+{
+	return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t GvspLoad32(const uint8_t* p)
+{
+	return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline uint64_t GvspLoad64(const uint8_t* p)
+{
+	return (static_cast<uint64_t>(GvspLoad32(p)) << 32) | GvspLoad32(p + 4);
+}
+
+inline void GvspStore16(uint8_t* p, uint16_t value)
+{
+	p[0] = static_cast<uint8_t>(value >> 8);
+	p[1] = static_cast<uint8_t>(value);
+}
+
+inline void GvspStore32(uint8_t* p, uint32_t value)
+{
+	GvspStore16(p, static_cast<uint16_t>(value >> 16));
+	GvspStore16(p + 2, static_cast<uint16_t>(value));
+}
+
+inline void GvspStore64(uint8_t* p, uint64_t value)
+{
+	GvspStore32(p, static_cast<uint32_t>(value >> 32));
+	GvspStore32(p + 4, static_cast<uint32_t>(value));
+}
+
+struct GvspPacket
+{
+	uint16_t status;
+	uint64_t blockId;
+	uint32_t packetId;
+	uint8_t format;
+	bool extendedId;
+	// bytes after the GVSP header
+	const uint8_t* data;
+	size_t size;
+};
+
+struct GvspImageLeader
+{
+	uint16_t payloadType;
+	// device timestamp, in ns on Lucid cameras
+	uint64_t timestamp;
+	uint32_t pixelFormat;
+	uint32_t width;
+	uint32_t height;
+	uint32_t offsetX;
+	uint32_t offsetY;
+	uint16_t paddingX;
+	uint16_t paddingY;
+};
+
+// Returns false for datagrams too short to be GVSP.
+inline bool ParseGvspPacket(const uint8_t* p, size_t size, GvspPacket& packet)
+{
+	if (size < GVSP_STANDARD_HEADER_BYTES)
+		return false;
+	packet.status = GvspLoad16(p);
+	packet.format = p[4] & 0x0F;
+	packet.extendedId = (p[4] & GVSP_EXTENDED_ID_FLAG) != 0;
+	if (packet.extendedId)
+	{
+		if (size < GVSP_EXTENDED_HEADER_BYTES)
+			return false;
+		packet.blockId = GvspLoad64(p + 8);
+		packet.packetId = GvspLoad32(p + 16);
+		packet.data = p + GVSP_EXTENDED_HEADER_BYTES;
+		packet.size = size - GVSP_EXTENDED_HEADER_BYTES;
+	}
+	else
+	{
+		packet.blockId = GvspLoad16(p + 2);
+		packet.packetId = GvspLoad32(p + 4) & 0x00FFFFFF;
+		packet.data = p + GVSP_STANDARD_HEADER_BYTES;
+		packet.size = size - GVSP_STANDARD_HEADER_BYTES;
+	}
+	return true;
+}
+
+inline bool ParseGvspImageLeader(const uint8_t* p, size_t size, GvspImageLeader& leader)
+{
+	if (size < GVSP_IMAGE_LEADER_BYTES)
+		return false;
+	leader.payloadType = GvspLoad16(p + 2);
+	leader.timestamp = GvspLoad64(p + 4);
+	leader.pixelFormat = GvspLoad32(p + 12);
+	leader.width = GvspLoad32(p + 16);
+	leader.height = GvspLoad32(p + 20);
+	leader.offsetX = GvspLoad32(p + 24);
+	leader.offsetY = GvspLoad32(p + 28);
+	leader.paddingX = GvspLoad16(p + 32);
+	leader.paddingY = GvspLoad16(p + 34);
+	return leader.payloadType == GVSP_PAYLOAD_TYPE_IMAGE;
+}
+
+// Returns false for trailers too short or not of an image.
+inline bool ParseGvspImageTrailer(const uint8_t* p, size_t size)
+{
+	if (size < GVSP_IMAGE_TRAILER_BYTES)
+		return false;
+	return GvspLoad16(p + 2) == GVSP_PAYLOAD_TYPE_IMAGE;
+}
+
+// Write a GVSP header and return its size.
+inline size_t WriteGvspHeader(uint8_t* p, uint16_t status, uint64_t blockId, uint8_t format, uint32_t packetId, bool extendedId)
+{
+	GvspStore16(p, status);
+	if (extendedId)
+	{
+		GvspStore16(p + 2, 0);
+		GvspStore32(p + 4, 0);
+		p[4] = static_cast<uint8_t>(GVSP_EXTENDED_ID_FLAG | format);
+		GvspStore64(p + 8, blockId);
+		GvspStore32(p + 16, packetId);
+		return GVSP_EXTENDED_HEADER_BYTES;
+	}
+	GvspStore16(p + 2, static_cast<uint16_t>(blockId));
+	GvspStore32(p + 4, packetId & 0x00FFFFFF);
+	p[4] = format;
+	return GVSP_STANDARD_HEADER_BYTES;
+}
+
+inline size_t WriteGvspImageLeader(uint8_t* p, const GvspImageLeader& leader)
+{
+	GvspStore16(p, 0);
+	GvspStore16(p + 2, leader.payloadType);
+	GvspStore64(p + 4, leader.timestamp);
+	GvspStore32(p + 12, leader.pixelFormat);
+	GvspStore32(p + 16, leader.width);
+	GvspStore32(p + 20, leader.height);
+	GvspStore32(p + 24, leader.offsetX);
+	GvspStore32(p + 28, leader.offsetY);
+	GvspStore16(p + 32, leader.paddingX);
+	GvspStore16(p + 34, leader.paddingY);
+	return GVSP_IMAGE_LEADER_BYTES;
+}
+
+inline size_t WriteGvspImageTrailer(uint8_t* p, uint32_t height)
+{
+	GvspStore16(p, 0);
+	GvspStore16(p + 2, GVSP_PAYLOAD_TYPE_IMAGE);
+	GvspStore32(p + 4, height);
+	return GVSP_IMAGE_TRAILER_BYTES;
+}
+
+// Bits per pixel of a PFNC pixel format (bits 16-23 of the code).
+inline size_t GetPfncBitsPerPixel(uint64_t pixelFormat)
+{
+	return static_cast<size_t>((pixelFormat >> 16) & 0xFF);
+}
+
+// Block IDs for consecutive frames: standard IDs run 1..65535 and skip 0.
+inline uint64_t NextGvspBlockId(uint64_t blockId, bool extendedId)
+{
+	if (extendedId)
+		return blockId + 1;
+	return blockId >= 0xFFFF ? 1 : blockId + 1;
+}
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-= GVSP PACKETIZER -=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Splits one image into the datagrams a camera would send for it, for
+// generators and benchmarks. packetBytes is the GVSP datagram size (the
+// UDP payload), i.e. GevSCPSPacketSize minus the IP and UDP headers.
+class GvspPacketizer
+{
+public:
+	GvspPacketizer(size_t packetBytes, bool extendedId)
+		: extendedId(extendedId)
+		, headerBytes(extendedId ? GVSP_EXTENDED_HEADER_BYTES : GVSP_STANDARD_HEADER_BYTES)
+		, packetBytes(packetBytes)
+	{
+		if (packetBytes <= headerBytes + GVSP_IMAGE_LEADER_BYTES || packetBytes > GVSP_MAX_PACKET_BYTES)
+			throw std::runtime_error("Invalid GVSP packet size");
+	}
+
+	// image bytes carried by each payload packet but the last
+	size_t PayloadBytes() const
+	{
+		return packetBytes - headerBytes;
+	}
+
+	// datagrams for an image of the given size: leader, payload, trailer
+	size_t PacketCount(size_t imageBytes) const
+	{
+		return (imageBytes + PayloadBytes() - 1) / PayloadBytes() + 2;
+	}
+
+	// Build datagram `index` of a frame into `out` (GVSP_MAX_PACKET_BYTES)
+	// and return its size.
+	size_t Build(size_t index, uint64_t blockId, const GvspImageLeader& leader, const uint8_t* image, size_t imageBytes, uint8_t* out) const
+	{
+		size_t count = PacketCount(imageBytes);
+		if (index == 0)
+		{
+			size_t size = WriteGvspHeader(out, 0, blockId, GVSP_FORMAT_LEADER, 0, extendedId);
+			return size + WriteGvspImageLeader(out + size, leader);
+		}
+		if (index == count - 1)
+		{
+			size_t size = WriteGvspHeader(out, 0, blockId, GVSP_FORMAT_TRAILER, static_cast<uint32_t>(index), extendedId);
+			return size + WriteGvspImageTrailer(out + size, leader.height);
+		}
+
+		size_t offset = (index - 1) * PayloadBytes();
+		size_t bytes = std::min(PayloadBytes(), imageBytes - offset);
+		size_t size = WriteGvspHeader(out, 0, blockId, GVSP_FORMAT_PAYLOAD, static_cast<uint32_t>(index), extendedId);
+		std::memcpy(out + size, image + offset, bytes);
+		return size + bytes;
+	}
+
+private:
+	bool extendedId;
+	size_t headerBytes;
+	size_t packetBytes;
+};
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-= GVSP RECEIVER -=-=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+struct GvspFrame
+{
+	// Reassembled image with its geometry filled in, owned by the caller,
+	// who releases it to the pool (or hands it on). NULL when no slot was
+	// free; the frame is then only counted.
+	FrameSlot* pSlot;
+	uint64_t blockId;
+	// steady clock when the last packet of the frame arrived
+	uint64_t receivedNs;
+	bool incomplete;
+	// payload packets that never arrived (unknown if the trailer was lost)
+	uint32_t missingPackets;
+};
+
+struct GvspReceiverStats
+{
+	uint64_t packets;
+	uint64_t bytes;
+	// recvmmsg calls that returned datagrams
+	uint64_t batches;
+	size_t peakBatch;
+	uint64_t frames;
+	uint64_t incompleteFrames;
+	// frames counted without a slot because the pool was exhausted
+	uint64_t noSlotFrames;
+	// not GVSP, non-zero status, not an image or out of range
+	uint64_t ignoredPackets;
+	// sent by another host than the camera, e.g. a second master on the
+	// same group and port
+	uint64_t foreignPackets;
+	// packets of frames already handed out, and repeated packets
+	uint64_t latePackets;
+	uint64_t duplicatePackets;
+	// datagrams the kernel dropped because the socket queue was full, as
+	// reported with SO_RXQ_OVFL (0 unless the option is set on the socket)
+	uint64_t socketDrops;
+};
+
+// Passive GVSP receiver on a bound UDP socket. Datagrams are read with
+// recvmmsg, GVSP_BATCH_PACKETS per syscall, and copied straight into frame
+// pool slots at their offset in the image, so a frame costs one copy and
+// about packets / batch syscalls. Used by one thread; the caller owns the
+// socket. Packets are never re-requested: this is a listener, and a
+// missing packet makes the frame incomplete. Only datagrams from one
+// sender are used: the camera set with SetSource, or else the sender of the
+// first image leader.
+class GvspReceiver
+{
+public:
+	GvspReceiver(int socketFd, FramePool* pool, size_t batchPackets = GVSP_BATCH_PACKETS)
+		: socketFd(socketFd)
+		, pool(pool)
+		, batchPackets(batchPackets < 1 ? 1 : batchPackets)
+		, buffers(this->batchPackets * GVSP_MAX_PACKET_BYTES)
+		, controls(this->batchPackets * GVSP_CONTROL_BYTES)
+		, sources(this->batchPackets)
+		, vectors(this->batchPackets)
+		, messages(this->batchPackets)
+		, assemblies(GVSP_MAX_ASSEMBLIES)
+		, startCounter(0)
+		, payloadBytes(0)
+		, recentCount(0)
+		, lastPacketNs(0)
+		, sourceAddress(0)
+		, sourceKnown(false)
+	{
+		std::memset(&stats, 0, sizeof(stats));
+		for (size_t i = 0; i < this->batchPackets; i++)
+		{
+			vectors[i].iov_base = &buffers[i * GVSP_MAX_PACKET_BYTES];
+			vectors[i].iov_len = GVSP_MAX_PACKET_BYTES;
+			std::memset(&messages[i], 0, sizeof(messages[i]));
+			messages[i].msg_hdr.msg_iov = &vectors[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+			messages[i].msg_hdr.msg_control = &controls[i * GVSP_CONTROL_BYTES];
+			messages[i].msg_hdr.msg_name = &sources[i];
+		}
+		for (size_t i = 0; i < assemblies.size(); i++)
+			assemblies[i].active = false;
+		std::memset(recentBlocks, 0, sizeof(recentBlocks));
+	}
+
+	~GvspReceiver()
+	{
+		for (size_t i = 0; i < assemblies.size(); i++)
+		{
+			if (assemblies[i].active && assemblies[i].pSlot)
+				pool->Release(assemblies[i].pSlot);
+		}
+	}
+
+	// Accept datagrams only from this IPv4 address (host byte order), the
+	// camera's; anything else is counted in foreignPackets.
+	void SetSource(uint32_t address)
+	{
+		sourceAddress = address;
+		sourceKnown = true;
+	}
+
+	// Wait up to timeoutMs for datagrams and process what arrives. Frames
+	// that are complete, or given up on, are appended to `frames`. Frames
+	// still being assembled when no packet arrives within the timeout are
+	// given up too, so a stalled stream never holds slots. Throws on socket
+	// errors.
+	void Receive(int timeoutMs, std::vector<GvspFrame>& frames)
+	{
+		pollfd fd;
+		fd.fd = socketFd;
+		fd.events = POLLIN;
+		fd.revents = 0;
+		int ready = poll(&fd, 1, timeoutMs);
+		if (ready < 0 && errno != EINTR)
+			throw std::runtime_error(std::string("GVSP poll failed: ") + std::strerror(errno));
+		if (ready <= 0)
+		{
+			if (NowNs() - lastPacketNs >= static_cast<uint64_t>(timeoutMs) * 1000000ull)
+				Flush(frames);
+			return;
+		}
+
+		for (int batch = 0; batch < GVSP_MAX_BATCHES_PER_RECEIVE; batch++)
+		{
+			// the kernel shrinks msg_controllen and msg_namelen to what it wrote
+			for (size_t i = 0; i < batchPackets; i++)
+			{
+				messages[i].msg_hdr.msg_controllen = GVSP_CONTROL_BYTES;
+				messages[i].msg_hdr.msg_namelen = sizeof(sources[i]);
+			}
+			int count = recvmmsg(socketFd, &messages[0], static_cast<unsigned>(batchPackets), MSG_DONTWAIT, NULL);
+			if (count < 0)
+			{
+				if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+					break;
+				throw std::runtime_error(std::string("GVSP recvmmsg failed: ") + std::strerror(errno));
+			}
+			if (count == 0)
+				break;
+
+			lastPacketNs = NowNs();
+			stats.batches++;
+			if (static_cast<size_t>(count) > stats.peakBatch)
+				stats.peakBatch = static_cast<size_t>(count);
+			for (int i = 0; i < count; i++)
+			{
+				stats.packets++;
+				stats.bytes += messages[i].msg_len;
+				if (messages[i].msg_hdr.msg_controllen > 0)
+					ReadSocketDrops(messages[i].msg_hdr);
+				HandlePacket(&buffers[i * GVSP_MAX_PACKET_BYTES], messages[i].msg_len, ntohl(sources[i].sin_addr.s_addr), frames);
+			}
+			if (static_cast<size_t>(count) < batchPackets)
+				break;
+		}
+	}
+
+	// Hand out every frame still being assembled as incomplete, oldest first.
+	void Flush(std::vector<GvspFrame>& frames)
+	{
+		for (;;)
+		{
+			Assembly* oldest = Oldest();
+			if (!oldest)
+				return;
+			Finish(*oldest, frames);
+		}
+	}
+
+	const GvspReceiverStats& Stats() const
+	{
+		return stats;
+	}
+
+private:
+	GvspReceiver(const GvspReceiver&);
+	GvspReceiver& operator=(const GvspReceiver&);
+
+	struct Assembly
+	{
+		bool active;
+		uint64_t blockId;
+		// order the assembly was started in, to find the oldest
+		uint64_t started;
+		FrameSlot* pSlot;
+		bool haveLeader;
+		// payload packet count from the trailer's ID, 0 until it arrives
+		uint32_t lastPayloadId;
+		uint32_t received;
+		// highest image byte written, for frames without a leader
+		size_t extent;
+		// bytes per line without and with the leader's paddingX
+		size_t lineBytes;
+		size_t lineStride;
+		bool corrupt;
+		std::vector<uint8_t> seen;
+	};
+
+	static uint64_t NowNs()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	// SO_RXQ_OVFL attaches the socket's running drop count to datagrams
+	// received after a drop; keep the latest.
+	void ReadSocketDrops(msghdr& header)
+	{
+		for (cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(&header, cmsg))
+		{
+			if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL)
+			{
+				uint32_t drops = 0;
+				std::memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+				stats.socketDrops = drops;
+			}
+		}
+	}
+
+	// Check everything that can be checked without an assembly, so only a
+	// well-formed image packet can take a slot or evict a frame.
+	bool IsImagePacket(const GvspPacket& packet, GvspImageLeader& leader) const
+	{
+		if (packet.status != 0 || packet.blockId == 0)
+			return false;
+		switch (packet.format)
+		{
+		case GVSP_FORMAT_LEADER:
+			return packet.packetId == 0 && ParseGvspImageLeader(packet.data, packet.size, leader);
+		case GVSP_FORMAT_PAYLOAD:
+			// every payload packet carries at least a byte of the image
+			return packet.packetId != 0 && packet.size != 0 && packet.packetId <= pool->SlotBytes();
+		case GVSP_FORMAT_TRAILER:
+			return packet.packetId != 0 && ParseGvspImageTrailer(packet.data, packet.size);
+		default:
+			return false;
+		}
+	}
+
+	void HandlePacket(const uint8_t* data, size_t size, uint32_t source, std::vector<GvspFrame>& frames)
+	{
+		if (sourceKnown && source != sourceAddress)
+		{
+			stats.foreignPackets++;
+			return;
+		}
+
+		GvspPacket packet;
+		GvspImageLeader leader;
+		std::memset(&leader, 0, sizeof(leader));
+		if (!ParseGvspPacket(data, size, packet) || !IsImagePacket(packet, leader))
+		{
+			stats.ignoredPackets++;
+			return;
+		}
+		if (!sourceKnown)
+		{
+			// the first leader names the sender; packets before it are of a
+			// frame whose start was missed anyway
+			if (packet.format != GVSP_FORMAT_LEADER)
+			{
+				stats.ignoredPackets++;
+				return;
+			}
+			sourceAddress = source;
+			sourceKnown = true;
+		}
+
+		Assembly* assembly = Find(packet.blockId);
+		if (!assembly)
+		{
+			if (IsRecent(packet.blockId))
+			{
+				stats.latePackets++;
+				return;
+			}
+			assembly = Start(packet.blockId, frames);
+		}
+
+		switch (packet.format)
+		{
+		case GVSP_FORMAT_LEADER:
+		{
+			if (assembly->haveLeader)
+			{
+				stats.duplicatePackets++;
+				return;
+			}
+			assembly->haveLeader = true;
+			if (assembly->pSlot)
+			{
+				FrameSlot* pSlot = assembly->pSlot;
+				pSlot->width = leader.width;
+				pSlot->height = leader.height;
+				pSlot->bitsPerPixel = GetPfncBitsPerPixel(leader.pixelFormat);
+				pSlot->pixelFormat = leader.pixelFormat;
+				pSlot->timestampNs = leader.timestamp;
+				pSlot->size = static_cast<size_t>(leader.width) * leader.height * pSlot->bitsPerPixel / 8;
+				// the payload is laid out with paddingX bytes after each line
+				// and paddingY after the image; line padding is removed when
+				// the frame is finished, so the slot holds packed lines
+				size_t lineBits = static_cast<size_t>(leader.width) * pSlot->bitsPerPixel;
+				assembly->lineBytes = lineBits / 8;
+				assembly->lineStride = assembly->lineBytes + leader.paddingX;
+				if (leader.paddingX != 0 && lineBits % 8 != 0)
+					assembly->corrupt = true;
+				if (assembly->lineStride * leader.height + leader.paddingY > pSlot->capacity)
+					assembly->corrupt = true;
+			}
+			break;
+		}
+
+		case GVSP_FORMAT_PAYLOAD:
+		{
+			// learn the payload size from the first full packet
+			if (packet.size > payloadBytes)
+			{
+				if (payloadBytes != 0)
+					assembly->corrupt = true;
+				payloadBytes = packet.size;
+			}
+			if (!MarkSeen(*assembly, packet.packetId))
+				return;
+			assembly->received++;
+			if (assembly->pSlot)
+			{
+				size_t offset = static_cast<size_t>(packet.packetId - 1) * payloadBytes;
+				if (offset + packet.size <= assembly->pSlot->capacity)
+				{
+					std::memcpy(assembly->pSlot->data + offset, packet.data, packet.size);
+					assembly->extent = std::max(assembly->extent, offset + packet.size);
+				}
+				else
+				{
+					assembly->corrupt = true;
+				}
+			}
+			break;
+		}
+
+		case GVSP_FORMAT_TRAILER:
+			if (assembly->lastPayloadId != 0)
+			{
+				stats.duplicatePackets++;
+				return;
+			}
+			assembly->lastPayloadId = packet.packetId - 1;
+			break;
+		}
+
+		if (assembly->haveLeader && assembly->lastPayloadId != 0 && assembly->received >= assembly->lastPayloadId)
+		{
+			// frames started before a complete one will not be completed
+			// by a listener that cannot request resends
+			uint64_t started = assembly->started;
+			for (Assembly* older = Oldest(); older && older->started < started; older = Oldest())
+				Finish(*older, frames);
+			Finish(*assembly, frames);
+		}
+	}
+
+	// Record a payload packet; false (and counted) if it was already seen.
+	bool MarkSeen(Assembly& assembly, uint32_t packetId)
+	{
+		if (packetId >= assembly.seen.size())
+			assembly.seen.resize(std::max<size_t>(packetId + 1, assembly.seen.size() * 2), 0);
+		if (assembly.seen[packetId])
+		{
+			stats.duplicatePackets++;
+			return false;
+		}
+		assembly.seen[packetId] = 1;
+		return true;
+	}
+
+	Assembly* Find(uint64_t blockId)
+	{
+		for (size_t i = 0; i < assemblies.size(); i++)
+		{
+			if (assemblies[i].active && assemblies[i].blockId == blockId)
+				return &assemblies[i];
+		}
+		return NULL;
+	}
+
+	Assembly* Oldest()
+	{
+		Assembly* oldest = NULL;
+		for (size_t i = 0; i < assemblies.size(); i++)
+		{
+			if (assemblies[i].active && (!oldest || assemblies[i].started < oldest->started))
+				oldest = &assemblies[i];
+		}
+		return oldest;
+	}
+
+	bool IsRecent(uint64_t blockId) const
+	{
+		size_t count = std::min<size_t>(recentCount, GVSP_RECENT_BLOCKS);
+		for (size_t i = 0; i < count; i++)
+		{
+			if (recentBlocks[i] == blockId)
+				return true;
+		}
+		return false;
+	}
+
+	Assembly* Start(uint64_t blockId, std::vector<GvspFrame>& frames)
+	{
+		Assembly* assembly = NULL;
+		for (size_t i = 0; i < assemblies.size() && !assembly; i++)
+		{
+			if (!assemblies[i].active)
+				assembly = &assemblies[i];
+		}
+		if (!assembly)
+		{
+			assembly = Oldest();
+			Finish(*assembly, frames);
+		}
+
+		assembly->active = true;
+		assembly->blockId = blockId;
+		assembly->started = startCounter++;
+		assembly->pSlot = pool->TryAcquire(pool->SlotBytes());
+		assembly->haveLeader = false;
+		assembly->lastPayloadId = 0;
+		assembly->received = 0;
+		assembly->extent = 0;
+		assembly->lineBytes = 0;
+		assembly->lineStride = 0;
+		assembly->corrupt = false;
+		std::fill(assembly->seen.begin(), assembly->seen.end(), 0);
+		if (assembly->pSlot)
+		{
+			FrameSlot* pSlot = assembly->pSlot;
+			pSlot->size = 0;
+			pSlot->width = 0;
+			pSlot->height = 0;
+			pSlot->bitsPerPixel = 0;
+			pSlot->pixelFormat = 0;
+			pSlot->timestampNs = 0;
+			pSlot->frameId = blockId;
+		}
+		return assembly;
+	}
+
+	// Move the lines of a padded frame together, in place.
+	static void RemoveLinePadding(const Assembly& assembly)
+	{
+		FrameSlot* pSlot = assembly.pSlot;
+		for (size_t line = 1; line < pSlot->height; line++)
+			std::memmove(pSlot->data + line * assembly.lineBytes, pSlot->data + line * assembly.lineStride, assembly.lineBytes);
+	}
+
+	// Hand out an assembly's frame and free the assembly.
+	void Finish(Assembly& assembly, std::vector<GvspFrame>& frames)
+	{
+		GvspFrame frame;
+		frame.pSlot = assembly.pSlot;
+		frame.blockId = assembly.blockId;
+		frame.receivedNs = lastPacketNs;
+		frame.missingPackets = assembly.lastPayloadId > assembly.received ? assembly.lastPayloadId - assembly.received : 0;
+		frame.incomplete = !assembly.haveLeader || assembly.lastPayloadId == 0 || frame.missingPackets > 0 || assembly.corrupt;
+		if (frame.pSlot && !assembly.haveLeader)
+			frame.pSlot->size = assembly.extent;
+		if (frame.pSlot && !frame.incomplete && assembly.lineStride > assembly.lineBytes)
+			RemoveLinePadding(assembly);
+		frames.push_back(frame);
+
+		stats.frames++;
+		if (frame.incomplete)
+			stats.incompleteFrames++;
+		if (!frame.pSlot)
+			stats.noSlotFrames++;
+
+		recentBlocks[recentCount++ % GVSP_RECENT_BLOCKS] = assembly.blockId;
+		assembly.active = false;
+		assembly.pSlot = NULL;
+	}
+
+	int socketFd;
+	FramePool* pool;
+	size_t batchPackets;
+	std::vector<uint8_t> buffers;
+	std::vector<uint8_t> controls;
+	std::vector<sockaddr_in> sources;
+	std::vector<iovec> vectors;
+	std::vector<mmsghdr> messages;
+	std::vector<Assembly> assemblies;
+	uint64_t startCounter;
+	// image bytes per full payload packet, learned from the stream
+	size_t payloadBytes;
+	uint64_t recentBlocks[GVSP_RECENT_BLOCKS];
+	uint64_t recentCount;
+	uint64_t lastPacketNs;
+	// sender accepted, in host byte order, once set or learned
+	uint32_t sourceAddress;
+	bool sourceKnown;
+	GvspReceiverStats stats;
+};
@@ -0,0 +1,389 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#include "Gvsp.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define TAB1 "  "
+#define TAB2 "    "
+
+// GvspGenerator
+//    Emulates a multicasting master without a camera: streams synthetic
+//    GVSP image frames (leader, payload, trailer) to a multicast group at a
+//    set resolution, frame rate and packet size, optionally losing packets
+//    or whole frames on purpose. Use it to load-test listeners, their drop
+//    accounting and save throughput, e.g. over loopback:
+//
+//       GvspGenerator --interface lo --fps 60 --loss 0.1
+//
+//    Each frame carries a moving gradient and its block ID in the first
+//    bytes, and the leader timestamp is the sender's monotonic clock in ns.
+
+// =-=-=-=-=-=-=-=-=-
+// =-=- SETTINGS =-=-
+// =-=-=-=-=-=-=-=-=-
+
+// same group as Cpp_Multicast_Save's MULTICAST_GROUP_IP
+#define GENERATOR_GROUP_IP "239.10.10.10"
+#define GENERATOR_PORT 50010
+#define GENERATOR_WIDTH 2048
+#define GENERATOR_HEIGHT 1536
+#define GENERATOR_FPS 30.0
+// GVSP datagram size (GevSCPSPacketSize minus 28 bytes of IP and UDP headers)
+#define GENERATOR_PACKET_BYTES 8972
+// datagrams per sendmmsg call
+#define GENERATOR_BATCH_PACKETS 64
+// seconds between progress lines
+#define GENERATOR_REPORT_SEC 1
+
+// PFNC codes of the pixel formats the generator can fill
+#define PFNC_MONO8 0x01080001
+#define PFNC_MONO16 0x01100007
+#define PFNC_BGR8 0x02180015
+
+struct GeneratorOptions
+{
+	std::string group;
+	uint16_t port;
+	// interface name to send on, or empty for the routing table's choice
+	std::string interfaceName;
+	uint32_t width;
+	uint32_t height;
+	uint32_t pixelFormat;
+	double fps;
+	size_t packetBytes;
+	// percent of payload packets and of whole frames not sent
+	double packetLoss;
+	double frameLoss;
+	// 0 = until Ctrl+C
+	uint64_t frames;
+	// sending rate cap in Mbit/s, 0 = each frame as one burst
+	double rateMbps;
+	bool extendedId;
+	int ttl;
+};
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void OnStopSignal(int)
+{
+	stopRequested = 1;
+}
+
+static void PrintUsage(const char* program)
+{
+	std::cout << "Usage: " << program << " [options]\n";
+	std::cout << TAB1 << "--group <ip>         multicast group (default " << GENERATOR_GROUP_IP << ")\n";
+	std::cout << TAB1 << "--port <n>           UDP destination port (default " << GENERATOR_PORT << ")\n";
+	std::cout << TAB1 << "--interface <name>   send on this interface, e.g. lo or eno1\n";
+	std::cout << TAB1 << "--width <n>          image width (default " << GENERATOR_WIDTH << ")\n";
+	std::cout << TAB1 << "--height <n>         image height (default " << GENERATOR_HEIGHT << ")\n";
+	std::cout << TAB1 << "--pixel-format <f>   mono8 | mono16 | bgr8 (default mono8)\n";
+	std::cout << TAB1 << "--fps <n>            frames per second (default " << GENERATOR_FPS << ")\n";
+	std::cout << TAB1 << "--packet-size <n>    GVSP datagram bytes (default " << GENERATOR_PACKET_BYTES << ")\n";
+	std::cout << TAB1 << "--loss <percent>     drop this share of payload packets at random\n";
+	std::cout << TAB1 << "--frame-loss <pct>   skip this share of whole frames (block IDs still advance)\n";
+	std::cout << TAB1 << "--frames <n>         stop after n frames (default: until Ctrl+C)\n";
+	std::cout << TAB1 << "--rate-mbps <n>      pace packets to this rate instead of one burst per frame\n";
+	std::cout << TAB1 << "--extended-id        use 64-bit block and 32-bit packet IDs\n";
+	std::cout << TAB1 << "--ttl <n>            multicast TTL (default 1)\n";
+}
+
+static const char* GetOptionValue(int argc, char** argv, int& i)
+{
+	if (i + 1 >= argc)
+		throw std::runtime_error(std::string("Missing value for option: ") + argv[i]);
+	return argv[++i];
+}
+
+static double ParseNumber(const char* option, const char* value, double low, double high)
+{
+	char* end = NULL;
+	double number = std::strtod(value, &end);
+	if (end == value || *end != '\0' || number < low || number > high)
+		throw std::runtime_error(std::string("Invalid value for ") + option + ": " + value);
+	return number;
+}
+
+static GeneratorOptions ParseOptions(int argc, char** argv)
+{
+	GeneratorOptions options;
+	options.group = GENERATOR_GROUP_IP;
+	options.port = GENERATOR_PORT;
+	options.width = GENERATOR_WIDTH;
+	options.height = GENERATOR_HEIGHT;
+	options.pixelFormat = PFNC_MONO8;
+	options.fps = GENERATOR_FPS;
+	options.packetBytes = GENERATOR_PACKET_BYTES;
+	options.packetLoss = 0.0;
+	options.frameLoss = 0.0;
+	options.frames = 0;
+	options.rateMbps = 0.0;
+	options.extendedId = false;
+	options.ttl = 1;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string option = argv[i];
+		if (option == "--group")
+			options.group = GetOptionValue(argc, argv, i);
+		else if (option == "--port")
+			options.port = static_cast<uint16_t>(ParseNumber(argv[i], GetOptionValue(argc, argv, i), 1, 65535));
+		else if (option == "--interface")
+			options.interfaceName = GetOptionValue(argc, argv, i);
+		else if (option == "--width")
+			options.width = static_cast<uint32_t>(ParseNumber(argv[i], GetOptionValue(argc, argv, i), 1, 65535));
+		else if (option == "--height")
+			options.height = static_cast<uint32_t>(ParseNumber(argv[i], GetOptionValue(argc, argv, i), 1, 65535));
+		else if (option == "--pixel-format")
+		{
+			std::string name = GetOptionValue(argc, argv, i);
+			if (name == "mono8")
+				options.pixelFormat = PFNC_MONO8;
+			else if (name == "mono16")
+				options.pixelFormat = PFNC_MONO16;
+			else if (name == "bgr8")
+				options.pixelFormat = PFNC_BGR8;
+			else
+				throw std::runtime_error("Invalid pixel format: " + name);
+		}
+		else if (option == "--fps")
+			options.fps = ParseNumber(argv[i], GetOptionValue(argc, argv, i), 0.001, 100000);
+		else if (option == "--packet-size")
+			options.packetBytes = static_cast<size_t>(ParseNumber(argv[i], GetOptionValue(argc, argv, i), 64, GVSP_MAX_PACKET_BYTES));
+		else if (option == "--loss")
+			options.packetLoss = ParseNumber(argv[i], GetOptionValue(argc, argv, i), 0, 100);
+		else if (option == "--frame-loss")
+			options.frameLoss = ParseNumber(argv[i], GetOptionValue(argc, argv, i), 0, 100);
+		else if (option == "--frames")
+			options.frames = static_cast<uint64_t>(ParseNumber(argv[i], GetOptionValue(argc, argv, i), 1, 1e15));
+		else if (option == "--rate-mbps")
+			options.rateMbps = ParseNumber(argv[i], GetOptionValue(argc, argv, i), 0, 1e6);
+		else if (option == "--extended-id")
+			options.extendedId = true;
+		else if (option == "--ttl")
+			options.ttl = static_cast<int>(ParseNumber(argv[i], GetOptionValue(argc, argv, i), 0, 255));
+		else if (option == "--help" || option == "-h")
+		{
+			PrintUsage(argv[0]);
+			std::exit(0);
+		}
+		else
+			throw std::runtime_error("Unknown option: " + option);
+	}
+	return options;
+}
+
+// Open the sending socket, connected to group:port. Throws on failure.
+static int OpenSender(const GeneratorOptions& options)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		throw std::runtime_error(std::string("Failed to create socket: ") + std::strerror(errno));
+
+	sockaddr_in target;
+	std::memset(&target, 0, sizeof(target));
+	target.sin_family = AF_INET;
+	target.sin_port = htons(options.port);
+	if (inet_pton(AF_INET, options.group.c_str(), &target.sin_addr) != 1)
+		throw std::runtime_error("Invalid group: " + options.group);
+
+	if (!options.interfaceName.empty())
+	{
+		ip_mreqn request;
+		std::memset(&request, 0, sizeof(request));
+		request.imr_ifindex = static_cast<int>(if_nametoindex(options.interfaceName.c_str()));
+		if (request.imr_ifindex == 0)
+			throw std::runtime_error("Invalid interface name: " + options.interfaceName);
+		if (setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &request, sizeof(request)) != 0)
+			throw std::runtime_error(std::string("Failed to select interface: ") + std::strerror(errno));
+	}
+	// listeners on this host receive the stream too
+	int loop = 1;
+	setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+	setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &options.ttl, sizeof(options.ttl));
+
+	if (connect(fd, reinterpret_cast<sockaddr*>(&target), sizeof(target)) != 0)
+		throw std::runtime_error(std::string("Failed to connect to ") + options.group + ": " + std::strerror(errno));
+	return fd;
+}
+
+// Fill a frame with a diagonal gradient that moves one pixel per frame,
+// with the block ID in the first 8 bytes.
+static void FillImage(std::vector<uint8_t>& image, const GeneratorOptions& options, uint64_t frame, uint64_t blockId)
+{
+	size_t bytesPerPixel = GetPfncBitsPerPixel(options.pixelFormat) / 8;
+	size_t stride = options.width * bytesPerPixel;
+	for (uint32_t y = 0; y < options.height; y++)
+	{
+		uint8_t* row = &image[y * stride];
+		for (size_t x = 0; x < stride; x++)
+			row[x] = static_cast<uint8_t>(x / bytesPerPixel + y + frame);
+	}
+	if (image.size() >= 8)
+		GvspStore64(&image[0], blockId);
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		GeneratorOptions options = ParseOptions(argc, argv);
+		size_t imageBytes = static_cast<size_t>(options.width) * options.height * GetPfncBitsPerPixel(options.pixelFormat) / 8;
+		GvspPacketizer packetizer(options.packetBytes, options.extendedId);
+		size_t packetCount = packetizer.PacketCount(imageBytes);
+
+		int fd = OpenSender(options);
+		std::signal(SIGINT, OnStopSignal);
+		std::signal(SIGTERM, OnStopSignal);
+
+		std::cout << "GvspGenerator: " << options.width << " x " << options.height << " (" << imageBytes << " bytes) at " << options.fps << " fps to "
+				  << options.group << ":" << options.port;
+		if (!options.interfaceName.empty())
+			std::cout << " on " << options.interfaceName;
+		std::cout << ", " << packetCount << " packets of " << options.packetBytes << " bytes per frame, "
+				  << imageBytes * 8.0 * options.fps / 1e6 << " Mbit/s\n";
+		if (options.packetLoss > 0.0 || options.frameLoss > 0.0)
+			std::cout << TAB1 << "Losing " << options.packetLoss << "% of payload packets and " << options.frameLoss << "% of frames\n";
+
+		std::vector<uint8_t> image(imageBytes);
+		std::vector<uint8_t> packets(GENERATOR_BATCH_PACKETS * GVSP_MAX_PACKET_BYTES);
+		std::vector<iovec> vectors(GENERATOR_BATCH_PACKETS);
+		std::vector<mmsghdr> messages(GENERATOR_BATCH_PACKETS);
+		std::mt19937_64 random(12345);
+		std::uniform_real_distribution<double> percent(0.0, 100.0);
+
+		GvspImageLeader leader;
+		std::memset(&leader, 0, sizeof(leader));
+		leader.payloadType = GVSP_PAYLOAD_TYPE_IMAGE;
+		leader.pixelFormat = options.pixelFormat;
+		leader.width = options.width;
+		leader.height = options.height;
+
+		// counters for the whole run and for the current report line
+		uint64_t sentFrames = 0, skippedFrames = 0, sentPackets = 0, lostPackets = 0, sentBytes = 0, sendErrors = 0;
+		uint64_t lineFrames = 0, lineBytes = 0;
+
+		std::chrono::nanoseconds period(static_cast<int64_t>(1e9 / options.fps));
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point next = start;
+		std::chrono::steady_clock::time_point nextReport = start + std::chrono::seconds(GENERATOR_REPORT_SEC);
+		std::chrono::steady_clock::time_point lastReport = start;
+		uint64_t blockId = 0;
+		for (uint64_t frame = 0; !stopRequested && (options.frames == 0 || frame < options.frames); frame++)
+		{
+			blockId = NextGvspBlockId(blockId, options.extendedId);
+			if (options.frameLoss > 0.0 && percent(random) < options.frameLoss)
+			{
+				skippedFrames++;
+			}
+			else
+			{
+				FillImage(image, options, frame, blockId);
+				leader.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+
+				std::chrono::steady_clock::time_point packetTime = std::chrono::steady_clock::now();
+				for (size_t first = 0; first < packetCount && !stopRequested;)
+				{
+					// build the next batch, leaving out lost payload packets
+					size_t count = 0;
+					size_t batchBytes = 0;
+					for (; first < packetCount && count < GENERATOR_BATCH_PACKETS; first++)
+					{
+						bool payload = first > 0 && first < packetCount - 1;
+						if (payload && options.packetLoss > 0.0 && percent(random) < options.packetLoss)
+						{
+							lostPackets++;
+							continue;
+						}
+						uint8_t* packet = &packets[count * GVSP_MAX_PACKET_BYTES];
+						vectors[count].iov_base = packet;
+						vectors[count].iov_len = packetizer.Build(first, blockId, leader, &image[0], imageBytes, packet);
+						std::memset(&messages[count], 0, sizeof(messages[count]));
+						messages[count].msg_hdr.msg_iov = &vectors[count];
+						messages[count].msg_hdr.msg_iovlen = 1;
+						batchBytes += vectors[count].iov_len;
+						count++;
+					}
+
+					if (options.rateMbps > 0.0)
+					{
+						std::this_thread::sleep_until(packetTime);
+						packetTime += std::chrono::nanoseconds(static_cast<int64_t>(batchBytes * 8.0 * 1000.0 / options.rateMbps));
+					}
+
+					for (size_t sent = 0; sent < count;)
+					{
+						int result = sendmmsg(fd, &messages[sent], static_cast<unsigned>(count - sent), 0);
+						if (result < 0)
+						{
+							if (errno == EINTR)
+								continue;
+							// e.g. ENOBUFS when the interface queue is full: the rest of the batch is lost
+							sendErrors++;
+							break;
+						}
+						for (int i = 0; i < result; i++)
+							sentBytes += vectors[sent + i].iov_len;
+						sent += static_cast<size_t>(result);
+						sentPackets += static_cast<uint64_t>(result);
+					}
+				}
+				sentFrames++;
+				lineFrames++;
+			}
+
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (now >= nextReport)
+			{
+				double seconds = std::chrono::duration<double>(now - lastReport).count();
+				std::cout << TAB1 << "frames: " << sentFrames << " (" << lineFrames / seconds << " fps), skipped: " << skippedFrames
+						  << ", packets: " << sentPackets << ", lost on purpose: " << lostPackets << ", send errors: " << sendErrors << ", "
+						  << (sentBytes - lineBytes) * 8.0 / seconds / 1e6 << " Mbit/s\n";
+				lineFrames = 0;
+				lineBytes = sentBytes;
+				lastReport = now;
+				nextReport += std::chrono::seconds(GENERATOR_REPORT_SEC);
+			}
+
+			next += period;
+			if (next > now)
+				std::this_thread::sleep_until(next);
+			else if (now - next > period * 10)
+				next = now; // fell far behind (e.g. a slow interface); do not burst to catch up
+		}
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		std::cout << "Sent " << sentFrames << " frames (" << skippedFrames << " skipped) and " << sentPackets << " packets in " << seconds << " s; "
+				  << lostPackets << " packets lost on purpose, " << sendErrors << " send errors\n";
+		close(fd);
+	}
+	catch (std::exception& ex)
+	{
+		std::cout << "GvspGenerator: " << ex.what() << "\n";
+		return -1;
+	}
+	return 0;
+}
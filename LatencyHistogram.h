@@ -0,0 +1,166 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- LATENCY HISTOGRAM -=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Log-linear histogram of nanosecond durations. Each power of two is split
+// into 2^SubBucketBits linear buckets, so a recorded value is off by at most
+// 1/2^SubBucketBits while the whole 64-bit range fits in a fixed array.
+// Recording is a handful of instructions and never allocates. Not thread-safe:
+// keep one histogram per thread and Merge them for reporting.
+template <int SubBucketBits>
+class LogLinearHistogram
+{
+public:
+	static const int SubBuckets = 1 << SubBucketBits;
+	static const int BucketCount = (64 - SubBucketBits + 1) * SubBuckets;
+
+	LogLinearHistogram()
+	{
+		Reset();
+	}
+
+	void Reset()
+	{
+		std::memset(buckets, 0, sizeof(buckets));
+		count = 0;
+		sum = 0;
+		min = UINT64_MAX;
+		max = 0;
+	}
+
+	void Record(uint64_t valueNs)
+	{
+		buckets[BucketIndex(valueNs)]++;
+		count++;
+		sum += valueNs;
+		if (valueNs < min)
+			min = valueNs;
+		if (valueNs > max)
+			max = valueNs;
+	}
+
+	void Merge(const LogLinearHistogram& other)
+	{
+		for (int i = 0; i < BucketCount; i++)
+			buckets[i] += other.buckets[i];
+		count += other.count;
+		sum += other.sum;
+		if (other.min < min)
+			min = other.min;
+		if (other.max > max)
+			max = other.max;
+	}
+
+	uint64_t Count() const
+	{
+		return count;
+	}
+
+	uint64_t Min() const
+	{
+		return count ? min : 0;
+	}
+
+	uint64_t Max() const
+	{
+		return max;
+	}
+
+	uint64_t Mean() const
+	{
+		return count ? sum / count : 0;
+	}
+
+	// Upper bound of the bucket holding the given percentile (0-100).
+	uint64_t Percentile(double percentile) const
+	{
+		if (count == 0)
+			return 0;
+		uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(count) + 0.5);
+		if (rank < 1)
+			rank = 1;
+		if (rank > count)
+			rank = count;
+
+		uint64_t seen = 0;
+		for (int i = 0; i < BucketCount; i++)
+		{
+			seen += buckets[i];
+			if (seen >= rank)
+			{
+				uint64_t upper = BucketUpper(i);
+				return upper < max ? upper : max;
+			}
+		}
+		return max;
+	}
+
+	// Number of recorded values in [lowNs, highNs), at bucket resolution.
+	uint64_t CountBetween(uint64_t lowNs, uint64_t highNs) const
+	{
+		uint64_t total = 0;
+		for (int i = 0; i < BucketCount; i++)
+		{
+			uint64_t lower = BucketLower(i);
+			if (lower >= lowNs && lower < highNs)
+				total += buckets[i];
+		}
+		return total;
+	}
+
+	static int BucketIndex(uint64_t value)
+	{
+		if (value < SubBuckets)
+			return static_cast<int>(value);
+		int msb = 63 - __builtin_clzll(value);
+		int shift = msb - SubBucketBits;
+		return (shift + 1) * SubBuckets + static_cast<int>((value >> shift) & (SubBuckets - 1));
+	}
+
+	static uint64_t BucketLower(int index)
+	{
+		if (index < SubBuckets)
+			return static_cast<uint64_t>(index);
+		int shift = index / SubBuckets - 1;
+		return static_cast<uint64_t>(SubBuckets + index % SubBuckets) << shift;
+	}
+
+	static uint64_t BucketUpper(int index)
+	{
+		if (index < SubBuckets)
+			return static_cast<uint64_t>(index);
+		int shift = index / SubBuckets - 1;
+		return BucketLower(index) + ((static_cast<uint64_t>(1) << shift) - 1);
+	}
+
+private:
+	uint64_t buckets[BucketCount];
+	uint64_t count;
+	uint64_t sum;
+	uint64_t min;
+	uint64_t max;
+};
+
+// 1/8 resolution (3 sub-bucket bits) is plenty for job latencies and keeps
+// one histogram under 5 KB.
+#define LATENCY_SUB_BUCKET_BITS 3
+typedef LogLinearHistogram<LATENCY_SUB_BUCKET_BITS> LatencyHistogram;
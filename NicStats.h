@@ -0,0 +1,65 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- NIC RECEIVE COUNTERS -=
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Receive counters of a network interface from /sys/class/net/<if>/statistics.
+// Everything the NIC took in, so with several cameras (or other traffic) on
+// one port it is the wire rate, not one stream's.
+struct NicCounters
+{
+	uint64_t rxBytes;
+	uint64_t rxPackets;
+	// dropped by the driver or stack (rx_dropped), and by the NIC for lack
+	// of ring buffers (rx_missed_errors, plus rx_fifo_errors)
+	uint64_t rxDropped;
+	uint64_t rxMissed;
+};
+
+inline bool ReadNicCounter(const std::string& interfaceName, const char* name, uint64_t& value)
+{
+	std::string path = "/sys/class/net/" + interfaceName + "/statistics/" + name;
+	FILE* file = std::fopen(path.c_str(), "r");
+	if (!file)
+		return false;
+	unsigned long long number = 0;
+	int matched = std::fscanf(file, "%llu", &number);
+	std::fclose(file);
+	if (matched != 1)
+		return false;
+	value = number;
+	return true;
+}
+
+// Returns false if the interface has no statistics (e.g. it was removed).
+inline bool ReadNicCounters(const std::string& interfaceName, NicCounters& counters)
+{
+	uint64_t fifo = 0;
+	counters = NicCounters();
+	if (!ReadNicCounter(interfaceName, "rx_bytes", counters.rxBytes) || !ReadNicCounter(interfaceName, "rx_packets", counters.rxPackets))
+		return false;
+	ReadNicCounter(interfaceName, "rx_dropped", counters.rxDropped);
+	ReadNicCounter(interfaceName, "rx_missed_errors", counters.rxMissed);
+	if (ReadNicCounter(interfaceName, "rx_fifo_errors", fifo))
+		counters.rxMissed += fifo;
+	return true;
+}
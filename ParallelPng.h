@@ -0,0 +1,483 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/uio.h>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define PNG_FILTER_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PNG_FILTER_NEON
+#endif
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- STRIPED PNG ENCODER -
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Deflate is inherently serial, so a single large frame keeps one core busy
+// for a long time. The encoder cuts the image into horizontal stripes and
+// compresses them on separate threads, pigz-style: each stripe is a raw
+// deflate stream primed with the last 32 KiB of the previous stripe as a
+// dictionary and ended with Z_SYNC_FLUSH, so the concatenated stripes form
+// one valid zlib stream. The Adler-32 trailer is combined from per-stripe
+// checksums with adler32_combine. Every stripe becomes its own IDAT chunk.
+//
+// Rows are filtered with Sub or Up, whichever has the smaller sum of absolute
+// differences; both filters are vectorized with SSE2 or NEON when available.
+
+#define PNG_DICTIONARY_BYTES 32768
+// stripes shorter than this are not worth a thread
+#define PNG_MIN_STRIPE_ROWS 64
+
+enum PngFilter
+{
+	PNG_FILTER_NONE = 0,
+	PNG_FILTER_SUB = 1,
+	PNG_FILTER_UP = 2
+};
+
+// Sum of the bytes of a filtered row read as signed values, the usual
+// heuristic for picking a filter.
+inline uint64_t ScalarFilterCost(const uint8_t* pRow, size_t bytes)
+{
+	uint64_t cost = 0;
+	for (size_t i = 0; i < bytes; i++)
+		cost += pRow[i] < 128 ? pRow[i] : 256 - pRow[i];
+	return cost;
+}
+
+// out[i] = row[i] - row[i - bpp]; returns the filter cost.
+inline uint64_t FilterRowSub(const uint8_t* pRow, size_t bytes, size_t bpp, uint8_t* pOut)
+{
+	size_t i = bpp < bytes ? bpp : bytes;
+	std::memcpy(pOut, pRow, i);
+	uint64_t cost = ScalarFilterCost(pOut, i);
+
+#if defined(PNG_FILTER_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = zero;
+	for (; i + 16 <= bytes; i += 16)
+	{
+		__m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + i - bpp));
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + i));
+		__m128i diff = _mm_sub_epi8(value, left);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + i), diff);
+		sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_min_epu8(diff, _mm_sub_epi8(zero, diff)), zero));
+	}
+	cost += static_cast<uint64_t>(_mm_cvtsi128_si32(sum)) + static_cast<uint64_t>(_mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+#elif defined(PNG_FILTER_NEON)
+	uint32x4_t sum = vdupq_n_u32(0);
+	for (; i + 16 <= bytes; i += 16)
+	{
+		uint8x16_t diff = vsubq_u8(vld1q_u8(pRow + i), vld1q_u8(pRow + i - bpp));
+		vst1q_u8(pOut + i, diff);
+		uint8x16_t magnitude = vreinterpretq_u8_s8(vabsq_s8(vreinterpretq_s8_u8(diff)));
+		sum = vpadalq_u16(sum, vpaddlq_u8(magnitude));
+	}
+	cost += static_cast<uint64_t>(vgetq_lane_u32(sum, 0)) + vgetq_lane_u32(sum, 1) + vgetq_lane_u32(sum, 2) + vgetq_lane_u32(sum, 3);
+#endif
+
+	size_t tail = i;
+	for (; i < bytes; i++)
+		pOut[i] = static_cast<uint8_t>(pRow[i] - pRow[i - bpp]);
+	return cost + ScalarFilterCost(pOut + tail, bytes - tail);
+}
+
+// out[i] = row[i] - previous[i]; returns the filter cost.
+inline uint64_t FilterRowUp(const uint8_t* pRow, const uint8_t* pPrevious, size_t bytes, uint8_t* pOut)
+{
+	size_t i = 0;
+	uint64_t cost = 0;
+
+#if defined(PNG_FILTER_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = zero;
+	for (; i + 16 <= bytes; i += 16)
+	{
+		__m128i above = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pPrevious + i));
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + i));
+		__m128i diff = _mm_sub_epi8(value, above);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pOut + i), diff);
+		sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_min_epu8(diff, _mm_sub_epi8(zero, diff)), zero));
+	}
+	cost += static_cast<uint64_t>(_mm_cvtsi128_si32(sum)) + static_cast<uint64_t>(_mm_cvtsi128_si32(_mm_srli_si128(sum, 8)));
+#elif defined(PNG_FILTER_NEON)
+	uint32x4_t sum = vdupq_n_u32(0);
+	for (; i + 16 <= bytes; i += 16)
+	{
+		uint8x16_t diff = vsubq_u8(vld1q_u8(pRow + i), vld1q_u8(pPrevious + i));
+		vst1q_u8(pOut + i, diff);
+		uint8x16_t magnitude = vreinterpretq_u8_s8(vabsq_s8(vreinterpretq_s8_u8(diff)));
+		sum = vpadalq_u16(sum, vpaddlq_u8(magnitude));
+	}
+	cost += static_cast<uint64_t>(vgetq_lane_u32(sum, 0)) + vgetq_lane_u32(sum, 1) + vgetq_lane_u32(sum, 2) + vgetq_lane_u32(sum, 3);
+#endif
+
+	size_t tail = i;
+	for (; i < bytes; i++)
+		pOut[i] = static_cast<uint8_t>(pRow[i] - pPrevious[i]);
+	return cost + ScalarFilterCost(pOut + tail, bytes - tail);
+}
+
+// Encodes 8-bit gray, RGB or BGR images. Keep one encoder per thread so its
+// buffers are reused from frame to frame.
+class StripedPngEncoder
+{
+public:
+	StripedPngEncoder()
+		: level(Z_DEFAULT_COMPRESSION)
+		, activeStripes(0)
+	{
+	}
+
+	// Encode an image; channels is 1 (gray) or 3 (RGB, or BGR with
+	// swapRedBlue). Uses up to threadCount threads including the caller.
+	// Throws on zlib errors. The result stays valid until the next call.
+	void Encode(const uint8_t* pPixels, size_t width, size_t height, size_t channels, bool swapRedBlue, int compressionLevel, size_t threadCount)
+	{
+		if (width == 0 || height == 0 || (channels != 1 && channels != 3))
+			throw std::runtime_error("Unsupported image layout for PNG encoder");
+
+		image.pPixels = pPixels;
+		image.width = width;
+		image.height = height;
+		image.channels = channels;
+		image.rowBytes = width * channels;
+		image.swapRedBlue = swapRedBlue && channels == 3;
+		level = compressionLevel;
+
+		size_t stripeCount = threadCount < 1 ? 1 : threadCount;
+		size_t maxStripes = (height + PNG_MIN_STRIPE_ROWS - 1) / PNG_MIN_STRIPE_ROWS;
+		if (stripeCount > maxStripes)
+			stripeCount = maxStripes;
+		if (stripes.size() < stripeCount)
+			stripes.resize(stripeCount);
+
+		size_t rowsPerStripe = height / stripeCount;
+		size_t extraRows = height % stripeCount;
+		size_t row = 0;
+		for (size_t i = 0; i < stripeCount; i++)
+		{
+			Stripe& stripe = stripes[i];
+			stripe.firstRow = row;
+			stripe.rowCount = rowsPerStripe + (i < extraRows ? 1 : 0);
+			stripe.last = (i + 1 == stripeCount);
+			stripe.error.clear();
+			row += stripe.rowCount;
+		}
+		activeStripes = stripeCount;
+
+		std::vector<std::thread> workers;
+		for (size_t i = 1; i < stripeCount; i++)
+			workers.push_back(std::thread(EncodeStripe, std::cref(image), level, std::ref(stripes[i])));
+		EncodeStripe(image, level, stripes[0]);
+		for (size_t i = 0; i < workers.size(); i++)
+			workers[i].join();
+
+		for (size_t i = 0; i < stripeCount; i++)
+		{
+			if (!stripes[i].error.empty())
+				throw std::runtime_error(stripes[i].error);
+		}
+
+		BuildChunks();
+	}
+
+	// File contents as a gather list, valid until the next Encode.
+	const std::vector<iovec>& Parts() const
+	{
+		return parts;
+	}
+
+	// Total encoded size in bytes.
+	size_t EncodedBytes() const
+	{
+		size_t bytes = 0;
+		for (size_t i = 0; i < parts.size(); i++)
+			bytes += parts[i].iov_len;
+		return bytes;
+	}
+
+private:
+	StripedPngEncoder(const StripedPngEncoder&);
+	StripedPngEncoder& operator=(const StripedPngEncoder&);
+
+	struct Image
+	{
+		const uint8_t* pPixels;
+		size_t width;
+		size_t height;
+		size_t channels;
+		size_t rowBytes;
+		bool swapRedBlue;
+	};
+
+	struct Stripe
+	{
+		size_t firstRow;
+		size_t rowCount;
+		bool last;
+		// filter byte + filtered row, for every row of the stripe
+		std::vector<uint8_t> filtered;
+		// filtered rows preceding the stripe, used as the deflate dictionary
+		std::vector<uint8_t> dictionary;
+		std::vector<uint8_t> compressed;
+		size_t compressedBytes;
+		uLong adler;
+		uLong crc;
+		// IDAT length and type, and CRC, in file byte order
+		uint8_t chunkHeader[8];
+		uint8_t chunkCrc[4];
+		// set by the stripe's thread instead of throwing
+		std::string error;
+	};
+
+	// Scratch rows for one stripe thread.
+	struct RowBuffers
+	{
+		std::vector<uint8_t> current;
+		std::vector<uint8_t> previous;
+		std::vector<uint8_t> alternate;
+	};
+
+	static void StoreBigEndian(uint8_t* pOut, uint32_t value)
+	{
+		pOut[0] = static_cast<uint8_t>(value >> 24);
+		pOut[1] = static_cast<uint8_t>(value >> 16);
+		pOut[2] = static_cast<uint8_t>(value >> 8);
+		pOut[3] = static_cast<uint8_t>(value);
+	}
+
+	// Copy a source row, reordering BGR to RGB if needed.
+	static const uint8_t* LoadRow(const Image& image, size_t row, std::vector<uint8_t>& buffer)
+	{
+		const uint8_t* pSource = image.pPixels + row * image.rowBytes;
+		if (!image.swapRedBlue)
+			return pSource;
+
+		uint8_t* pOut = &buffer[0];
+		for (size_t x = 0; x < image.rowBytes; x += 3)
+		{
+			pOut[x] = pSource[x + 2];
+			pOut[x + 1] = pSource[x + 1];
+			pOut[x + 2] = pSource[x];
+		}
+		return pOut;
+	}
+
+	// Filter rows [firstRow, firstRow + rowCount) into pOut. The choice for
+	// each row depends only on the image, so a neighbouring stripe that
+	// re-filters the same rows for its dictionary gets identical bytes.
+	static void FilterRows(const Image& image, size_t firstRow, size_t rowCount, uint8_t* pOut, RowBuffers& rows)
+	{
+		const size_t rowBytes = image.rowBytes;
+		const uint8_t* pPrevious = firstRow > 0 ? LoadRow(image, firstRow - 1, rows.previous) : NULL;
+
+		for (size_t row = firstRow; row < firstRow + rowCount; row++)
+		{
+			const uint8_t* pCurrent = LoadRow(image, row, rows.current);
+			uint8_t* pFiltered = pOut + 1;
+
+			uint64_t subCost = FilterRowSub(pCurrent, rowBytes, image.channels, pFiltered);
+			pOut[0] = PNG_FILTER_SUB;
+			if (pPrevious)
+			{
+				uint64_t upCost = FilterRowUp(pCurrent, pPrevious, rowBytes, &rows.alternate[0]);
+				if (upCost < subCost)
+				{
+					std::memcpy(pFiltered, &rows.alternate[0], rowBytes);
+					pOut[0] = PNG_FILTER_UP;
+				}
+			}
+			pOut += 1 + rowBytes;
+
+			// keep the loaded row as the next row's previous
+			if (image.swapRedBlue)
+			{
+				rows.current.swap(rows.previous);
+				pPrevious = &rows.previous[0];
+			}
+			else
+			{
+				pPrevious = pCurrent;
+			}
+		}
+	}
+
+	static void EncodeStripe(const Image& image, int level, Stripe& stripe)
+	{
+		try
+		{
+			const size_t lineBytes = 1 + image.rowBytes;
+			RowBuffers rows;
+			rows.current.resize(image.rowBytes);
+			rows.previous.resize(image.rowBytes);
+			rows.alternate.resize(image.rowBytes);
+
+			stripe.filtered.resize(stripe.rowCount * lineBytes);
+			FilterRows(image, stripe.firstRow, stripe.rowCount, &stripe.filtered[0], rows);
+
+			size_t dictionaryBytes = 0;
+			if (stripe.firstRow > 0)
+			{
+				size_t dictionaryRows = (PNG_DICTIONARY_BYTES + lineBytes - 1) / lineBytes;
+				if (dictionaryRows > stripe.firstRow)
+					dictionaryRows = stripe.firstRow;
+				stripe.dictionary.resize(dictionaryRows * lineBytes);
+				FilterRows(image, stripe.firstRow - dictionaryRows, dictionaryRows, &stripe.dictionary[0], rows);
+				dictionaryBytes = stripe.dictionary.size() < PNG_DICTIONARY_BYTES ? stripe.dictionary.size() : PNG_DICTIONARY_BYTES;
+			}
+
+			z_stream stream;
+			std::memset(&stream, 0, sizeof(stream));
+			// raw deflate; the zlib header and trailer are written once for the file
+			if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+				throw std::runtime_error("deflateInit2 failed");
+
+			if (dictionaryBytes > 0)
+				deflateSetDictionary(&stream, &stripe.dictionary[stripe.dictionary.size() - dictionaryBytes], static_cast<uInt>(dictionaryBytes));
+
+			// deflateBound assumes Z_FINISH; leave room for the sync flush marker
+			stripe.compressed.resize(deflateBound(&stream, static_cast<uLong>(stripe.filtered.size())) + 64);
+			stream.next_in = &stripe.filtered[0];
+			stream.avail_in = static_cast<uInt>(stripe.filtered.size());
+			stream.next_out = &stripe.compressed[0];
+			stream.avail_out = static_cast<uInt>(stripe.compressed.size());
+
+			int flush = stripe.last ? Z_FINISH : Z_SYNC_FLUSH;
+			int result = Z_OK;
+			for (;;)
+			{
+				result = deflate(&stream, flush);
+				if (result == Z_STREAM_END || (result == Z_OK && stream.avail_in == 0 && stream.avail_out > 0 && !stripe.last))
+					break;
+				if (result != Z_OK && result != Z_BUF_ERROR)
+					break;
+
+				// out of space; grow and continue
+				size_t used = stripe.compressed.size() - stream.avail_out;
+				stripe.compressed.resize(stripe.compressed.size() * 2);
+				stream.next_out = &stripe.compressed[used];
+				stream.avail_out = static_cast<uInt>(stripe.compressed.size() - used);
+			}
+			stripe.compressedBytes = stripe.compressed.size() - stream.avail_out;
+			deflateEnd(&stream);
+			if (result != Z_OK && result != Z_STREAM_END)
+				throw std::runtime_error("deflate failed");
+
+			stripe.adler = adler32(adler32(0, NULL, 0), &stripe.filtered[0], static_cast<uInt>(stripe.filtered.size()));
+
+			StoreBigEndian(stripe.chunkHeader, static_cast<uint32_t>(stripe.compressedBytes));
+			std::memcpy(stripe.chunkHeader + 4, "IDAT", 4);
+			stripe.crc = crc32(crc32(0, NULL, 0), stripe.chunkHeader + 4, 4);
+			stripe.crc = crc32(stripe.crc, &stripe.compressed[0], static_cast<uInt>(stripe.compressedBytes));
+			StoreBigEndian(stripe.chunkCrc, static_cast<uint32_t>(stripe.crc));
+		}
+		catch (std::exception& ex)
+		{
+			stripe.error = std::string("PNG encoding failed: ") + ex.what();
+		}
+	}
+
+	// Append a complete chunk to prefix/suffix storage.
+	static void AppendChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* pData, size_t bytes)
+	{
+		size_t start = out.size();
+		out.resize(start + 12 + bytes);
+		uint8_t* pChunk = &out[start];
+		StoreBigEndian(pChunk, static_cast<uint32_t>(bytes));
+		std::memcpy(pChunk + 4, type, 4);
+		if (bytes > 0)
+			std::memcpy(pChunk + 8, pData, bytes);
+		StoreBigEndian(pChunk + 8 + bytes, static_cast<uint32_t>(crc32(crc32(0, NULL, 0), pChunk + 4, static_cast<uInt>(4 + bytes))));
+	}
+
+	void BuildChunks()
+	{
+		static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+		uint8_t header[13];
+		StoreBigEndian(header, static_cast<uint32_t>(image.width));
+		StoreBigEndian(header + 4, static_cast<uint32_t>(image.height));
+		header[8] = 8;                             // bit depth
+		header[9] = image.channels == 3 ? 2 : 0;   // truecolor or grayscale
+		header[10] = 0;                            // deflate
+		header[11] = 0;                            // adaptive filtering
+		header[12] = 0;                            // no interlace
+
+		// zlib header: 32K window, FLEVEL matching the compression level
+		uint8_t zlibHeader[2];
+		zlibHeader[0] = 0x78;
+		if (level == 0 || level == 1)
+			zlibHeader[1] = 0x01;
+		else if (level >= 2 && level <= 5)
+			zlibHeader[1] = 0x5E;
+		else if (level >= 7)
+			zlibHeader[1] = 0xDA;
+		else
+			zlibHeader[1] = 0x9C;
+
+		prefix.assign(signature, signature + sizeof(signature));
+		AppendChunk(prefix, "IHDR", header, sizeof(header));
+		AppendChunk(prefix, "IDAT", zlibHeader, sizeof(zlibHeader));
+
+		uLong adler = stripes[0].adler;
+		for (size_t i = 1; i < activeStripes; i++)
+			adler = adler32_combine(adler, stripes[i].adler, static_cast<z_off_t>(stripes[i].filtered.size()));
+		uint8_t zlibTrailer[4];
+		StoreBigEndian(zlibTrailer, static_cast<uint32_t>(adler));
+
+		suffix.clear();
+		AppendChunk(suffix, "IDAT", zlibTrailer, sizeof(zlibTrailer));
+		AppendChunk(suffix, "IEND", NULL, 0);
+
+		parts.clear();
+		AddPart(&prefix[0], prefix.size());
+		for (size_t i = 0; i < activeStripes; i++)
+		{
+			Stripe& stripe = stripes[i];
+			AddPart(stripe.chunkHeader, sizeof(stripe.chunkHeader));
+			AddPart(&stripe.compressed[0], stripe.compressedBytes);
+			AddPart(stripe.chunkCrc, sizeof(stripe.chunkCrc));
+		}
+		AddPart(&suffix[0], suffix.size());
+	}
+
+	void AddPart(const uint8_t* pData, size_t bytes)
+	{
+		iovec part;
+		part.iov_base = const_cast<uint8_t*>(pData);
+		part.iov_len = bytes;
+		parts.push_back(part);
+	}
+
+	Image image;
+	int level;
+	std::vector<Stripe> stripes;
+	size_t activeStripes;
+	std::vector<uint8_t> prefix;
+	std::vector<uint8_t> suffix;
+	std::vector<iovec> parts;
+};
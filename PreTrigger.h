@@ -0,0 +1,157 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include "FramePool.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- PRE-TRIGGER RING -=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// The most recent frames, held in frame pool slots, oldest first. Used only
+// by the acquisition thread. When the ring is full the oldest slot is reused
+// for the next frame, so memory stays at capacity slots however long the
+// ring runs before a trigger.
+class PreTriggerRing
+{
+public:
+	explicit PreTriggerRing(size_t capacity)
+		: slots(capacity < 1 ? 1 : capacity)
+		, head(0)
+		, count(0)
+	{
+	}
+
+	size_t Capacity() const
+	{
+		return slots.size();
+	}
+
+	size_t Size() const
+	{
+		return count;
+	}
+
+	bool Full() const
+	{
+		return count == slots.size();
+	}
+
+	// Requires !Full().
+	void Push(FrameSlot* slot)
+	{
+		slots[(head + count) % slots.size()] = slot;
+		count++;
+	}
+
+	// Remove and return the oldest slot, or NULL if empty.
+	FrameSlot* PopOldest()
+	{
+		if (count == 0)
+			return NULL;
+		FrameSlot* slot = slots[head];
+		head = (head + 1) % slots.size();
+		count--;
+		return slot;
+	}
+
+	const FrameSlot* Oldest() const
+	{
+		return count ? slots[head] : NULL;
+	}
+
+private:
+	std::vector<FrameSlot*> slots;
+	size_t head;
+	size_t count;
+};
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- TRIGGER SOCKET -=-=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// UNIX datagram socket for external triggers: any datagram sent to it
+// (`echo | socat - UNIX-SENDTO:<path>`) is a trigger. The socket is
+// non-blocking and only bound here; ControlThread waits on it together with
+// the keyboard and SIGUSR1.
+class TriggerSource
+{
+public:
+	TriggerSource()
+		: socketFd(-1)
+	{
+	}
+
+	~TriggerSource()
+	{
+		Close();
+	}
+
+	// Bind the control socket. Throws on failure.
+	void Open(const std::string& path)
+	{
+		sockaddr_un address;
+		std::memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(address.sun_path))
+			throw std::runtime_error("Trigger socket path too long: " + path);
+		std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+		socketFd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (socketFd < 0)
+			throw std::runtime_error(std::string("Failed to create trigger socket: ") + std::strerror(errno));
+
+		unlink(path.c_str());
+		if (bind(socketFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+			throw std::runtime_error("Failed to bind trigger socket " + path + ": " + std::strerror(errno));
+		socketPath = path;
+	}
+
+	void Close()
+	{
+		if (socketFd >= 0)
+		{
+			close(socketFd);
+			socketFd = -1;
+			unlink(socketPath.c_str());
+		}
+	}
+
+	int Fd() const
+	{
+		return socketFd;
+	}
+
+	const std::string& SocketPath() const
+	{
+		return socketPath;
+	}
+
+private:
+	TriggerSource(const TriggerSource&);
+	TriggerSource& operator=(const TriggerSource&);
+
+	int socketFd;
+	std::string socketPath;
+};
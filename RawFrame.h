@@ -0,0 +1,72 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-= RAW FRAME FORMAT -=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// A raw frame is a RawFrameHeader followed by dataSize bytes of the original
+// pixel buffer, exactly as delivered by the camera. All fields are stored in
+// host (little-endian) byte order. Conversion to a displayable format is left
+// to offline tools, which can read the header, then pass the payload and
+// pixel format to ImageFactory::Create and ImageFactory::Convert.
+//
+// The payload starts at headerSize, not sizeof(RawFrameHeader): files written
+// with --direct-io zero pad the header to 4096 bytes so the payload is block
+// aligned on disk and can be written from the frame buffer without a copy.
+
+#define RAW_FRAME_MAGIC 0x5752414Cu // bytes "LARW" on disk
+#define RAW_FRAME_VERSION 1
+
+struct RawFrameHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	// sizeof(RawFrameHeader) for this version; readers skip to this offset
+	uint16_t headerSize;
+	uint32_t width;
+	uint32_t height;
+	// PFNC pixel format as returned by IImage::GetPixelFormat
+	uint64_t pixelFormat;
+	uint64_t frameId;
+	uint64_t timestampNs;
+	uint32_t bitsPerPixel;
+	uint32_t reserved;
+	uint64_t dataSize;
+};
+
+static_assert(sizeof(RawFrameHeader) == 56, "RawFrameHeader layout must not change");
+
+inline RawFrameHeader MakeRawFrameHeader(size_t width, size_t height, size_t bitsPerPixel, uint64_t pixelFormat,
+	uint64_t frameId, uint64_t timestampNs, uint64_t dataSize)
+{
+	RawFrameHeader header;
+	header.magic = RAW_FRAME_MAGIC;
+	header.version = RAW_FRAME_VERSION;
+	header.headerSize = static_cast<uint16_t>(sizeof(RawFrameHeader));
+	header.width = static_cast<uint32_t>(width);
+	header.height = static_cast<uint32_t>(height);
+	header.pixelFormat = pixelFormat;
+	header.frameId = frameId;
+	header.timestampNs = timestampNs;
+	header.bitsPerPixel = static_cast<uint32_t>(bitsPerPixel);
+	header.reserved = 0;
+	header.dataSize = dataSize;
+	return header;
+}
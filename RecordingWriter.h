@@ -0,0 +1,410 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include "DirectIo.h"
+#include "RawFrame.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- RECORDING CONTAINER -
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// A recording is a series of append-only segment files
+// ({directory}/recording-NNNNNN.lrec). Each segment is laid out as:
+//
+//    RecordingSegmentHeader, zero padded to RECORDING_ALIGNMENT
+//    frame records:
+//       RawFrameHeader, zero padded to RECORDING_ALIGNMENT
+//       dataSize bytes of the original pixel buffer, zero padded to RECORDING_ALIGNMENT
+//    RecordingIndexEntry[entryCount], sorted by offset
+//    RecordingFooter (last bytes of the file)
+//
+// Every record and every payload starts on an aligned offset, so each frame
+// is one large sequential write that also satisfies O_DIRECT. A reader seeks
+// to the footer to find the index. If a segment has no footer (the process
+// was killed), records can still be recovered by scanning aligned offsets for
+// RAW_FRAME_MAGIC. All fields are stored in host (little-endian) byte order.
+
+#define RECORDING_SEGMENT_MAGIC 0x4345524Cu // bytes "LREC" on disk
+#define RECORDING_FOOTER_MAGIC 0x5844494Cu  // bytes "LIDX" on disk
+#define RECORDING_VERSION 1
+#define RECORDING_ALIGNMENT 4096
+
+struct RecordingSegmentHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t headerSize;
+	uint32_t segmentIndex;
+	uint32_t alignment;
+	// wall clock time the segment was opened (ns since the Unix epoch)
+	uint64_t createdNs;
+};
+
+struct RecordingIndexEntry
+{
+	uint64_t frameId;
+	uint64_t timestampNs;
+	// offset of the record's RawFrameHeader; the payload starts at
+	// offset + RECORDING_ALIGNMENT
+	uint64_t offset;
+	// RECORDING_ALIGNMENT + dataSize (unpadded record length)
+	uint64_t length;
+};
+
+struct RecordingFooter
+{
+	uint64_t indexOffset;
+	uint64_t entryCount;
+	uint32_t magic;
+	uint32_t version;
+};
+
+static_assert(sizeof(RecordingIndexEntry) == 32, "RecordingIndexEntry layout must not change");
+static_assert(sizeof(RecordingFooter) == 24, "RecordingFooter layout must not change");
+
+inline uint64_t AlignRecording(uint64_t bytes)
+{
+	return (bytes + RECORDING_ALIGNMENT - 1) / RECORDING_ALIGNMENT * RECORDING_ALIGNMENT;
+}
+
+// Write an iovec list at an offset, retrying short writes and EINTR.
+// Returns 0 or an errno value. The iovecs are modified.
+inline int WriteVectorAt(int fd, iovec* parts, int count, uint64_t offset)
+{
+	int partIndex = 0;
+	while (partIndex < count)
+	{
+		ssize_t written = pwritev(fd, parts + partIndex, count - partIndex, static_cast<off_t>(offset));
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return errno;
+		}
+		if (written == 0)
+			return EIO;
+
+		offset += static_cast<uint64_t>(written);
+		size_t remaining = static_cast<size_t>(written);
+		while (partIndex < count && remaining >= parts[partIndex].iov_len)
+		{
+			remaining -= parts[partIndex].iov_len;
+			partIndex++;
+		}
+		if (partIndex < count)
+		{
+			parts[partIndex].iov_base = static_cast<uint8_t*>(parts[partIndex].iov_base) + remaining;
+			parts[partIndex].iov_len -= remaining;
+		}
+	}
+	return 0;
+}
+
+// Thread-safe recording writer. Save workers reserve space for a record
+// under a short lock and then write it with pwritev outside the lock, so
+// several large writes can be in flight on one segment while the file still
+// grows strictly sequentially. A segment is sealed when the next record would
+// exceed the segment size, and its index is written once the last in-flight
+// record on it completes. With directIo the segments are opened with O_DIRECT
+// (DirectIo.h); records are aligned already, only the index tail is not.
+class RecordingWriter
+{
+public:
+	RecordingWriter(const std::string& recordingDir, uint64_t maxSegmentBytes, bool directIo)
+		: directory(recordingDir)
+		, segmentBytes(maxSegmentBytes)
+		, direct(directIo)
+		, nextSegmentIndex(0)
+		, framesWritten(0)
+		, bytesWritten(0)
+		, segmentsClosed(0)
+	{
+		std::memset(zeroPad, 0, sizeof(zeroPad));
+		std::lock_guard<std::mutex> lock(mutex);
+		current = OpenSegment();
+	}
+
+	~RecordingWriter()
+	{
+		try
+		{
+			Close();
+		}
+		catch (...)
+		{
+		}
+	}
+
+	struct Segment;
+
+	struct Reservation
+	{
+		// Space reserved for one record; the segment stays open until the
+		// reservation is completed.
+		std::shared_ptr<Segment> segment;
+		int fd;
+		uint64_t offset;
+		// RECORDING_ALIGNMENT + dataSize
+		uint64_t length;
+		// length rounded up to RECORDING_ALIGNMENT
+		uint64_t padded;
+	};
+
+	// Reserve space for a frame record. The caller writes the header block at
+	// offset and the padded payload at offset + RECORDING_ALIGNMENT, then calls
+	// Complete. Safe to call from several threads.
+	Reservation Reserve(const RawFrameHeader& header)
+	{
+		Reservation reservation;
+		reservation.length = RECORDING_ALIGNMENT + header.dataSize;
+		reservation.padded = AlignRecording(reservation.length);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!current)
+			throw std::runtime_error("Recording is closed");
+
+		// roll over unless this would leave the segment empty
+		if (current->writeOffset > RECORDING_ALIGNMENT && current->writeOffset + reservation.padded > segmentBytes)
+		{
+			std::shared_ptr<Segment> sealed = current;
+			sealed->sealed = true;
+			current = OpenSegment();
+			if (sealed->inFlight == 0)
+				FinalizeSegment(*sealed);
+		}
+
+		reservation.segment = current;
+		reservation.fd = current->fd;
+		reservation.offset = current->writeOffset;
+		current->writeOffset += reservation.padded;
+		current->inFlight++;
+		return reservation;
+	}
+
+	// Finish a reserved record. error is 0 or the errno of the failed write;
+	// failed records are left out of the index. Throws if the write failed.
+	void Complete(const Reservation& reservation, const RawFrameHeader& header, int error)
+	{
+		RecordingIndexEntry entry;
+		entry.frameId = header.frameId;
+		entry.timestampNs = header.timestampNs;
+		entry.offset = reservation.offset;
+		entry.length = reservation.length;
+		CompleteRecord(reservation.segment, entry, error == 0);
+
+		if (error != 0)
+			throw std::runtime_error(std::string("Failed to write recording ") + reservation.segment->path + ": " + std::strerror(error));
+
+		framesWritten.fetch_add(1, std::memory_order_relaxed);
+		bytesWritten.fetch_add(reservation.padded, std::memory_order_relaxed);
+	}
+
+	// Append one frame record with a blocking write. Safe to call from
+	// several threads.
+	void Append(const RawFrameHeader& header, const uint8_t* pData)
+	{
+		Reservation reservation = Reserve(header);
+
+		iovec parts[4];
+		parts[0].iov_base = const_cast<RawFrameHeader*>(&header);
+		parts[0].iov_len = sizeof(header);
+		parts[1].iov_base = zeroPad;
+		parts[1].iov_len = RECORDING_ALIGNMENT - sizeof(header);
+		parts[2].iov_base = const_cast<uint8_t*>(pData);
+		parts[2].iov_len = static_cast<size_t>(header.dataSize);
+		parts[3].iov_base = zeroPad;
+		parts[3].iov_len = static_cast<size_t>(reservation.padded - reservation.length);
+		int error = WriteParts(reservation.fd, parts, parts[3].iov_len ? 4 : 3, reservation.offset);
+
+		Complete(reservation, header, error);
+	}
+
+	// Zero-filled block for callers that need to pad a record.
+	const uint8_t* ZeroPad() const
+	{
+		return zeroPad;
+	}
+
+	// Seal the current segment and write its index. All Append calls must
+	// have returned.
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!current)
+			return;
+		current->sealed = true;
+		if (current->inFlight == 0)
+			FinalizeSegment(*current);
+		current.reset();
+	}
+
+	// True if segments bypass the page cache; payloads written by other
+	// backends must then be aligned.
+	bool IsDirect() const
+	{
+		return direct;
+	}
+
+	uint64_t FramesWritten() const
+	{
+		return framesWritten.load(std::memory_order_relaxed);
+	}
+
+	uint64_t BytesWritten() const
+	{
+		return bytesWritten.load(std::memory_order_relaxed);
+	}
+
+	uint64_t SegmentsClosed() const
+	{
+		return segmentsClosed.load(std::memory_order_relaxed);
+	}
+
+	struct Segment
+	{
+		std::string path;
+		int fd;
+		uint64_t writeOffset;
+		size_t inFlight;
+		bool sealed;
+		std::vector<RecordingIndexEntry> index;
+	};
+
+private:
+	RecordingWriter(const RecordingWriter&);
+	RecordingWriter& operator=(const RecordingWriter&);
+
+	int WriteParts(int fd, iovec* parts, int count, uint64_t offset)
+	{
+		return direct ? WriteDirectAt(fd, parts, count, offset) : WriteVectorAt(fd, parts, count, offset);
+	}
+
+	// Caller holds the mutex.
+	std::shared_ptr<Segment> OpenSegment()
+	{
+		char name[32];
+		std::snprintf(name, sizeof(name), "/recording-%06u.lrec", nextSegmentIndex);
+
+		std::shared_ptr<Segment> segment(new Segment());
+		segment->path = directory + name;
+		segment->fd = open(segment->path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | (direct ? O_DIRECT : 0), 0644);
+		if (segment->fd < 0)
+			throw std::runtime_error("Failed to create recording " + segment->path + ": " + std::strerror(errno));
+		segment->writeOffset = RECORDING_ALIGNMENT;
+		segment->inFlight = 0;
+		segment->sealed = false;
+
+		timespec now;
+		clock_gettime(CLOCK_REALTIME, &now);
+
+		RecordingSegmentHeader header;
+		std::memset(&header, 0, sizeof(header));
+		header.magic = RECORDING_SEGMENT_MAGIC;
+		header.version = RECORDING_VERSION;
+		header.headerSize = static_cast<uint16_t>(sizeof(header));
+		header.segmentIndex = nextSegmentIndex;
+		header.alignment = RECORDING_ALIGNMENT;
+		header.createdNs = static_cast<uint64_t>(now.tv_sec) * 1000000000ull + static_cast<uint64_t>(now.tv_nsec);
+
+		iovec parts[2];
+		parts[0].iov_base = &header;
+		parts[0].iov_len = sizeof(header);
+		parts[1].iov_base = zeroPad;
+		parts[1].iov_len = RECORDING_ALIGNMENT - sizeof(header);
+		int error = WriteParts(segment->fd, parts, 2, 0);
+		if (error != 0)
+		{
+			close(segment->fd);
+			throw std::runtime_error("Failed to write recording " + segment->path + ": " + std::strerror(error));
+		}
+
+		nextSegmentIndex++;
+		return segment;
+	}
+
+	void CompleteRecord(const std::shared_ptr<Segment>& segment, const RecordingIndexEntry& entry, bool written)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (written)
+			segment->index.push_back(entry);
+		segment->inFlight--;
+		if (segment->sealed && segment->inFlight == 0)
+			FinalizeSegment(*segment);
+	}
+
+	// Write the index and footer after the last record and close the file.
+	// Caller holds the mutex.
+	void FinalizeSegment(Segment& segment)
+	{
+		if (segment.fd < 0)
+			return;
+
+		std::sort(segment.index.begin(), segment.index.end(), CompareOffset);
+
+		RecordingFooter footer;
+		footer.indexOffset = segment.writeOffset;
+		footer.entryCount = segment.index.size();
+		footer.magic = RECORDING_FOOTER_MAGIC;
+		footer.version = RECORDING_VERSION;
+
+		iovec parts[2];
+		parts[0].iov_base = segment.index.empty() ? NULL : &segment.index[0];
+		parts[0].iov_len = segment.index.size() * sizeof(RecordingIndexEntry);
+		parts[1].iov_base = &footer;
+		parts[1].iov_len = sizeof(footer);
+		int error = WriteParts(segment.fd, parts, 2, segment.writeOffset);
+
+		close(segment.fd);
+		segment.fd = -1;
+		segmentsClosed.fetch_add(1, std::memory_order_relaxed);
+
+		if (error != 0)
+			throw std::runtime_error("Failed to write recording index " + segment.path + ": " + std::strerror(error));
+	}
+
+	static bool CompareOffset(const RecordingIndexEntry& left, const RecordingIndexEntry& right)
+	{
+		return left.offset < right.offset;
+	}
+
+	std::string directory;
+	uint64_t segmentBytes;
+	bool direct;
+	unsigned int nextSegmentIndex;
+
+	std::mutex mutex;
+	std::shared_ptr<Segment> current;
+	uint8_t zeroPad[RECORDING_ALIGNMENT];
+
+	std::atomic<uint64_t> framesWritten;
+	std::atomic<uint64_t> bytesWritten;
+	std::atomic<uint64_t> segmentsClosed;
+};
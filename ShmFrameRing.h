@@ -0,0 +1,574 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include "RawFrame.h"
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <new>
+#include <signal.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#define SHM_RING_MAGIC 0x474E5246 // "FRNG"
+#define SHM_RING_VERSION 1
+// processes that can read one ring at the same time
+#define SHM_RING_MAX_READERS 16
+// slot headers and pixel data start on their own cache lines
+#define SHM_RING_ALIGNMENT 64
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "shared-memory ring needs lock-free atomics");
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- SHARED RING LAYOUT -=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// One POSIX shared-memory object per camera: a ShmRingHeader, then slotCount
+// slots of slotStride bytes, each a ShmSlotHeader followed by the pixels.
+// Frame n goes to slot n % slotCount. Its sequence is 2n+1 while the writer
+// copies it in and 2n+2 once complete (a seqlock), so readers can tell a
+// finished frame from one being overwritten without any lock.
+struct ShmReaderState
+{
+	// A reader process's claim on the ring and its progress, for the writer
+	// to report on. Only the owning reader writes it.
+	std::atomic<int32_t> pid;
+	uint32_t reserved;
+	std::atomic<uint64_t> nextFrame;
+	std::atomic<uint64_t> readFrames;
+	std::atomic<uint64_t> lostFrames;
+	uint8_t padding[SHM_RING_ALIGNMENT - 32];
+};
+
+struct ShmRingHeader
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t headerSize;
+	uint32_t slotCount;
+	uint32_t maxReaders;
+	uint64_t slotStride;
+	// largest frame a slot holds
+	uint64_t slotDataBytes;
+	int32_t writerPid;
+	// set when the writer closes the ring; no more frames will come
+	std::atomic<uint32_t> closed;
+	uint8_t padding0[SHM_RING_ALIGNMENT - 40];
+
+	// frames published so far
+	std::atomic<uint64_t> published;
+	// futex readers park on while waiting for a frame; the writer only
+	// makes the wake syscall while waiters is non-zero
+	std::atomic<uint32_t> epoch;
+	std::atomic<uint32_t> waiters;
+	uint8_t padding1[SHM_RING_ALIGNMENT - 16];
+
+	ShmReaderState readers[SHM_RING_MAX_READERS];
+};
+
+struct ShmSlotHeader
+{
+	std::atomic<uint64_t> sequence;
+	uint64_t reserved;
+	RawFrameHeader frame;
+	uint8_t padding[2 * SHM_RING_ALIGNMENT - 72];
+};
+
+static_assert(sizeof(ShmReaderState) == SHM_RING_ALIGNMENT, "reader state must fill one cache line");
+static_assert(sizeof(ShmRingHeader) == SHM_RING_ALIGNMENT * (2 + SHM_RING_MAX_READERS), "ShmRingHeader layout must not change");
+static_assert(sizeof(ShmSlotHeader) == 2 * SHM_RING_ALIGNMENT, "slot header must fill two cache lines");
+
+inline uint64_t ShmRingAlign(uint64_t bytes)
+{
+	return (bytes + SHM_RING_ALIGNMENT - 1) / SHM_RING_ALIGNMENT * SHM_RING_ALIGNMENT;
+}
+
+// Shared (not process-private) futex operations on the ring's epoch.
+inline void ShmRingFutexWait(std::atomic<uint32_t>* word, uint32_t expected, const timespec* timeout)
+{
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected, timeout, NULL, 0);
+}
+
+inline void ShmRingFutexWake(std::atomic<uint32_t>* word)
+{
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-= SHARED RING WRITER -=
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+struct ShmReaderStatus
+{
+	int32_t pid;
+	// frames published that the reader has not got to yet
+	uint64_t behind;
+	uint64_t readFrames;
+	uint64_t lostFrames;
+};
+
+// Publishes frames for readers in other processes. Publish copies the frame
+// into the next slot and never waits: a reader that falls more than
+// slotCount frames behind loses the frames that were overwritten and counts
+// them, which both sides can see. Used by one thread only.
+class ShmFrameWriter
+{
+public:
+	ShmFrameWriter()
+		: fd(-1)
+		, header(NULL)
+		, mappedBytes(0)
+		, published(0)
+		, oversizeCount(0)
+		, wakeCount(0)
+	{
+	}
+
+	~ShmFrameWriter()
+	{
+		Close();
+	}
+
+	// Create (or replace) the shared-memory object, e.g. "/camera0", with
+	// slots for frames of up to slotBytes. Throws on failure.
+	void Create(const std::string& objectName, size_t slotCount, size_t slotBytes)
+	{
+		if (slotCount == 0 || slotCount > UINT32_MAX)
+			throw std::runtime_error("Invalid shared-memory slot count");
+
+		// readers of a previous run keep their mapping of the old object
+		shm_unlink(objectName.c_str());
+		fd = shm_open(objectName.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+		if (fd < 0)
+			throw std::runtime_error("Failed to create shared memory " + objectName + ": " + std::strerror(errno));
+		name = objectName;
+
+		uint64_t slotStride = ShmRingAlign(sizeof(ShmSlotHeader) + slotBytes);
+		mappedBytes = sizeof(ShmRingHeader) + slotStride * slotCount;
+		if (ftruncate(fd, static_cast<off_t>(mappedBytes)) != 0)
+			Fail("size");
+		// MAP_POPULATE faults the pages in now rather than on the first frames
+		void* mapping = mmap(NULL, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+		if (mapping == MAP_FAILED)
+			Fail("map");
+
+		header = new (mapping) ShmRingHeader();
+		header->version = SHM_RING_VERSION;
+		header->headerSize = static_cast<uint16_t>(sizeof(ShmRingHeader));
+		header->slotCount = static_cast<uint32_t>(slotCount);
+		header->maxReaders = SHM_RING_MAX_READERS;
+		header->slotStride = slotStride;
+		header->slotDataBytes = slotBytes;
+		header->writerPid = static_cast<int32_t>(getpid());
+		header->closed.store(0, std::memory_order_relaxed);
+		header->published.store(0, std::memory_order_relaxed);
+		header->epoch.store(0, std::memory_order_relaxed);
+		header->waiters.store(0, std::memory_order_relaxed);
+		for (size_t i = 0; i < SHM_RING_MAX_READERS; i++)
+			header->readers[i].pid.store(0, std::memory_order_relaxed);
+		for (size_t i = 0; i < slotCount; i++)
+			new (Slot(i)) ShmSlotHeader();
+		// readers check the magic last
+		std::atomic_thread_fence(std::memory_order_release);
+		header->magic = SHM_RING_MAGIC;
+		published = 0;
+	}
+
+	bool IsOpen() const
+	{
+		return header != NULL;
+	}
+
+	// Copy a frame into the next slot and wake parked readers. Returns false
+	// (and counts it) if the frame is larger than a slot.
+	bool Publish(const RawFrameHeader& frame, const uint8_t* pData)
+	{
+		if (frame.dataSize > header->slotDataBytes)
+		{
+			oversizeCount++;
+			return false;
+		}
+
+		ShmSlotHeader* slot = Slot(published % header->slotCount);
+		slot->sequence.store(2 * published + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot->frame = frame;
+		std::memcpy(reinterpret_cast<uint8_t*>(slot) + sizeof(ShmSlotHeader), pData, frame.dataSize);
+		slot->sequence.store(2 * published + 2, std::memory_order_release);
+
+		published++;
+		header->published.store(published, std::memory_order_release);
+		Notify();
+		return true;
+	}
+
+	// Reader processes attached now, forgetting ones that have exited
+	// without closing.
+	std::vector<ShmReaderStatus> Readers()
+	{
+		std::vector<ShmReaderStatus> readers;
+		for (size_t i = 0; i < SHM_RING_MAX_READERS; i++)
+		{
+			ShmReaderState& state = header->readers[i];
+			int32_t pid = state.pid.load(std::memory_order_acquire);
+			if (pid == 0)
+				continue;
+			if (kill(pid, 0) != 0 && errno == ESRCH)
+			{
+				state.pid.compare_exchange_strong(pid, 0, std::memory_order_acq_rel);
+				continue;
+			}
+
+			ShmReaderStatus status;
+			status.pid = pid;
+			uint64_t next = state.nextFrame.load(std::memory_order_relaxed);
+			status.behind = next < published ? published - next : 0;
+			status.readFrames = state.readFrames.load(std::memory_order_relaxed);
+			status.lostFrames = state.lostFrames.load(std::memory_order_relaxed);
+			readers.push_back(status);
+		}
+		return readers;
+	}
+
+	// Mark the ring closed, wake readers and remove the object. Readers keep
+	// their mapping until they close it.
+	void Close()
+	{
+		if (header)
+		{
+			header->closed.store(1, std::memory_order_release);
+			header->epoch.fetch_add(1, std::memory_order_release);
+			ShmRingFutexWake(&header->epoch);
+			munmap(header, mappedBytes);
+			header = NULL;
+		}
+		if (fd >= 0)
+		{
+			close(fd);
+			shm_unlink(name.c_str());
+			fd = -1;
+		}
+	}
+
+	const std::string& Name() const
+	{
+		return name;
+	}
+
+	size_t SlotCount() const
+	{
+		return header ? header->slotCount : 0;
+	}
+
+	uint64_t Published() const
+	{
+		return published;
+	}
+
+	uint64_t OversizeCount() const
+	{
+		return oversizeCount;
+	}
+
+	// wake syscalls made for parked readers
+	uint64_t WakeCount() const
+	{
+		return wakeCount;
+	}
+
+private:
+	ShmFrameWriter(const ShmFrameWriter&);
+	ShmFrameWriter& operator=(const ShmFrameWriter&);
+
+	ShmSlotHeader* Slot(uint64_t index) const
+	{
+		return reinterpret_cast<ShmSlotHeader*>(reinterpret_cast<uint8_t*>(header) + sizeof(ShmRingHeader) + index * header->slotStride);
+	}
+
+	void Notify()
+	{
+		// pairs with the seq_cst increment in ShmFrameReader::Read so either
+		// the reader sees the frame or we see the reader
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (header->waiters.load(std::memory_order_relaxed) == 0)
+			return;
+		header->epoch.fetch_add(1, std::memory_order_release);
+		ShmRingFutexWake(&header->epoch);
+		wakeCount++;
+	}
+
+	void Fail(const char* what)
+	{
+		int error = errno;
+		close(fd);
+		shm_unlink(name.c_str());
+		fd = -1;
+		throw std::runtime_error("Failed to " + std::string(what) + " shared memory " + name + ": " + std::strerror(error));
+	}
+
+	std::string name;
+	int fd;
+	ShmRingHeader* header;
+	uint64_t mappedBytes;
+	uint64_t published;
+	uint64_t oversizeCount;
+	uint64_t wakeCount;
+};
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-= SHARED RING READER -=
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Reader side for other processes; include this header and link nothing
+// else. Readers start at the newest frame and copy each frame out, so a
+// frame stays valid however long the caller keeps it. When the writer laps
+// a reader the overwritten frames are skipped and counted in LostFrames.
+//
+//    ShmFrameReader reader;
+//    reader.Open("/camera0");
+//    RawFrameHeader frame;
+//    std::vector<uint8_t> pixels;
+//    while (reader.Read(frame, pixels, 1000) || !reader.WriterClosed())
+//        ...
+class ShmFrameReader
+{
+public:
+	ShmFrameReader()
+		: header(NULL)
+		, state(NULL)
+		, mappedBytes(0)
+		, nextFrame(0)
+		, readFrames(0)
+		, lostFrames(0)
+	{
+	}
+
+	~ShmFrameReader()
+	{
+		Close();
+	}
+
+	// Attach to a ring created by ShmFrameWriter. Throws on failure, a
+	// version mismatch or when SHM_RING_MAX_READERS readers are attached.
+	void Open(const std::string& objectName)
+	{
+		int fd = shm_open(objectName.c_str(), O_RDWR | O_CLOEXEC, 0);
+		if (fd < 0)
+			throw std::runtime_error("Failed to open shared memory " + objectName + ": " + std::strerror(errno));
+		struct stat info;
+		if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(ShmRingHeader))
+		{
+			close(fd);
+			throw std::runtime_error("Shared memory " + objectName + " is not a frame ring");
+		}
+		mappedBytes = static_cast<uint64_t>(info.st_size);
+		void* mapping = mmap(NULL, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		int error = errno;
+		close(fd);
+		if (mapping == MAP_FAILED)
+			throw std::runtime_error("Failed to map shared memory " + objectName + ": " + std::strerror(error));
+		header = static_cast<ShmRingHeader*>(mapping);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (header->magic != SHM_RING_MAGIC || header->version != SHM_RING_VERSION ||
+			sizeof(ShmRingHeader) + header->slotStride * header->slotCount > mappedBytes)
+		{
+			Close();
+			throw std::runtime_error("Shared memory " + objectName + " is not a compatible frame ring");
+		}
+
+		int32_t pid = static_cast<int32_t>(getpid());
+		for (size_t i = 0; i < SHM_RING_MAX_READERS && !state; i++)
+		{
+			int32_t expected = 0;
+			if (header->readers[i].pid.compare_exchange_strong(expected, pid, std::memory_order_acq_rel))
+				state = &header->readers[i];
+		}
+		if (!state)
+		{
+			Close();
+			throw std::runtime_error("Shared memory " + objectName + " has no free reader slot");
+		}
+
+		nextFrame = header->published.load(std::memory_order_acquire);
+		readFrames = 0;
+		lostFrames = 0;
+		state->readFrames.store(0, std::memory_order_relaxed);
+		state->lostFrames.store(0, std::memory_order_relaxed);
+		state->nextFrame.store(nextFrame, std::memory_order_relaxed);
+	}
+
+	// Copy the next frame out if one is ready. Never blocks.
+	bool TryRead(RawFrameHeader& frame, std::vector<uint8_t>& pixels)
+	{
+		for (;;)
+		{
+			uint64_t published = header->published.load(std::memory_order_acquire);
+			if (nextFrame >= published)
+				return false;
+			if (published - nextFrame > header->slotCount)
+				Lose(published - header->slotCount - nextFrame);
+
+			const ShmSlotHeader* slot = Slot(nextFrame % header->slotCount);
+			uint64_t sequence = slot->sequence.load(std::memory_order_acquire);
+			if (sequence == 2 * nextFrame + 2)
+			{
+				frame = slot->frame;
+				if (frame.dataSize <= header->slotDataBytes)
+				{
+					pixels.resize(frame.dataSize);
+					std::memcpy(pixels.data(), reinterpret_cast<const uint8_t*>(slot) + sizeof(ShmSlotHeader), frame.dataSize);
+				}
+				// the copy is only good if the writer did not start on the slot meanwhile
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (slot->sequence.load(std::memory_order_relaxed) == sequence && frame.dataSize <= header->slotDataBytes)
+				{
+					nextFrame++;
+					readFrames++;
+					state->readFrames.store(readFrames, std::memory_order_relaxed);
+					state->nextFrame.store(nextFrame, std::memory_order_relaxed);
+					return true;
+				}
+			}
+			// overwritten before or while copying
+			Lose(1);
+		}
+	}
+
+	// Wait up to timeoutMs (negative = forever) for the next frame. Returns
+	// false on timeout or once the writer has closed the ring.
+	bool Read(RawFrameHeader& frame, std::vector<uint8_t>& pixels, int timeoutMs)
+	{
+		timespec deadline;
+		clock_gettime(CLOCK_MONOTONIC, &deadline);
+		AddMs(deadline, timeoutMs);
+		for (;;)
+		{
+			if (TryRead(frame, pixels))
+				return true;
+			if (WriterClosed())
+				return false;
+
+			header->waiters.fetch_add(1, std::memory_order_seq_cst);
+			uint32_t epoch = header->epoch.load(std::memory_order_seq_cst);
+			if (header->published.load(std::memory_order_seq_cst) > nextFrame || WriterClosed())
+			{
+				header->waiters.fetch_sub(1, std::memory_order_relaxed);
+				continue;
+			}
+
+			timespec remaining;
+			timespec* pTimeout = NULL;
+			if (timeoutMs >= 0)
+			{
+				if (!Remaining(deadline, remaining))
+				{
+					header->waiters.fetch_sub(1, std::memory_order_relaxed);
+					return false;
+				}
+				pTimeout = &remaining;
+			}
+			ShmRingFutexWait(&header->epoch, epoch, pTimeout);
+			header->waiters.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+
+	bool WriterClosed() const
+	{
+		return header->closed.load(std::memory_order_acquire) != 0;
+	}
+
+	// frames copied out, and frames overwritten before this reader got to them
+	uint64_t ReadFrames() const
+	{
+		return readFrames;
+	}
+
+	uint64_t LostFrames() const
+	{
+		return lostFrames;
+	}
+
+	void Close()
+	{
+		if (state)
+			state->pid.store(0, std::memory_order_release);
+		state = NULL;
+		if (header)
+			munmap(header, mappedBytes);
+		header = NULL;
+	}
+
+private:
+	ShmFrameReader(const ShmFrameReader&);
+	ShmFrameReader& operator=(const ShmFrameReader&);
+
+	const ShmSlotHeader* Slot(uint64_t index) const
+	{
+		return reinterpret_cast<const ShmSlotHeader*>(reinterpret_cast<const uint8_t*>(header) + sizeof(ShmRingHeader) + index * header->slotStride);
+	}
+
+	void Lose(uint64_t count)
+	{
+		nextFrame += count;
+		lostFrames += count;
+		state->lostFrames.store(lostFrames, std::memory_order_relaxed);
+		state->nextFrame.store(nextFrame, std::memory_order_relaxed);
+	}
+
+	static void AddMs(timespec& time, int ms)
+	{
+		if (ms < 0)
+			return;
+		time.tv_sec += ms / 1000;
+		time.tv_nsec += static_cast<long>(ms % 1000) * 1000000L;
+		if (time.tv_nsec >= 1000000000L)
+		{
+			time.tv_sec++;
+			time.tv_nsec -= 1000000000L;
+		}
+	}
+
+	// Time left until an absolute CLOCK_MONOTONIC deadline; false once passed.
+	static bool Remaining(const timespec& deadline, timespec& remaining)
+	{
+		timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		int64_t ns = (static_cast<int64_t>(deadline.tv_sec) - now.tv_sec) * 1000000000LL + (deadline.tv_nsec - now.tv_nsec);
+		if (ns <= 0)
+			return false;
+		remaining.tv_sec = static_cast<time_t>(ns / 1000000000LL);
+		remaining.tv_nsec = static_cast<long>(ns % 1000000000LL);
+		return true;
+	}
+
+	ShmRingHeader* header;
+	ShmReaderState* state;
+	uint64_t mappedBytes;
+	uint64_t nextFrame;
+	uint64_t readFrames;
+	uint64_t lostFrames;
+};
@@ -0,0 +1,285 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include "LatencyHistogram.h"
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- JOB STAGE STAMPS -=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Points in a saved frame's life, stamped with the monotonic clock. Each
+// stamp ends the stage named after it, which began at the previous stamp
+// that was set. Stamps that do not apply (no pipeline, no conversion, no
+// fsync, frames from the pre-trigger ring) stay 0 and their stage is skipped.
+enum TraceStamp
+{
+	TRACE_REQUESTED, // GetImage called
+	TRACE_RECEIVED,  // GetImage returned: "get_image"
+	TRACE_ADMITTED,  // save queue had room: "admit"
+	TRACE_COPIED,    // frame copied and queued: "copy"
+	TRACE_DEQUEUED,  // taken by a save worker: "queue"
+	TRACE_PROCESSED, // through the --stage pipeline: "pipeline"
+	TRACE_CONVERTED, // converted to PIXEL_FORMAT: "convert"
+	TRACE_ENCODED,   // PNG encoded in memory: "encode"
+	TRACE_WRITTEN,   // write returned: "write"
+	TRACE_SYNCED,    // data on stable storage (--fsync): "sync"
+	TRACE_STAMP_COUNT
+};
+
+#define TRACE_STAGE_COUNT (TRACE_STAMP_COUNT - 1)
+
+inline const char* GetTraceStageName(int stage)
+{
+	static const char* const names[TRACE_STAGE_COUNT] = {"get_image", "admit", "copy", "queue", "pipeline", "convert", "encode", "write", "sync"};
+	return stage >= 0 && stage < TRACE_STAGE_COUNT ? names[stage] : "unknown";
+}
+
+inline uint64_t TraceNowNs()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+struct JobTrace
+{
+	uint64_t stamps[TRACE_STAMP_COUNT];
+	uint64_t frameId;
+	// trace thread of the acquisition loop that received the frame
+	uint32_t sourceTid;
+
+	void Reset(uint64_t id, uint32_t tid = 0)
+	{
+		std::memset(stamps, 0, sizeof(stamps));
+		frameId = id;
+		sourceTid = tid;
+	}
+
+	void Mark(TraceStamp stamp)
+	{
+		stamps[stamp] = TraceNowNs();
+	}
+};
+
+// Trace of the job the calling save worker is working on, so the save
+// functions can stamp conversion and encoding without taking a trace
+// parameter. NULL outside a job.
+inline JobTrace*& CurrentJobTrace()
+{
+	static thread_local JobTrace* trace = NULL;
+	return trace;
+}
+
+inline void MarkCurrentJob(TraceStamp stamp)
+{
+	JobTrace* trace = CurrentJobTrace();
+	if (trace)
+		trace->Mark(stamp);
+}
+
+struct JobTraceScope
+{
+	// Makes a trace current for the lifetime of the scope.
+	explicit JobTraceScope(JobTrace* trace)
+	{
+		CurrentJobTrace() = trace;
+	}
+	~JobTraceScope()
+	{
+		CurrentJobTrace() = NULL;
+	}
+};
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- STAGE HISTOGRAMS -=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Per-stage latency of finished jobs plus the total from the first stamp
+// after GetImage to the last one. One per save worker; merge for reporting.
+class StageHistograms
+{
+public:
+	void Record(const JobTrace& trace)
+	{
+		uint64_t first = 0;
+		uint64_t previous = trace.stamps[TRACE_REQUESTED];
+		for (int i = TRACE_RECEIVED; i < TRACE_STAMP_COUNT; i++)
+		{
+			uint64_t stamp = trace.stamps[i];
+			if (stamp == 0)
+				continue;
+			if (previous != 0 && stamp >= previous)
+				stages[i - 1].Record(stamp - previous);
+			if (first == 0)
+				first = stamp;
+			previous = stamp;
+		}
+		if (first != 0 && previous > first)
+			total.Record(previous - first);
+	}
+
+	void Merge(const StageHistograms& other)
+	{
+		for (int i = 0; i < TRACE_STAGE_COUNT; i++)
+			stages[i].Merge(other.stages[i]);
+		total.Merge(other.total);
+	}
+
+	const LatencyHistogram& Stage(int stage) const
+	{
+		return stages[stage];
+	}
+
+	const LatencyHistogram& Total() const
+	{
+		return total;
+	}
+
+private:
+	LatencyHistogram stages[TRACE_STAGE_COUNT];
+	LatencyHistogram total;
+};
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- CHROME TRACE FILE -=-=
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Writes finished jobs as Chrome trace events (JSON array format), which
+// Perfetto and chrome://tracing open directly. Acquisition stages go on the
+// job's source thread (one per camera) and worker stages on the worker's
+// thread; name both with NameThread. Queue waits, and io_uring writes that
+// overlap on one worker, are async events keyed by source thread and frame
+// ID. Only save workers write, under a mutex, once per finished job.
+class TraceFile
+{
+public:
+	TraceFile()
+		: originNs(0)
+		, first(true)
+	{
+	}
+
+	~TraceFile()
+	{
+		Close();
+	}
+
+	// Throws on failure.
+	void Open(const std::string& path)
+	{
+		out.open(path.c_str(), std::ios::out | std::ios::trunc);
+		if (!out)
+			throw std::runtime_error("Failed to open trace file " + path + ": " + std::strerror(errno));
+		out << std::fixed << std::setprecision(3) << "[\n";
+		originNs = TraceNowNs();
+		first = true;
+	}
+
+	bool IsOpen() const
+	{
+		return out.is_open();
+	}
+
+	void NameThread(uint32_t tid, const std::string& name)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!out.is_open())
+			return;
+		Separate();
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":\"" << name << "\"}}";
+	}
+
+	// Write one event per stage of a finished job.
+	void WriteJob(const JobTrace& trace, uint32_t workerTid, bool overlappedWrites)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!out.is_open())
+			return;
+
+		uint64_t previous = trace.stamps[TRACE_REQUESTED];
+		for (int i = TRACE_RECEIVED; i < TRACE_STAMP_COUNT; i++)
+		{
+			uint64_t stamp = trace.stamps[i];
+			if (stamp == 0)
+				continue;
+			if (previous != 0 && stamp >= previous)
+			{
+				const char* name = GetTraceStageName(i - 1);
+				if (i == TRACE_DEQUEUED || (i == TRACE_WRITTEN && overlappedWrites))
+					WriteAsync(name, previous, stamp, trace.sourceTid, trace.frameId);
+				else
+					WriteComplete(name, i <= TRACE_COPIED ? trace.sourceTid : workerTid, previous, stamp, trace.frameId);
+			}
+			previous = stamp;
+		}
+	}
+
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (!out.is_open())
+			return;
+		out << "\n]\n";
+		out.close();
+	}
+
+private:
+	TraceFile(const TraceFile&);
+	TraceFile& operator=(const TraceFile&);
+
+	// Caller holds the mutex for the helpers below.
+	void Separate()
+	{
+		if (!first)
+			out << ",\n";
+		first = false;
+	}
+
+	double Microseconds(uint64_t ns) const
+	{
+		return ns > originNs ? static_cast<double>(ns - originNs) / 1000.0 : 0.0;
+	}
+
+	void WriteComplete(const char* name, uint32_t tid, uint64_t beginNs, uint64_t endNs, uint64_t frameId)
+	{
+		Separate();
+		out << "{\"name\":\"" << name << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << Microseconds(beginNs)
+			<< ",\"dur\":" << static_cast<double>(endNs - beginNs) / 1000.0 << ",\"args\":{\"frame_id\":" << frameId << "}}";
+	}
+
+	// Frame IDs repeat across cameras, so the async ID is "sourceTid:frameId".
+	void WriteAsync(const char* name, uint64_t beginNs, uint64_t endNs, uint32_t sourceTid, uint64_t frameId)
+	{
+		Separate();
+		out << "{\"name\":\"" << name << "\",\"cat\":\"frame\",\"ph\":\"b\",\"pid\":1,\"id\":\"" << sourceTid << ":" << frameId
+			<< "\",\"ts\":" << Microseconds(beginNs) << "}";
+		Separate();
+		out << "{\"name\":\"" << name << "\",\"cat\":\"frame\",\"ph\":\"e\",\"pid\":1,\"id\":\"" << sourceTid << ":" << frameId
+			<< "\",\"ts\":" << Microseconds(endNs) << "}";
+	}
+
+	std::mutex mutex;
+	std::ofstream out;
+	uint64_t originNs;
+	bool first;
+};
@@ -0,0 +1,398 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+// ioprio_set(2) and ioprio_get(2) have no glibc wrappers; values from
+// linux/ioprio.h
+#define THREAD_IOPRIO_CLASS_SHIFT 13
+#define THREAD_IOPRIO_WHO_PROCESS 1
+
+enum ThreadIoClass
+{
+	THREAD_IO_CLASS_NONE, // derived from the nice value
+	THREAD_IO_CLASS_RT,
+	THREAD_IO_CLASS_BE,
+	THREAD_IO_CLASS_IDLE
+};
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-= CPU TOPOLOGY -=-=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Relative capacity of a CPU: cpu_capacity on ARM big.LITTLE systems (1024
+// for the biggest cores), otherwise the maximum frequency in kHz, or 0 if
+// neither is known.
+inline unsigned long ReadCpuCapacity(int cpu)
+{
+	static const char* const files[] = {"cpu_capacity", "cpufreq/cpuinfo_max_freq"};
+	for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+	{
+		char path[128];
+		std::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", cpu, files[i]);
+		FILE* file = std::fopen(path, "r");
+		if (!file)
+			continue;
+		unsigned long value = 0;
+		int matched = std::fscanf(file, "%lu", &value);
+		std::fclose(file);
+		if (matched == 1)
+			return value;
+	}
+	return 0;
+}
+
+// CPUs the process may run on.
+inline std::vector<int> GetAllowedCpus()
+{
+	std::vector<int> cpus;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) != 0)
+		return cpus;
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+	{
+		if (CPU_ISSET(cpu, &set))
+			cpus.push_back(cpu);
+	}
+	return cpus;
+}
+
+// Allowed CPUs with the highest capacity ("big") or the others ("little").
+// On a system where all CPUs are alike both are every allowed CPU.
+inline std::vector<int> GetCpusByCapacity(bool big)
+{
+	std::vector<int> allowed = GetAllowedCpus();
+	std::vector<unsigned long> capacities(allowed.size());
+	unsigned long highest = 0;
+	for (size_t i = 0; i < allowed.size(); i++)
+	{
+		capacities[i] = ReadCpuCapacity(allowed[i]);
+		if (capacities[i] > highest)
+			highest = capacities[i];
+	}
+
+	std::vector<int> cpus;
+	for (size_t i = 0; i < allowed.size(); i++)
+	{
+		if ((capacities[i] == highest) == big)
+			cpus.push_back(allowed[i]);
+	}
+	return cpus.empty() ? allowed : cpus;
+}
+
+// Format CPUs in ascending order as a list with ranges, e.g. "0-3,6".
+inline std::string FormatCpuList(const std::vector<int>& cpus)
+{
+	std::ostringstream out;
+	for (size_t i = 0; i < cpus.size();)
+	{
+		size_t end = i;
+		while (end + 1 < cpus.size() && cpus[end + 1] == cpus[end] + 1)
+			end++;
+		out << (i ? "," : "") << cpus[i];
+		if (end > i)
+			out << "-" << cpus[end];
+		i = end + 1;
+	}
+	return out.str();
+}
+
+// Parse "big", "little" or a list such as "0-3,6". Throws on bad syntax.
+inline std::vector<int> ParseCpuList(const std::string& text)
+{
+	if (text == "big" || text == "little")
+		return GetCpusByCapacity(text == "big");
+
+	bool present[CPU_SETSIZE] = {};
+	const char* p = text.c_str();
+	while (*p)
+	{
+		char* end = NULL;
+		long first = std::strtol(p, &end, 10);
+		long last = first;
+		if (end == p || first < 0 || first >= CPU_SETSIZE)
+			throw std::runtime_error("Invalid CPU list: " + text);
+		p = end;
+		if (*p == '-')
+		{
+			last = std::strtol(++p, &end, 10);
+			if (end == p || last < first || last >= CPU_SETSIZE)
+				throw std::runtime_error("Invalid CPU list: " + text);
+			p = end;
+		}
+		for (long cpu = first; cpu <= last; cpu++)
+			present[cpu] = true;
+		if (*p == ',')
+			p++;
+		else if (*p)
+			throw std::runtime_error("Invalid CPU list: " + text);
+	}
+
+	std::vector<int> cpus;
+	for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+	{
+		if (present[cpu])
+			cpus.push_back(cpu);
+	}
+	if (cpus.empty())
+		throw std::runtime_error("Invalid CPU list: " + text);
+	return cpus;
+}
+
+// CPUs in a kernel CPU list file such as local_cpulist, or none if the file
+// is missing or unreadable.
+inline std::vector<int> ReadCpuListFile(const std::string& path)
+{
+	FILE* file = std::fopen(path.c_str(), "r");
+	if (!file)
+		return std::vector<int>();
+	char line[4096];
+	bool read = std::fgets(line, sizeof(line), file) != NULL;
+	std::fclose(file);
+	if (!read)
+		return std::vector<int>();
+	line[std::strcspn(line, "\n")] = '\0';
+	try
+	{
+		return ParseCpuList(line);
+	}
+	catch (std::exception&)
+	{
+		return std::vector<int>();
+	}
+}
+
+// Allowed CPUs that handle a network interface's interrupts: the union of
+// the smp_affinity_list of its MSI vectors, narrowed to the device's NUMA
+// node (local_cpulist) where the two overlap. Falls back to the NUMA node
+// alone, and returns nothing for interfaces without a device (lo, bridges,
+// VLANs on top of another interface). irqbalance may move the vectors
+// later; pin them (or stop irqbalance) for a stable mapping.
+inline std::vector<int> GetInterfaceIrqCpus(const std::string& interfaceName)
+{
+	std::string device = "/sys/class/net/" + interfaceName + "/device/";
+	bool irqCpus[CPU_SETSIZE] = {};
+	DIR* dir = opendir((device + "msi_irqs").c_str());
+	if (dir)
+	{
+		for (dirent* entry = readdir(dir); entry; entry = readdir(dir))
+		{
+			if (entry->d_name[0] == '.')
+				continue;
+			std::vector<int> cpus = ReadCpuListFile("/proc/irq/" + std::string(entry->d_name) + "/smp_affinity_list");
+			for (size_t i = 0; i < cpus.size(); i++)
+				irqCpus[cpus[i]] = true;
+		}
+		closedir(dir);
+	}
+	bool localCpus[CPU_SETSIZE] = {};
+	std::vector<int> local = ReadCpuListFile(device + "local_cpulist");
+	for (size_t i = 0; i < local.size(); i++)
+		localCpus[local[i]] = true;
+
+	// allowed CPUs that are both IRQ and NUMA local, else either
+	std::vector<int> allowed = GetAllowedCpus();
+	std::vector<int> both;
+	std::vector<int> irqOnly;
+	std::vector<int> localOnly;
+	for (size_t i = 0; i < allowed.size(); i++)
+	{
+		int cpu = allowed[i];
+		if (irqCpus[cpu] && localCpus[cpu])
+			both.push_back(cpu);
+		if (irqCpus[cpu])
+			irqOnly.push_back(cpu);
+		if (localCpus[cpu])
+			localOnly.push_back(cpu);
+	}
+	if (!both.empty())
+		return both;
+	return irqOnly.empty() ? localOnly : irqOnly;
+}
+
+// Describe the allowed CPUs grouped by capacity, e.g. "0-3: 446, 4-7: 1024".
+// Empty when all CPUs are alike.
+inline std::string DescribeCpuCapacities()
+{
+	std::vector<int> little = GetCpusByCapacity(false);
+	std::vector<int> big = GetCpusByCapacity(true);
+	if (little == big)
+		return std::string();
+
+	std::ostringstream out;
+	out << FormatCpuList(little) << " little, " << FormatCpuList(big) << " big (capacity " << ReadCpuCapacity(big[0]) << ")";
+	return out.str();
+}
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- THREAD PLACEMENT -=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+struct ThreadPlacement
+{
+	// How a thread should run; defaults leave everything unchanged.
+	std::vector<int> cpus;
+	// SCHED_FIFO priority 1-99; 0 keeps the normal time-sharing scheduler.
+	int fifoPriority;
+	// nice value -20..19, applied when setNice is true
+	bool setNice;
+	int nice;
+	// I/O priority class and level 0 (highest) - 7; NONE keeps the default
+	int ioClass;
+	int ioLevel;
+
+	ThreadPlacement()
+		: fifoPriority(0)
+		, setNice(false)
+		, nice(0)
+		, ioClass(THREAD_IO_CLASS_NONE)
+		, ioLevel(4)
+	{
+	}
+};
+
+// Parse "rt[:level]", "be[:level]" or "idle". Throws on bad syntax.
+inline void ParseIoPriority(const std::string& text, ThreadPlacement& placement)
+{
+	std::string name = text.substr(0, text.find(':'));
+	if (name == "rt")
+		placement.ioClass = THREAD_IO_CLASS_RT;
+	else if (name == "be")
+		placement.ioClass = THREAD_IO_CLASS_BE;
+	else if (name == "idle" && name == text)
+		placement.ioClass = THREAD_IO_CLASS_IDLE;
+	else
+		throw std::runtime_error("Invalid I/O priority: " + text);
+
+	placement.ioLevel = 4;
+	if (name != text)
+	{
+		const char* level = text.c_str() + name.size() + 1;
+		char* end = NULL;
+		long value = std::strtol(level, &end, 10);
+		if (end == level || *end != '\0' || value < 0 || value > 7)
+			throw std::runtime_error("Invalid I/O priority: " + text);
+		placement.ioLevel = static_cast<int>(value);
+	}
+}
+
+// Apply a placement to the calling thread. Every setting is attempted; the
+// ones that fail (typically SCHED_FIFO, negative nice or the rt I/O class
+// without CAP_SYS_NICE) are returned as "setting (error), ...", or "" if all
+// succeeded. nice and I/O priority are per thread on Linux, and threads
+// created afterwards inherit all of them.
+inline std::string ApplyThreadPlacement(const ThreadPlacement& placement)
+{
+	std::ostringstream failed;
+	if (!placement.cpus.empty())
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (size_t i = 0; i < placement.cpus.size(); i++)
+			CPU_SET(placement.cpus[i], &set);
+		int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+		if (error != 0)
+			failed << "CPUs " << FormatCpuList(placement.cpus) << " (" << std::strerror(error) << "), ";
+	}
+
+	if (placement.fifoPriority > 0)
+	{
+		sched_param param;
+		std::memset(&param, 0, sizeof(param));
+		param.sched_priority = placement.fifoPriority;
+		int error = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (error != 0)
+			failed << "SCHED_FIFO " << placement.fifoPriority << " (" << std::strerror(error) << "), ";
+	}
+
+	pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+	if (placement.setNice && setpriority(PRIO_PROCESS, static_cast<id_t>(tid), placement.nice) != 0)
+		failed << "nice " << placement.nice << " (" << std::strerror(errno) << "), ";
+
+	if (placement.ioClass != THREAD_IO_CLASS_NONE)
+	{
+		int value = (placement.ioClass << THREAD_IOPRIO_CLASS_SHIFT) | (placement.ioClass == THREAD_IO_CLASS_IDLE ? 0 : placement.ioLevel);
+		if (syscall(SYS_ioprio_set, THREAD_IOPRIO_WHO_PROCESS, 0, value) != 0)
+			failed << "I/O priority (" << std::strerror(errno) << "), ";
+	}
+
+	std::string result = failed.str();
+	if (!result.empty())
+		result.resize(result.size() - 2);
+	return result;
+}
+
+// Describe where the calling thread actually runs, e.g.
+// "CPUs 4-7, SCHED_FIFO 50, nice 0, io be/4".
+inline std::string DescribeThreadPlacement()
+{
+	std::ostringstream out;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0)
+	{
+		std::vector<int> cpus;
+		for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		{
+			if (CPU_ISSET(cpu, &set))
+				cpus.push_back(cpu);
+		}
+		out << "CPUs " << FormatCpuList(cpus);
+	}
+
+	int policy = SCHED_OTHER;
+	sched_param param;
+	std::memset(&param, 0, sizeof(param));
+	if (pthread_getschedparam(pthread_self(), &policy, &param) == 0)
+	{
+		if (policy == SCHED_FIFO)
+			out << ", SCHED_FIFO " << param.sched_priority;
+		else if (policy == SCHED_RR)
+			out << ", SCHED_RR " << param.sched_priority;
+	}
+
+	pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+	errno = 0;
+	int nice = getpriority(PRIO_PROCESS, static_cast<id_t>(tid));
+	if (errno == 0)
+		out << ", nice " << nice;
+
+	long ioPriority = syscall(SYS_ioprio_get, THREAD_IOPRIO_WHO_PROCESS, 0);
+	if (ioPriority >= 0)
+	{
+		static const char* const classes[] = {"default", "rt", "be", "idle"};
+		int ioClass = static_cast<int>(ioPriority >> THREAD_IOPRIO_CLASS_SHIFT);
+		out << ", io " << (ioClass >= 0 && ioClass <= THREAD_IO_CLASS_IDLE ? classes[ioClass] : "unknown");
+		if (ioClass == THREAD_IO_CLASS_RT || ioClass == THREAD_IO_CLASS_BE)
+			out << "/" << (ioPriority & 0xff);
+	}
+	return out.str();
+}
@@ -0,0 +1,192 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- KERNEL UDP COUNTERS -=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Datagrams the kernel threw away because a socket's receive queue was full
+// never reach the GVSP stream, so they only show up as frame gaps. These
+// read the kernel's own counters so the two can be told apart.
+
+// Host-wide UDP RcvbufErrors from /proc/net/snmp (every socket, every
+// port). Returns false if the counter cannot be read.
+inline bool ReadUdpRcvbufErrors(uint64_t& errors)
+{
+	std::ifstream in("/proc/net/snmp");
+	std::string names;
+	std::string line;
+	while (std::getline(in, line))
+	{
+		if (line.compare(0, 4, "Udp:") != 0)
+			continue;
+		// the first "Udp:" line names the columns, the second has the values
+		if (names.empty())
+		{
+			names = line;
+			continue;
+		}
+		std::istringstream nameStream(names);
+		std::istringstream valueStream(line);
+		std::string name;
+		std::string value;
+		while (nameStream >> name && valueStream >> value)
+		{
+			if (name == "RcvbufErrors")
+			{
+				errors = std::strtoull(value.c_str(), NULL, 10);
+				return true;
+			}
+		}
+		return false;
+	}
+	return false;
+}
+
+// Sum of the "drops" column of /proc/net/udp over every IPv4 socket bound
+// to a local port, e.g. the GVSP stream port. Returns false if no such
+// socket exists or the file cannot be read.
+inline bool ReadUdpPortDrops(uint16_t port, uint64_t& drops)
+{
+	FILE* file = std::fopen("/proc/net/udp", "r");
+	if (!file)
+		return false;
+
+	bool found = false;
+	uint64_t total = 0;
+	char line[512];
+	// skip the column header
+	if (std::fgets(line, sizeof(line), file))
+	{
+		while (std::fgets(line, sizeof(line), file))
+		{
+			// sl local_address rem_address st tx:rx tr:when retrnsmt uid timeout inode ref pointer drops
+			unsigned int localPort = 0;
+			unsigned long long lineDrops = 0;
+			if (std::sscanf(line, " %*u: %*x:%x %*s %*s %*s %*s %*s %*s %*s %*s %*s %*s %llu", &localPort, &lineDrops) != 2 || localPort != port)
+				continue;
+			total += lineDrops;
+			found = true;
+		}
+	}
+	std::fclose(file);
+	if (found)
+		drops = total;
+	return found;
+}
+
+// Kernel drops since Start, for one stream port and host-wide. Sample
+// rereads both files (a few syscalls), so call it at the statistics
+// interval, not per frame. Not thread-safe.
+class KernelUdpDrops
+{
+public:
+	KernelUdpDrops()
+		: port(0)
+		, havePort(false)
+		, haveHost(false)
+		, portBase(0)
+		, portNow(0)
+		, portLast(0)
+		, hostBase(0)
+		, hostNow(0)
+		, hostLast(0)
+	{
+	}
+
+	// Take the current counters as the baseline. Port 0 tracks only the
+	// host-wide counter.
+	void Start(uint16_t streamPort)
+	{
+		port = streamPort;
+		havePort = port != 0 && ReadUdpPortDrops(port, portBase);
+		haveHost = ReadUdpRcvbufErrors(hostBase);
+		portNow = portLast = portBase;
+		hostNow = hostLast = hostBase;
+	}
+
+	void Sample()
+	{
+		portLast = portNow;
+		hostLast = hostNow;
+		uint64_t value = 0;
+		if (port != 0 && ReadUdpPortDrops(port, value))
+		{
+			// a socket bound after Start (the SDK's, once streaming) counts
+			// from 0, which is also the baseline left by Start
+			havePort = true;
+			portNow = value;
+		}
+		if (haveHost && ReadUdpRcvbufErrors(value))
+			hostNow = value;
+	}
+
+	uint16_t Port() const
+	{
+		return port;
+	}
+
+	// false until a socket bound to the port has been seen
+	bool HavePort() const
+	{
+		return havePort;
+	}
+
+	bool HaveHost() const
+	{
+		return haveHost;
+	}
+
+	uint64_t PortDrops() const
+	{
+		return portNow >= portBase ? portNow - portBase : 0;
+	}
+
+	uint64_t HostDrops() const
+	{
+		return hostNow >= hostBase ? hostNow - hostBase : 0;
+	}
+
+	// increase between the last two samples
+	uint64_t PortDropsDelta() const
+	{
+		return portNow >= portLast ? portNow - portLast : 0;
+	}
+
+	uint64_t HostDropsDelta() const
+	{
+		return hostNow >= hostLast ? hostNow - hostLast : 0;
+	}
+
+private:
+	uint16_t port;
+	bool havePort;
+	bool haveHost;
+	uint64_t portBase;
+	uint64_t portNow;
+	uint64_t portLast;
+	uint64_t hostBase;
+	uint64_t hostNow;
+	uint64_t hostLast;
+};
@@ -0,0 +1,560 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#pragma once
+
+#include "FramePool.h"
+#include "RecordingWriter.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =-= IO_URING RING -=-=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+#ifdef HAVE_IO_URING
+
+// Minimal io_uring wrapper over the raw syscalls, so the example needs no
+// liburing. One instance is owned by one thread.
+class IoUring
+{
+public:
+	IoUring()
+		: ringFd(-1)
+		, sqRing(NULL)
+		, cqRing(NULL)
+		, sqRingBytes(0)
+		, cqRingBytes(0)
+		, sqes(NULL)
+		, sqesBytes(0)
+		, sqeTail(0)
+		, sqeSubmitted(0)
+	{
+		std::memset(&params, 0, sizeof(params));
+	}
+
+	~IoUring()
+	{
+		if (sqes)
+			munmap(sqes, sqesBytes);
+		if (cqRing && cqRing != sqRing)
+			munmap(cqRing, cqRingBytes);
+		if (sqRing)
+			munmap(sqRing, sqRingBytes);
+		if (ringFd >= 0)
+			close(ringFd);
+	}
+
+	// Returns 0 or an errno value (ENOSYS on kernels without io_uring, EPERM
+	// when blocked by seccomp or io_uring_disabled).
+	int Init(unsigned entries)
+	{
+		int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+		if (fd < 0)
+			return errno;
+		ringFd = fd;
+
+		sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+		if (singleMmap && cqRingBytes > sqRingBytes)
+			sqRingBytes = cqRingBytes;
+
+		void* mapping = mmap(NULL, sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+		if (mapping == MAP_FAILED)
+			return errno;
+		sqRing = static_cast<uint8_t*>(mapping);
+
+		if (singleMmap)
+		{
+			cqRing = sqRing;
+		}
+		else
+		{
+			mapping = mmap(NULL, cqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+			if (mapping == MAP_FAILED)
+				return errno;
+			cqRing = static_cast<uint8_t*>(mapping);
+		}
+
+		sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+		mapping = mmap(NULL, sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+		if (mapping == MAP_FAILED)
+			return errno;
+		sqes = static_cast<io_uring_sqe*>(mapping);
+
+		sqHead = reinterpret_cast<unsigned*>(sqRing + params.sq_off.head);
+		sqTail = reinterpret_cast<unsigned*>(sqRing + params.sq_off.tail);
+		sqMask = *reinterpret_cast<unsigned*>(sqRing + params.sq_off.ring_mask);
+		sqArray = reinterpret_cast<unsigned*>(sqRing + params.sq_off.array);
+		cqHead = reinterpret_cast<unsigned*>(cqRing + params.cq_off.head);
+		cqTail = reinterpret_cast<unsigned*>(cqRing + params.cq_off.tail);
+		cqMask = *reinterpret_cast<unsigned*>(cqRing + params.cq_off.ring_mask);
+		cqes = reinterpret_cast<io_uring_cqe*>(cqRing + params.cq_off.cqes);
+		return 0;
+	}
+
+	// Returns 0 or an errno value (commonly ENOMEM when RLIMIT_MEMLOCK is too
+	// small to pin the buffers).
+	int RegisterBuffers(const iovec* buffers, unsigned count)
+	{
+		if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, buffers, count) < 0)
+			return errno;
+		return 0;
+	}
+
+	// Next free submission entry, zeroed, or NULL if the ring is full.
+	io_uring_sqe* GetSqe()
+	{
+		unsigned head = __atomic_load_n(sqHead, __ATOMIC_ACQUIRE);
+		if (sqeTail - head >= params.sq_entries)
+			return NULL;
+
+		io_uring_sqe* sqe = &sqes[sqeTail & sqMask];
+		std::memset(sqe, 0, sizeof(*sqe));
+		sqeTail++;
+		return sqe;
+	}
+
+	// Submit queued entries and optionally wait for completions. Returns 0 or
+	// an errno value. On failure the entries the kernel did not take are
+	// withdrawn from the ring, so a later enter can never run them; compare
+	// Submitted() before and after to see how many went in.
+	int Submit(unsigned waitCount)
+	{
+		unsigned toSubmit = sqeTail - sqeSubmitted;
+		unsigned tail = *sqTail;
+		for (unsigned i = 0; i < toSubmit; i++)
+		{
+			sqArray[tail & sqMask] = (sqeSubmitted + i) & sqMask;
+			tail++;
+		}
+		__atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+
+		for (;;)
+		{
+			unsigned flags = waitCount > 0 ? IORING_ENTER_GETEVENTS : 0;
+			long result = syscall(__NR_io_uring_enter, ringFd, toSubmit, waitCount, flags, NULL, 0);
+			if (result >= 0)
+			{
+				sqeSubmitted += static_cast<unsigned>(result);
+				toSubmit -= static_cast<unsigned>(result);
+				if (toSubmit == 0)
+					return 0;
+				continue;
+			}
+			if (errno == EINTR)
+				continue;
+			// without SQPOLL the kernel only reads the tail inside
+			// io_uring_enter, so moving it back is safe
+			int error = errno;
+			__atomic_store_n(sqTail, tail - toSubmit, __ATOMIC_RELEASE);
+			sqeTail = sqeSubmitted;
+			return error;
+		}
+	}
+
+	// Entries handed to the kernel so far.
+	unsigned Submitted() const
+	{
+		return sqeSubmitted;
+	}
+
+	// Pop one completion if available.
+	bool PeekCompletion(io_uring_cqe& completion)
+	{
+		unsigned head = *cqHead;
+		if (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+			return false;
+
+		completion = cqes[head & cqMask];
+		__atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+		return true;
+	}
+
+private:
+	IoUring(const IoUring&);
+	IoUring& operator=(const IoUring&);
+
+	int ringFd;
+	io_uring_params params;
+	uint8_t* sqRing;
+	uint8_t* cqRing;
+	size_t sqRingBytes;
+	size_t cqRingBytes;
+	io_uring_sqe* sqes;
+	size_t sqesBytes;
+
+	unsigned* sqHead;
+	unsigned* sqTail;
+	unsigned sqMask;
+	unsigned* sqArray;
+	unsigned* cqHead;
+	unsigned* cqTail;
+	unsigned cqMask;
+	io_uring_cqe* cqes;
+
+	// entries handed out by GetSqe and entries accepted by the kernel
+	unsigned sqeTail;
+	unsigned sqeSubmitted;
+};
+
+#endif // HAVE_IO_URING
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- IO_URING RECORDER -=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+// Asynchronous recording backend for one save worker. Submit queues a frame
+// record and returns without waiting, so up to queueDepth records can be in
+// flight per worker. Frame pool slots are registered with the ring, so their
+// payloads are written with IORING_OP_WRITE_FIXED. Completions are reported
+// through Reap with the caller's cookie so the slot can be recycled.
+class UringRecorder
+{
+public:
+	typedef void (*CompletionCallback)(void* cookie, int error, void* context);
+
+	UringRecorder(RecordingWriter* writer, unsigned queueDepth)
+		: recording(writer)
+		, depth(queueDepth < 1 ? 1 : queueDepth)
+		, headerBlocks(NULL)
+		, framePool(NULL)
+		, inFlight(0)
+	{
+	}
+
+	~UringRecorder()
+	{
+		std::free(headerBlocks);
+	}
+
+	// Set up the ring and register the pool's slots (pool may be NULL).
+	// Returns 0 or an errno value; on failure the caller should fall back to
+	// RecordingWriter::Append.
+	int Init(FramePool* pool)
+	{
+#ifdef HAVE_IO_URING
+		// two entries per record: header block and payload
+		int error = ring.Init(depth * 2);
+		if (error != 0)
+			return error;
+
+		void* blocks = NULL;
+		if (posix_memalign(&blocks, RECORDING_ALIGNMENT, static_cast<size_t>(depth) * RECORDING_ALIGNMENT) != 0)
+			return ENOMEM;
+		headerBlocks = static_cast<uint8_t*>(blocks);
+		std::memset(headerBlocks, 0, static_cast<size_t>(depth) * RECORDING_ALIGNMENT);
+
+		records.resize(depth);
+		for (unsigned i = 0; i < depth; i++)
+		{
+			records[i].headerBlock = headerBlocks + static_cast<size_t>(i) * RECORDING_ALIGNMENT;
+			records[i].busy = false;
+		}
+
+		if (pool)
+		{
+			std::vector<iovec> buffers(pool->SlotCount());
+			for (size_t i = 0; i < buffers.size(); i++)
+			{
+				buffers[i].iov_base = pool->RegionBase() + i * pool->SlotBytes();
+				buffers[i].iov_len = pool->SlotBytes();
+			}
+			// fixed buffers are an optimization; plain writes still work
+			if (ring.RegisterBuffers(&buffers[0], static_cast<unsigned>(buffers.size())) == 0)
+				framePool = pool;
+		}
+		return 0;
+#else
+		(void)pool;
+		return ENOSYS;
+#endif
+	}
+
+	bool UsesRegisteredBuffers() const
+	{
+		return framePool != NULL;
+	}
+
+	unsigned Depth() const
+	{
+		return depth;
+	}
+
+	unsigned InFlight() const
+	{
+		return inFlight;
+	}
+
+	// Queue one record. slot may be NULL if the payload is not in the frame
+	// pool, unless the recording uses O_DIRECT. Requires InFlight() < Depth().
+	// Throws on submission failure, after undoing the record: nothing of it
+	// is left in the kernel, so the caller may recycle the payload. If only
+	// the header write got in, Submit returns and the record completes with
+	// the error through Reap instead.
+	void Submit(const RawFrameHeader& header, const uint8_t* pData, FrameSlot* slot, void* cookie)
+	{
+#ifdef HAVE_IO_URING
+		Record* record = NULL;
+		for (size_t i = 0; i < records.size() && !record; i++)
+		{
+			if (!records[i].busy)
+				record = &records[i];
+		}
+		if (!record)
+			throw std::runtime_error("io_uring recorder queue is full");
+
+		record->reservation = recording->Reserve(header);
+		record->header = header;
+		record->cookie = cookie;
+		record->error = 0;
+		record->pending = 2;
+		record->busy = true;
+		inFlight++;
+
+		std::memcpy(record->headerBlock, &header, sizeof(header));
+
+		uint64_t payloadBytes = record->reservation.padded - RECORDING_ALIGNMENT;
+		record->ops[0].iov[0].iov_base = record->headerBlock;
+		record->ops[0].iov[0].iov_len = RECORDING_ALIGNMENT;
+		record->ops[0].iovCount = 1;
+		record->ops[0].offset = record->reservation.offset;
+
+		Operation& payload = record->ops[1];
+		payload.offset = record->reservation.offset + RECORDING_ALIGNMENT;
+		// slot payloads are written in place with the tail zeroed, which also
+		// keeps them aligned for O_DIRECT segments
+		bool inSlot = slot && payloadBytes <= slot->capacity;
+		bool fixed = inSlot && framePool;
+		if (inSlot)
+		{
+			// zero the slot's tail so the padding does not leak older frames
+			std::memset(slot->data + header.dataSize, 0, static_cast<size_t>(payloadBytes - header.dataSize));
+			payload.iov[0].iov_base = slot->data;
+			payload.iov[0].iov_len = static_cast<size_t>(payloadBytes);
+			payload.iovCount = 1;
+		}
+		else
+		{
+			payload.iov[0].iov_base = const_cast<uint8_t*>(pData);
+			payload.iov[0].iov_len = static_cast<size_t>(header.dataSize);
+			payload.iov[1].iov_base = const_cast<uint8_t*>(recording->ZeroPad());
+			payload.iov[1].iov_len = static_cast<size_t>(payloadBytes - header.dataSize);
+			payload.iovCount = payload.iov[1].iov_len ? 2 : 1;
+		}
+
+		PrepareVector(record->ops[0], record, 0);
+		if (fixed)
+			PrepareFixed(payload, record, 1, slot->index);
+		else
+			PrepareVector(payload, record, 1);
+
+		unsigned submittedBefore = ring.Submitted();
+		int error = ring.Submit(0);
+		if (error != 0)
+		{
+			if (ring.Submitted() != submittedBefore)
+			{
+				// the header write is in flight; the payload write never will be
+				record->pending = 1;
+				record->error = error;
+				return;
+			}
+
+			record->busy = false;
+			inFlight--;
+			try
+			{
+				recording->Complete(record->reservation, header, error);
+			}
+			catch (std::exception&)
+			{
+				// the submit error below is the one reported
+			}
+			record->reservation = RecordingWriter::Reservation();
+			throw std::runtime_error(std::string("io_uring submit failed: ") + std::strerror(error));
+		}
+#else
+		(void)header;
+		(void)pData;
+		(void)slot;
+		(void)cookie;
+		throw std::runtime_error("io_uring is not available");
+#endif
+	}
+
+	// Handle finished records, blocking for at least one when wait is set and
+	// records are in flight. Returns the number of records completed.
+	size_t Reap(bool wait, CompletionCallback callback, void* context)
+	{
+#ifdef HAVE_IO_URING
+		size_t completed = 0;
+		io_uring_cqe completion;
+		for (;;)
+		{
+			if (!ring.PeekCompletion(completion))
+			{
+				// a record needs both of its operations, so keep waiting until
+				// one finishes completely
+				if (!wait || completed > 0 || inFlight == 0)
+					break;
+				int error = ring.Submit(1);
+				if (error != 0)
+					throw std::runtime_error(std::string("io_uring wait failed: ") + std::strerror(error));
+				continue;
+			}
+
+			uint64_t userData = static_cast<uint64_t>(completion.user_data);
+			Record* record = reinterpret_cast<Record*>(static_cast<uintptr_t>(userData & ~static_cast<uint64_t>(1)));
+			Operation& operation = record->ops[userData & 1];
+
+			int error = 0;
+			if (completion.res < 0)
+				error = -completion.res;
+			else if (static_cast<size_t>(completion.res) < OperationBytes(operation))
+				error = FinishShortWrite(record->reservation.fd, operation, static_cast<size_t>(completion.res));
+			if (error != 0 && record->error == 0)
+				record->error = error;
+
+			if (--record->pending > 0)
+				continue;
+
+			record->busy = false;
+			inFlight--;
+			completed++;
+
+			int recordError = record->error;
+			try
+			{
+				recording->Complete(record->reservation, record->header, recordError);
+			}
+			catch (std::exception&)
+			{
+				// reported to the callback through recordError
+			}
+			record->reservation = RecordingWriter::Reservation();
+			callback(record->cookie, recordError, context);
+		}
+		return completed;
+#else
+		(void)wait;
+		(void)callback;
+		(void)context;
+		return 0;
+#endif
+	}
+
+private:
+	UringRecorder(const UringRecorder&);
+	UringRecorder& operator=(const UringRecorder&);
+
+	struct Operation
+	{
+		iovec iov[2];
+		int iovCount;
+		uint64_t offset;
+	};
+
+	struct Record
+	{
+		RecordingWriter::Reservation reservation;
+		RawFrameHeader header;
+		uint8_t* headerBlock;
+		Operation ops[2];
+		void* cookie;
+		int pending;
+		int error;
+		bool busy;
+	};
+
+	static size_t OperationBytes(const Operation& operation)
+	{
+		size_t bytes = 0;
+		for (int i = 0; i < operation.iovCount; i++)
+			bytes += operation.iov[i].iov_len;
+		return bytes;
+	}
+
+	// Complete a short write synchronously; returns 0 or an errno value.
+	static int FinishShortWrite(int fd, const Operation& operation, size_t written)
+	{
+		iovec parts[2];
+		int count = 0;
+		size_t skip = written;
+		for (int i = 0; i < operation.iovCount; i++)
+		{
+			if (skip >= operation.iov[i].iov_len)
+			{
+				skip -= operation.iov[i].iov_len;
+				continue;
+			}
+			parts[count].iov_base = static_cast<uint8_t*>(operation.iov[i].iov_base) + skip;
+			parts[count].iov_len = operation.iov[i].iov_len - skip;
+			skip = 0;
+			count++;
+		}
+		return WriteVectorAt(fd, parts, count, operation.offset + written);
+	}
+
+#ifdef HAVE_IO_URING
+	void PrepareVector(Operation& operation, Record* record, unsigned opIndex)
+	{
+		io_uring_sqe* sqe = ring.GetSqe();
+		sqe->opcode = IORING_OP_WRITEV;
+		sqe->fd = record->reservation.fd;
+		sqe->addr = reinterpret_cast<uintptr_t>(operation.iov);
+		sqe->len = static_cast<unsigned>(operation.iovCount);
+		sqe->off = operation.offset;
+		sqe->user_data = reinterpret_cast<uintptr_t>(record) | opIndex;
+	}
+
+	void PrepareFixed(Operation& operation, Record* record, unsigned opIndex, uint32_t bufferIndex)
+	{
+		io_uring_sqe* sqe = ring.GetSqe();
+		sqe->opcode = IORING_OP_WRITE_FIXED;
+		sqe->fd = record->reservation.fd;
+		sqe->addr = reinterpret_cast<uintptr_t>(operation.iov[0].iov_base);
+		sqe->len = static_cast<unsigned>(operation.iov[0].iov_len);
+		sqe->off = operation.offset;
+		sqe->buf_index = static_cast<uint16_t>(bufferIndex);
+		sqe->user_data = reinterpret_cast<uintptr_t>(record) | opIndex;
+	}
+
+	IoUring ring;
+#endif
+
+	RecordingWriter* recording;
+	unsigned depth;
+	uint8_t* headerBlocks;
+	std::vector<Record> records;
+	FramePool* framePool;
+	unsigned inFlight;
+};
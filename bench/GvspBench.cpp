@@ -0,0 +1,423 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#include "FramePool.h"
+#include "Gvsp.h"
+#include "UdpDrops.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define TAB1 "  "
+#define TAB2 "    "
+
+// GvspBench
+//    Streams synthetic GVSP frames over loopback UDP to a GvspReceiver
+//    (Gvsp.h) and compares reading one datagram per syscall with recvmmsg
+//    batches. The sender paces frames at the given rate and sends each
+//    frame's packets with sendmmsg. Reports frames complete and incomplete,
+//    datagrams per receive syscall and the receiver's CPU time per packet.
+//
+//    Usage: GvspBench [frames] [width] [height] [fps] [packet_bytes]
+//
+//    With --listen it instead joins a multicast group and receives a stream
+//    sent by GvspGenerator (or a camera) for the given time, so the receiver
+//    and the kernel drop counters can be tested without a camera. Slot size
+//    and geometry come from the first image leader. Reports frames per
+//    second, incomplete frames, block ID gaps and kernel drops every second
+//    and in total.
+//
+//    Usage: GvspBench --listen <group> <port> [interface] [seconds]
+
+// =-=-=-=-=-=-=-=-=-
+// =-=- SETTINGS =-=-
+// =-=-=-=-=-=-=-=-=-
+
+#define DEFAULT_FRAMES 300
+#define DEFAULT_WIDTH 2048
+#define DEFAULT_HEIGHT 1536
+#define DEFAULT_FPS 30
+#define DEFAULT_PACKET_BYTES 8972
+// Mono8
+#define BENCH_PIXEL_FORMAT 0x01080001
+#define BENCH_POOL_SLOTS 16
+// socket receive buffer requested for the receiver (capped by rmem_max)
+#define BENCH_RCVBUF_BYTES (64 << 20)
+#define DEFAULT_LISTEN_SEC 10
+// time allowed for the first image leader of a listened stream
+#define LISTEN_LEADER_TIMEOUT_MS 5000
+
+struct BenchConfig
+{
+	unsigned long frames;
+	uint32_t width;
+	uint32_t height;
+	double fps;
+	size_t packetBytes;
+};
+
+static double ThreadCpuSeconds()
+{
+	timespec time;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) / 1e9;
+}
+
+// Bind a receiving socket to an ephemeral loopback port and return it.
+static int OpenReceiver(uint16_t& port)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		throw std::runtime_error(std::string("socket failed: ") + std::strerror(errno));
+	int bytes = BENCH_RCVBUF_BYTES;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+		throw std::runtime_error(std::string("bind failed: ") + std::strerror(errno));
+	socklen_t length = sizeof(address);
+	getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+	port = ntohs(address.sin_port);
+	return fd;
+}
+
+// Send config.frames frames to the port, paced at config.fps.
+static void RunSender(const BenchConfig& config, uint16_t port)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	sockaddr_in target;
+	std::memset(&target, 0, sizeof(target));
+	target.sin_family = AF_INET;
+	target.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	target.sin_port = htons(port);
+	connect(fd, reinterpret_cast<sockaddr*>(&target), sizeof(target));
+
+	GvspPacketizer packetizer(config.packetBytes, false);
+	size_t imageBytes = static_cast<size_t>(config.width) * config.height;
+	std::vector<uint8_t> image(imageBytes);
+	size_t packetCount = packetizer.PacketCount(imageBytes);
+	std::vector<uint8_t> packets(packetCount * GVSP_MAX_PACKET_BYTES);
+	std::vector<iovec> vectors(packetCount);
+	std::vector<mmsghdr> messages(packetCount);
+
+	GvspImageLeader leader;
+	std::memset(&leader, 0, sizeof(leader));
+	leader.payloadType = GVSP_PAYLOAD_TYPE_IMAGE;
+	leader.pixelFormat = BENCH_PIXEL_FORMAT;
+	leader.width = config.width;
+	leader.height = config.height;
+
+	std::chrono::nanoseconds period(static_cast<int64_t>(1e9 / config.fps));
+	std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+	uint64_t blockId = 0;
+	for (unsigned long frame = 0; frame < config.frames; frame++)
+	{
+		blockId = NextGvspBlockId(blockId, false);
+		std::memset(&image[0], static_cast<int>(frame), 64);
+		leader.timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(next.time_since_epoch()).count());
+		for (size_t i = 0; i < packetCount; i++)
+		{
+			uint8_t* packet = &packets[i * GVSP_MAX_PACKET_BYTES];
+			vectors[i].iov_base = packet;
+			vectors[i].iov_len = packetizer.Build(i, blockId, leader, &image[0], imageBytes, packet);
+			std::memset(&messages[i], 0, sizeof(messages[i]));
+			messages[i].msg_hdr.msg_iov = &vectors[i];
+			messages[i].msg_hdr.msg_iovlen = 1;
+		}
+		for (size_t sent = 0; sent < packetCount;)
+		{
+			int count = sendmmsg(fd, &messages[sent], static_cast<unsigned>(packetCount - sent), 0);
+			if (count <= 0)
+				break;
+			sent += static_cast<size_t>(count);
+		}
+
+		next += period;
+		std::this_thread::sleep_until(next);
+	}
+	close(fd);
+}
+
+static void RunBench(const BenchConfig& config, size_t batchPackets)
+{
+	uint16_t port = 0;
+	int fd = OpenReceiver(port);
+	FramePool pool(BENCH_POOL_SLOTS, static_cast<size_t>(config.width) * config.height);
+	GvspReceiver receiver(fd, &pool, batchPackets);
+
+	std::atomic<bool> senderDone(false);
+	std::thread sender([&]() {
+		RunSender(config, port);
+		senderDone.store(true, std::memory_order_release);
+	});
+
+	std::vector<GvspFrame> frames;
+	uint64_t complete = 0;
+	double cpuStart = ThreadCpuSeconds();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (;;)
+	{
+		bool done = senderDone.load(std::memory_order_acquire);
+		frames.clear();
+		receiver.Receive(100, frames);
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			if (!frames[i].incomplete)
+				complete++;
+			if (frames[i].pSlot)
+				pool.Release(frames[i].pSlot);
+		}
+		// the sender finished and the socket was drained by a timed-out poll
+		if (done && frames.empty() && receiver.Stats().frames >= config.frames)
+			break;
+		if (done && std::chrono::steady_clock::now() - start > std::chrono::seconds(5) + std::chrono::duration<double>(config.frames / config.fps))
+			break;
+	}
+	double cpuSec = ThreadCpuSeconds() - cpuStart;
+	sender.join();
+	close(fd);
+
+	const GvspReceiverStats& stats = receiver.Stats();
+	double syscalls = static_cast<double>(stats.batches);
+	std::cout << TAB1 << "batch " << batchPackets << ": " << complete << " of " << config.frames << " frames complete, " << stats.incompleteFrames
+			  << " incomplete, " << stats.noSlotFrames << " without slot\n";
+	std::cout << TAB2 << stats.packets << " packets in " << stats.batches << " receive calls (" << (syscalls > 0 ? stats.packets / syscalls : 0.0)
+			  << " per call, peak " << stats.peakBatch << "), receiver CPU " << cpuSec * 1e3 << " ms ("
+			  << (stats.packets ? cpuSec * 1e9 / static_cast<double>(stats.packets) : 0.0) << " ns per packet)\n";
+}
+
+// Join group on the interface (or the routing table's choice if empty) and
+// bind to the port. Returns the socket.
+static int OpenListener(const std::string& group, uint16_t port, const std::string& interfaceName)
+{
+	int fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		throw std::runtime_error(std::string("socket failed: ") + std::strerror(errno));
+	int bytes = BENCH_RCVBUF_BYTES;
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+	int enable = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+	setsockopt(fd, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+	int all = 0;
+	setsockopt(fd, IPPROTO_IP, IP_MULTICAST_ALL, &all, sizeof(all));
+
+	ip_mreqn request;
+	std::memset(&request, 0, sizeof(request));
+	if (inet_pton(AF_INET, group.c_str(), &request.imr_multiaddr) != 1)
+		throw std::runtime_error("Invalid multicast group IP: " + group);
+	if (!interfaceName.empty())
+	{
+		request.imr_ifindex = static_cast<int>(if_nametoindex(interfaceName.c_str()));
+		if (request.imr_ifindex == 0)
+			throw std::runtime_error("Invalid interface name: " + interfaceName);
+	}
+	if (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) != 0)
+		throw std::runtime_error("Failed to join multicast group " + group + ": " + std::strerror(errno));
+
+	sockaddr_in address;
+	std::memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr = request.imr_multiaddr;
+	address.sin_port = htons(port);
+	if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+		throw std::runtime_error(std::string("bind failed: ") + std::strerror(errno));
+	return fd;
+}
+
+// Wait for an image leader without taking it off the socket, discarding
+// anything before it, and return the slot bytes its frame needs (0 on
+// timeout).
+static size_t PeekLeaderBytes(int fd, GvspImageLeader& leader)
+{
+	std::vector<uint8_t> buffer(GVSP_MAX_PACKET_BYTES);
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(LISTEN_LEADER_TIMEOUT_MS);
+	while (std::chrono::steady_clock::now() < deadline)
+	{
+		pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+		ssize_t size = recv(fd, &buffer[0], buffer.size(), MSG_PEEK);
+		if (size < 0)
+			throw std::runtime_error(std::string("recv failed: ") + std::strerror(errno));
+		GvspPacket packet;
+		if (ParseGvspPacket(&buffer[0], static_cast<size_t>(size), packet) && packet.format == GVSP_FORMAT_LEADER &&
+			ParseGvspImageLeader(packet.data, packet.size, leader))
+		{
+			size_t lineBytes = static_cast<size_t>(leader.width) * GetPfncBitsPerPixel(leader.pixelFormat) / 8;
+			return (lineBytes + leader.paddingX) * leader.height + leader.paddingY;
+		}
+		recv(fd, &buffer[0], buffer.size(), 0);
+	}
+	return 0;
+}
+
+// Block IDs skipped between two frames, with the 16-bit wrap that skips 0.
+static uint64_t CountBlockGap(uint64_t last, uint64_t blockId)
+{
+	if (last == 0 || blockId == NextGvspBlockId(last, last > 0xFFFF))
+		return 0;
+	if (blockId > last)
+		return blockId - last - 1;
+	if (last <= 0xFFFF)
+		return (0xFFFF - last) + (blockId - 1);
+	return 0;
+}
+
+static int RunListener(const std::string& group, uint16_t port, const std::string& interfaceName, double seconds)
+{
+	int fd = OpenListener(group, port, interfaceName);
+	std::cout << "GvspBench: listening on " << group << ":" << port << (interfaceName.empty() ? std::string() : " on " + interfaceName) << " for "
+			  << seconds << " s\n";
+
+	GvspImageLeader leader;
+	size_t slotBytes = PeekLeaderBytes(fd, leader);
+	if (slotBytes == 0)
+	{
+		close(fd);
+		std::cerr << "GvspBench: no image leader within " << LISTEN_LEADER_TIMEOUT_MS << " ms\n";
+		return -1;
+	}
+	std::cout << TAB1 << "stream: " << leader.width << " x " << leader.height << ", pixel format 0x" << std::hex << leader.pixelFormat << std::dec << ", "
+			  << slotBytes << " bytes per frame\n";
+
+	FramePool pool(BENCH_POOL_SLOTS + GVSP_MAX_ASSEMBLIES, slotBytes);
+	GvspReceiver receiver(fd, &pool);
+	KernelUdpDrops kernelDrops;
+	kernelDrops.Start(port);
+
+	std::vector<GvspFrame> frames;
+	uint64_t complete = 0;
+	uint64_t gaps = 0;
+	uint64_t lastBlockId = 0;
+	uint64_t lastFrames = 0;
+	uint64_t lastBytes = 0;
+	double cpuStart = ThreadCpuSeconds();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+	std::chrono::steady_clock::time_point nextReport = start + std::chrono::seconds(1);
+	for (;;)
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now >= end)
+			break;
+		frames.clear();
+		receiver.Receive(100, frames);
+		for (size_t i = 0; i < frames.size(); i++)
+		{
+			if (!frames[i].incomplete)
+				complete++;
+			gaps += CountBlockGap(lastBlockId, frames[i].blockId);
+			lastBlockId = frames[i].blockId;
+			if (frames[i].pSlot)
+				pool.Release(frames[i].pSlot);
+		}
+
+		if (now >= nextReport)
+		{
+			const GvspReceiverStats& stats = receiver.Stats();
+			kernelDrops.Sample();
+			std::cout << TAB1 << stats.frames - lastFrames << " fps, " << (stats.bytes - lastBytes) * 8 / 1000000 << " Mbit/s, incomplete "
+					  << stats.incompleteFrames << ", block gaps " << gaps << ", socket drops " << stats.socketDrops << ", port drops "
+					  << kernelDrops.PortDropsDelta() << "\n";
+			lastFrames = stats.frames;
+			lastBytes = stats.bytes;
+			nextReport += std::chrono::seconds(1);
+		}
+	}
+	double cpuSec = ThreadCpuSeconds() - cpuStart;
+	frames.clear();
+	receiver.Flush(frames);
+	for (size_t i = 0; i < frames.size(); i++)
+	{
+		if (frames[i].pSlot)
+			pool.Release(frames[i].pSlot);
+	}
+	kernelDrops.Sample();
+	close(fd);
+
+	const GvspReceiverStats& stats = receiver.Stats();
+	std::cout << TAB1 << "total: " << stats.frames << " frames, " << complete << " complete, " << stats.incompleteFrames << " incomplete, "
+			  << stats.noSlotFrames << " without slot, " << gaps << " block IDs never seen\n";
+	std::cout << TAB2 << stats.packets << " packets in " << stats.batches << " receive calls, ignored " << stats.ignoredPackets << ", from other senders "
+			  << stats.foreignPackets << ", late " << stats.latePackets << ", duplicate " << stats.duplicatePackets << "\n";
+	std::cout << TAB2 << "kernel drops: socket " << stats.socketDrops << " (SO_RXQ_OVFL), port " << kernelDrops.PortDrops() << ", host "
+			  << kernelDrops.HostDrops() << "; receiver CPU " << cpuSec * 1e3 << " ms ("
+			  << (stats.packets ? cpuSec * 1e9 / static_cast<double>(stats.packets) : 0.0) << " ns per packet)\n";
+	return stats.frames > 0 ? 0 : -1;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1 && std::string(argv[1]) == "--listen")
+	{
+		if (argc < 4)
+		{
+			std::cerr << "Usage: " << argv[0] << " --listen <group> <port> [interface] [seconds]\n";
+			return -1;
+		}
+		try
+		{
+			uint16_t port = static_cast<uint16_t>(std::strtoul(argv[3], NULL, 10));
+			double seconds = argc > 5 ? std::strtod(argv[5], NULL) : DEFAULT_LISTEN_SEC;
+			return RunListener(argv[2], port, argc > 4 ? argv[4] : "", seconds);
+		}
+		catch (std::exception& ex)
+		{
+			std::cerr << "GvspBench: " << ex.what() << "\n";
+			return -1;
+		}
+	}
+
+	BenchConfig config;
+	config.frames = argc > 1 ? std::strtoul(argv[1], NULL, 10) : DEFAULT_FRAMES;
+	config.width = static_cast<uint32_t>(argc > 2 ? std::strtoul(argv[2], NULL, 10) : DEFAULT_WIDTH);
+	config.height = static_cast<uint32_t>(argc > 3 ? std::strtoul(argv[3], NULL, 10) : DEFAULT_HEIGHT);
+	config.fps = argc > 4 ? std::strtod(argv[4], NULL) : DEFAULT_FPS;
+	config.packetBytes = argc > 5 ? std::strtoul(argv[5], NULL, 10) : DEFAULT_PACKET_BYTES;
+	if (config.frames == 0 || config.width == 0 || config.height == 0 || config.fps <= 0.0)
+	{
+		std::cerr << "Usage: " << argv[0] << " [frames] [width] [height] [fps] [packet_bytes]\n";
+		return -1;
+	}
+
+	try
+	{
+		GvspPacketizer packetizer(config.packetBytes, false);
+		std::cout << "GvspBench: " << config.frames << " frames of " << config.width << " x " << config.height << " Mono8 at " << config.fps << " fps, "
+				  << packetizer.PacketCount(static_cast<size_t>(config.width) * config.height) << " packets of " << config.packetBytes << " bytes each\n";
+		RunBench(config, 1);
+		RunBench(config, GVSP_BATCH_PACKETS);
+	}
+	catch (std::exception& ex)
+	{
+		std::cerr << "GvspBench: " << ex.what() << "\n";
+		return -1;
+	}
+	return 0;
+}
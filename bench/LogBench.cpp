@@ -0,0 +1,180 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#include "AsyncLog.h"
+#include "LatencyHistogram.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#define TAB1 "  "
+#define TAB2 "    "
+
+// LogBench
+//    Measures what printing the per-frame line costs the acquisition thread.
+//    The frame thread logs one line per frame period while a second thread
+//    plays a save worker printing its step lines. Each run is done once with
+//    the original std::cout fragments and once with AsyncLog. Log lines go to
+//    stdout, results to stderr, so run it with stdout on a terminal (the slow
+//    case) or redirected to a file or /dev/null.
+//
+//    Usage: LogBench [frames] [period_us] [worker_lines_per_frame]
+
+// =-=-=-=-=-=-=-=-=-
+// =-=- SETTINGS =-=-
+// =-=-=-=-=-=-=-=-=-
+
+#define DEFAULT_FRAMES 20000
+#define DEFAULT_PERIOD_US 100
+#define DEFAULT_WORKER_LINES 4
+
+struct BenchConfig
+{
+	unsigned long frames;
+	std::chrono::microseconds period;
+	unsigned long workerLines;
+};
+
+// Per-frame line as the acquisition loop printed it before the async logger.
+struct CoutSink
+{
+	static const char* Name()
+	{
+		return "std::cout fragments";
+	}
+
+	static void Frame(uint64_t frameId, uint64_t timestampNs, const std::string& filename)
+	{
+		std::cout << TAB2 << "Image retrieved";
+		std::cout << " (frame ID " << frameId << "; timestamp (ns): " << timestampNs << ")";
+		std::cout << " - saved: " << filename;
+		std::cout << " and requeue\n";
+	}
+
+	static void WorkerLine()
+	{
+		std::cout << TAB1 << "Prepare image parameters\n";
+	}
+
+	static void Finish()
+	{
+		std::cout.flush();
+	}
+};
+
+struct AsyncSink
+{
+	static const char* Name()
+	{
+		return "AsyncLog records";
+	}
+
+	static void Frame(uint64_t frameId, uint64_t timestampNs, const std::string& filename)
+	{
+		AsyncLog::Instance().WriteWithText(LOG_INFO, 0, filename.c_str(), TAB2 "Image retrieved (frame ID %u; timestamp (ns): %u) - saved: %t and requeue\n",
+			frameId, timestampNs);
+	}
+
+	static void WorkerLine()
+	{
+		LogMessage(LOG_INFO, TAB1 "Prepare image parameters\n");
+	}
+
+	static void Finish()
+	{
+		AsyncLog::Instance().Flush();
+	}
+};
+
+template <typename Sink>
+static void RunBench(const BenchConfig& config)
+{
+	std::atomic<uint64_t> frameCount(0);
+	std::atomic<bool> done(false);
+
+	// save worker: a few step lines for every frame the acquisition side logs
+	std::thread worker([&]() {
+		uint64_t seen = 0;
+		for (;;)
+		{
+			bool last = done.load(std::memory_order_acquire);
+			uint64_t now = frameCount.load(std::memory_order_acquire);
+			if (now == seen)
+			{
+				if (last)
+					break;
+				std::this_thread::yield();
+				continue;
+			}
+			for (; seen < now; seen++)
+				for (unsigned long i = 0; i < config.workerLines; i++)
+					Sink::WorkerLine();
+		}
+	});
+
+	LatencyHistogram latency;
+	std::string filename = "Cpp_Multicast_Save_000000000000_000000.png";
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point next = start;
+	for (unsigned long i = 0; i < config.frames; i++)
+	{
+		next += config.period;
+		while (std::chrono::steady_clock::now() < next)
+			;
+
+		std::chrono::steady_clock::time_point before = std::chrono::steady_clock::now();
+		Sink::Frame(i, static_cast<uint64_t>(before.time_since_epoch().count()), filename);
+		std::chrono::steady_clock::time_point after = std::chrono::steady_clock::now();
+		latency.Record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(after - before).count()));
+
+		frameCount.store(i + 1, std::memory_order_release);
+	}
+
+	done.store(true, std::memory_order_release);
+	worker.join();
+	Sink::Finish();
+	double wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cerr << TAB1 << Sink::Name() << " (" << wallSec << " s)\n";
+	std::cerr << TAB2 << "per-frame ns: p50 " << latency.Percentile(50.0) << ", p99 " << latency.Percentile(99.0)
+			  << ", p99.9 " << latency.Percentile(99.9) << ", max " << latency.Max() << "\n";
+}
+
+int main(int argc, char** argv)
+{
+	BenchConfig config;
+	config.frames = argc > 1 ? std::strtoul(argv[1], NULL, 10) : DEFAULT_FRAMES;
+	config.period = std::chrono::microseconds(argc > 2 ? std::strtoul(argv[2], NULL, 10) : DEFAULT_PERIOD_US);
+	config.workerLines = argc > 3 ? std::strtoul(argv[3], NULL, 10) : DEFAULT_WORKER_LINES;
+	if (config.frames == 0)
+	{
+		std::cerr << "Usage: " << argv[0] << " [frames] [period_us] [worker_lines_per_frame]\n";
+		return -1;
+	}
+
+	std::cerr << "LogBench: " << config.frames << " frames, " << config.period.count() << " us period, "
+			  << config.workerLines << " worker lines per frame\n";
+
+	RunBench<CoutSink>(config);
+
+	AsyncLog::Instance().Start();
+	RunBench<AsyncSink>(config);
+	AsyncLog::Instance().Stop();
+	if (AsyncLog::Instance().Dropped() > 0)
+		std::cerr << TAB2 << "dropped records: " << AsyncLog::Instance().Dropped() << "\n";
+	return 0;
+}
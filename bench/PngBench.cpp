@@ -0,0 +1,102 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#include "ParallelPng.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#define TAB1 "  "
+
+// PngBench
+//    Encodes a synthetic BGR8 frame with the striped PNG encoder using 1, 2,
+//    4, ... threads up to max_threads and reports the median encode time and
+//    output size per thread count. The frame is a smooth gradient with sensor
+//    noise so the filter choice and compression ratio resemble a real image.
+//
+//    Usage: PngBench [width] [height] [max_threads] [level] [repeats]
+
+// =-=-=-=-=-=-=-=-=-
+// =-=- SETTINGS =-=-
+// =-=-=-=-=-=-=-=-=-
+
+#define DEFAULT_WIDTH 4096
+#define DEFAULT_HEIGHT 3000
+#define DEFAULT_MAX_THREADS 8
+#define DEFAULT_LEVEL 6
+#define DEFAULT_REPEATS 5
+
+static void FillFrame(std::vector<uint8_t>& frame, size_t width, size_t height)
+{
+	uint32_t seed = 1;
+	for (size_t y = 0; y < height; y++)
+	{
+		uint8_t* pRow = &frame[y * width * 3];
+		for (size_t x = 0; x < width * 3; x++)
+		{
+			seed = seed * 1103515245u + 12345u;
+			pRow[x] = static_cast<uint8_t>((x / 3 * 255 / width + y * 255 / height) / 2 + ((seed >> 16) & 7));
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t width = argc > 1 ? std::strtoul(argv[1], NULL, 10) : DEFAULT_WIDTH;
+	size_t height = argc > 2 ? std::strtoul(argv[2], NULL, 10) : DEFAULT_HEIGHT;
+	size_t maxThreads = argc > 3 ? std::strtoul(argv[3], NULL, 10) : DEFAULT_MAX_THREADS;
+	int level = argc > 4 ? std::atoi(argv[4]) : DEFAULT_LEVEL;
+	size_t repeats = argc > 5 ? std::strtoul(argv[5], NULL, 10) : DEFAULT_REPEATS;
+	if (width == 0 || height == 0 || maxThreads == 0 || repeats == 0)
+	{
+		std::cout << "Usage: " << argv[0] << " [width] [height] [max_threads] [level] [repeats]\n";
+		return -1;
+	}
+
+	std::vector<uint8_t> frame(width * height * 3);
+	FillFrame(frame, width, height);
+	double frameMB = frame.size() / 1e6;
+
+	std::cout << "PngBench: " << width << "x" << height << " BGR8 (" << frameMB << " MB), level " << level << ", "
+			  << std::thread::hardware_concurrency() << " cores\n";
+
+	try
+	{
+		StripedPngEncoder encoder;
+		for (size_t threads = 1; threads <= maxThreads; threads *= 2)
+		{
+			std::vector<double> times;
+			for (size_t i = 0; i < repeats; i++)
+			{
+				std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+				encoder.Encode(&frame[0], width, height, 3, true, level, threads);
+				std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - begin;
+				times.push_back(elapsed.count());
+			}
+			std::sort(times.begin(), times.end());
+			double median = times[times.size() / 2];
+
+			std::cout << TAB1 << threads << " threads: " << median << " ms, " << frameMB / (median / 1000.0) << " MB/s, "
+					  << encoder.EncodedBytes() / 1e6 << " MB\n";
+		}
+	}
+	catch (std::exception& ex)
+	{
+		std::cout << "Standard exception thrown: " << ex.what() << "\n";
+		return -1;
+	}
+	return 0;
+}
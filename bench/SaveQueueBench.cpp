@@ -0,0 +1,280 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#include "BoundedRing.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define TAB1 "  "
+
+// SaveQueueBench
+//    Compares the acquisition-side cost of handing a job to the save workers
+//    with the original deque + mutex + condition variable queue and with the
+//    lock-free ring + futex event used by Cpp_Multicast_Save. The producer
+//    plays the acquisition loop: it pushes one job per frame period and times
+//    each push. Consumers play save workers and spin for a fixed time per job.
+//
+//    Usage: SaveQueueBench [frames] [workers] [work_us] [period_us]
+
+// =-=-=-=-=-=-=-=-=-
+// =-=- SETTINGS =-=-
+// =-=-=-=-=-=-=-=-=-
+
+#define DEFAULT_FRAMES 200000
+#define DEFAULT_WORKERS 4
+#define DEFAULT_WORK_US 20
+#define DEFAULT_PERIOD_US 0
+#define QUEUE_CAPACITY 1024
+
+struct Job
+{
+	uint64_t frameId;
+	std::chrono::steady_clock::time_point enqueued;
+};
+
+static void SpinFor(std::chrono::nanoseconds duration)
+{
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + duration;
+	while (std::chrono::steady_clock::now() < end)
+		;
+}
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- BASELINE QUEUE -=-=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+struct LockedQueue
+{
+	// The save queue as it was before the lock-free ring.
+	std::deque<Job> jobs;
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool stop;
+
+	LockedQueue()
+		: stop(false)
+	{
+	}
+
+	bool Push(Job& job)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			jobs.push_back(job);
+		}
+		cv.notify_one();
+		return true;
+	}
+
+	bool Pop(Job& job)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [&]() { return stop || !jobs.empty(); });
+		if (stop && jobs.empty())
+			return false;
+		job = jobs.front();
+		jobs.pop_front();
+		return true;
+	}
+
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stop = true;
+		}
+		cv.notify_all();
+	}
+
+	uint64_t Wakeups() const
+	{
+		return 0;
+	}
+};
+
+// =-=-=-=-=-=-=-=-=-=-=-=-
+// =- LOCK-FREE QUEUE -=-=-
+// =-=-=-=-=-=-=-=-=-=-=-=-
+
+struct RingQueue
+{
+	// Same hand-off pattern as SaveQueue in Cpp_Multicast_Save.cpp.
+	BoundedRing<Job> jobs;
+	FutexEvent workEvent;
+	std::atomic<bool> stop;
+
+	RingQueue()
+		: jobs(QUEUE_CAPACITY)
+		, stop(false)
+	{
+	}
+
+	bool Push(Job& job)
+	{
+		if (!jobs.TryPush(job))
+			return false;
+		workEvent.NotifyOne();
+		return true;
+	}
+
+	bool Pop(Job& job)
+	{
+		for (;;)
+		{
+			if (jobs.TryPop(job))
+				return true;
+			uint32_t epoch = workEvent.PrepareWait();
+			bool stopping = stop.load(std::memory_order_acquire);
+			if (jobs.TryPop(job))
+			{
+				workEvent.CancelWait();
+				return true;
+			}
+			if (stopping)
+			{
+				workEvent.CancelWait();
+				return false;
+			}
+			workEvent.Wait(epoch);
+		}
+	}
+
+	void Stop()
+	{
+		stop.store(true, std::memory_order_release);
+		workEvent.NotifyAll();
+	}
+
+	uint64_t Wakeups() const
+	{
+		return workEvent.WakeCount();
+	}
+};
+
+// =-=-=-=-=-=-=-=-=-
+// =-=- BENCHMARK -=-
+// =-=-=-=-=-=-=-=-=-
+
+struct BenchConfig
+{
+	size_t frames;
+	size_t workers;
+	std::chrono::nanoseconds work;
+	std::chrono::nanoseconds period;
+};
+
+template <typename Queue>
+static void RunBench(const char* name, const BenchConfig& config)
+{
+	Queue queue;
+	std::atomic<size_t> outstanding(0);
+	std::atomic<uint64_t> consumed(0);
+	std::atomic<uint64_t> handoffNs(0);
+
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < config.workers; i++)
+	{
+		workers.push_back(std::thread([&]() {
+			Job job;
+			while (queue.Pop(job))
+			{
+				std::chrono::nanoseconds handoff = std::chrono::steady_clock::now() - job.enqueued;
+				handoffNs.fetch_add(static_cast<uint64_t>(handoff.count()), std::memory_order_relaxed);
+				SpinFor(config.work);
+				consumed.fetch_add(1, std::memory_order_relaxed);
+				outstanding.fetch_sub(1, std::memory_order_release);
+			}
+		}));
+	}
+
+	std::vector<uint64_t> pushNs;
+	pushNs.reserve(config.frames);
+	uint64_t producerStalls = 0;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point nextFrame = start;
+	for (size_t i = 0; i < config.frames; i++)
+	{
+		if (config.period.count() > 0)
+		{
+			nextFrame += config.period;
+			while (std::chrono::steady_clock::now() < nextFrame)
+				;
+		}
+
+		// keep both queues equally bounded so only the hand-off differs
+		while (outstanding.load(std::memory_order_acquire) >= QUEUE_CAPACITY)
+		{
+			producerStalls++;
+			std::this_thread::yield();
+		}
+
+		Job job;
+		job.frameId = i;
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		job.enqueued = begin;
+		outstanding.fetch_add(1, std::memory_order_acq_rel);
+		queue.Push(job);
+		std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - begin;
+		pushNs.push_back(static_cast<uint64_t>(elapsed.count()));
+	}
+
+	queue.Stop();
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+
+	std::sort(pushNs.begin(), pushNs.end());
+	uint64_t total = 0;
+	for (size_t i = 0; i < pushNs.size(); i++)
+		total += pushNs[i];
+
+	size_t count = pushNs.size();
+	std::cout << name << "\n";
+	std::cout << TAB1 << "push ns: mean " << total / count << ", p50 " << pushNs[count / 2] << ", p99 " << pushNs[count * 99 / 100]
+			  << ", p99.9 " << pushNs[count * 999 / 1000] << ", max " << pushNs[count - 1] << "\n";
+	std::cout << TAB1 << "hand-off ns (push to pop): mean " << handoffNs.load() / consumed.load() << "\n";
+	std::cout << TAB1 << "throughput: " << consumed.load() / wall.count() << " jobs/s, producer stalls: " << producerStalls;
+	if (queue.Wakeups() != 0)
+		std::cout << ", futex wakes: " << queue.Wakeups();
+	std::cout << "\n";
+}
+
+int main(int argc, char** argv)
+{
+	BenchConfig config;
+	config.frames = argc > 1 ? std::strtoul(argv[1], NULL, 10) : DEFAULT_FRAMES;
+	config.workers = argc > 2 ? std::strtoul(argv[2], NULL, 10) : DEFAULT_WORKERS;
+	config.work = std::chrono::microseconds(argc > 3 ? std::strtoul(argv[3], NULL, 10) : DEFAULT_WORK_US);
+	config.period = std::chrono::microseconds(argc > 4 ? std::strtoul(argv[4], NULL, 10) : DEFAULT_PERIOD_US);
+	if (config.frames == 0 || config.workers == 0)
+	{
+		std::cout << "Usage: " << argv[0] << " [frames] [workers] [work_us] [period_us]\n";
+		return -1;
+	}
+
+	std::cout << "SaveQueueBench: " << config.frames << " frames, " << config.workers << " workers, "
+			  << config.work.count() / 1000 << " us work, " << config.period.count() / 1000 << " us period\n";
+
+	RunBench<LockedQueue>("deque + mutex + condition_variable", config);
+	RunBench<RingQueue>("lock-free ring + futex event", config);
+	return 0;
+}
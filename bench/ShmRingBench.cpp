@@ -0,0 +1,194 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#include "LatencyHistogram.h"
+#include "ShmFrameRing.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+
+#define TAB1 "  "
+#define TAB2 "    "
+
+// ShmRingBench
+//    Publishes frames into a shared-memory ring (ShmFrameRing.h) at a fixed
+//    period while several reader processes copy them out. The last reader
+//    can be made slow to show that it loses frames without holding up the
+//    writer or the other readers. Reports the writer's cost per Publish and,
+//    per reader, frames read and lost and the publish-to-read latency.
+//
+//    Usage: ShmRingBench [readers] [frames] [frame_kb] [period_us] [slots] [slow_reader_us]
+
+// =-=-=-=-=-=-=-=-=-
+// =-=- SETTINGS =-=-
+// =-=-=-=-=-=-=-=-=-
+
+#define DEFAULT_READERS 4
+#define DEFAULT_FRAMES 5000
+#define DEFAULT_FRAME_KB 2048
+#define DEFAULT_PERIOD_US 1000
+#define DEFAULT_SLOTS 8
+// extra work per frame for the last reader (0 = all readers keep up)
+#define DEFAULT_SLOW_READER_US 5000
+#define BENCH_SHM_NAME "/ShmRingBench"
+
+struct BenchConfig
+{
+	unsigned long readers;
+	unsigned long frames;
+	size_t frameBytes;
+	std::chrono::microseconds period;
+	unsigned long slots;
+	std::chrono::microseconds slowReaderWork;
+};
+
+static uint64_t NowNs()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// Body of a reader process: read until the writer closes the ring, then
+// print one result line.
+static int RunReader(unsigned long index, const BenchConfig& config, bool slow)
+{
+	ShmFrameReader reader;
+	reader.Open(BENCH_SHM_NAME);
+
+	LatencyHistogram latency;
+	RawFrameHeader frame;
+	std::memset(&frame, 0, sizeof(frame));
+	std::vector<uint8_t> pixels;
+	uint64_t badFrames = 0;
+	while (reader.Read(frame, pixels, 1000) || !reader.WriterClosed())
+	{
+		if (pixels.empty())
+			continue;
+		uint64_t now = NowNs();
+		latency.Record(now > frame.timestampNs ? now - frame.timestampNs : 0);
+		// the writer fills each frame with the low byte of its ID
+		if (pixels[0] != static_cast<uint8_t>(frame.frameId) || pixels[pixels.size() - 1] != static_cast<uint8_t>(frame.frameId))
+			badFrames++;
+		pixels.clear();
+		if (slow)
+			std::this_thread::sleep_for(config.slowReaderWork);
+	}
+
+	char line[256];
+	int length = std::snprintf(line, sizeof(line), TAB2 "reader %lu%s: read %llu, lost %llu, torn %llu, latency us p50 %.1f, p99 %.1f, max %.1f\n", index,
+		slow ? " (slow)" : "", static_cast<unsigned long long>(reader.ReadFrames()), static_cast<unsigned long long>(reader.LostFrames()),
+		static_cast<unsigned long long>(badFrames), latency.Percentile(50.0) / 1e3, latency.Percentile(99.0) / 1e3, latency.Max() / 1e3);
+	// one write per line so lines from different readers do not interleave
+	ssize_t written = write(STDOUT_FILENO, line, static_cast<size_t>(length));
+	(void)written;
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	BenchConfig config;
+	config.readers = argc > 1 ? std::strtoul(argv[1], NULL, 10) : DEFAULT_READERS;
+	config.frames = argc > 2 ? std::strtoul(argv[2], NULL, 10) : DEFAULT_FRAMES;
+	config.frameBytes = static_cast<size_t>(argc > 3 ? std::strtoul(argv[3], NULL, 10) : DEFAULT_FRAME_KB) << 10;
+	config.period = std::chrono::microseconds(argc > 4 ? std::strtoul(argv[4], NULL, 10) : DEFAULT_PERIOD_US);
+	config.slots = argc > 5 ? std::strtoul(argv[5], NULL, 10) : DEFAULT_SLOTS;
+	config.slowReaderWork = std::chrono::microseconds(argc > 6 ? std::strtoul(argv[6], NULL, 10) : DEFAULT_SLOW_READER_US);
+	if (config.readers == 0 || config.readers > SHM_RING_MAX_READERS || config.frames == 0 || config.frameBytes == 0 || config.slots == 0)
+	{
+		std::cerr << "Usage: " << argv[0] << " [readers] [frames] [frame_kb] [period_us] [slots] [slow_reader_us]\n";
+		return -1;
+	}
+
+	std::cout << "ShmRingBench: " << config.readers << " readers, " << config.frames << " frames of " << (config.frameBytes >> 10) << " KB every "
+			  << config.period.count() << " us, " << config.slots << " slots\n";
+	std::cout.flush();
+
+	try
+	{
+		ShmFrameWriter writer;
+		writer.Create(BENCH_SHM_NAME, config.slots, config.frameBytes);
+
+		std::vector<pid_t> children;
+		for (unsigned long i = 0; i < config.readers; i++)
+		{
+			pid_t pid = fork();
+			if (pid < 0)
+				throw std::runtime_error(std::string("fork failed: ") + std::strerror(errno));
+			if (pid == 0)
+			{
+				bool slow = config.slowReaderWork.count() > 0 && config.readers > 1 && i == config.readers - 1;
+				int result = 1;
+				try
+				{
+					result = RunReader(i, config, slow);
+				}
+				catch (std::exception& ex)
+				{
+					std::cerr << "reader " << i << ": " << ex.what() << "\n";
+				}
+				_exit(result);
+			}
+			children.push_back(pid);
+		}
+
+		// wait until every reader has attached
+		for (int i = 0; i < 5000 && writer.Readers().size() < config.readers; i++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+		std::vector<uint8_t> pixels(config.frameBytes);
+		LatencyHistogram publish;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point next = start;
+		for (unsigned long i = 0; i < config.frames; i++)
+		{
+			next += config.period;
+			while (std::chrono::steady_clock::now() < next)
+				;
+
+			// touch the first and last byte, as a camera filling a new buffer would
+			pixels[0] = pixels[pixels.size() - 1] = static_cast<uint8_t>(i);
+			uint64_t begin = NowNs();
+			RawFrameHeader frame = MakeRawFrameHeader(config.frameBytes, 1, 8, 0, i, begin, config.frameBytes);
+			writer.Publish(frame, pixels.data());
+			publish.Record(NowNs() - begin);
+		}
+		double wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::vector<ShmReaderStatus> readers = writer.Readers();
+		size_t lapped = 0;
+		for (size_t i = 0; i < readers.size(); i++)
+			lapped += readers[i].lostFrames > 0 ? 1 : 0;
+
+		std::cout << TAB1 << "writer (" << wallSec << " s): publish us p50 " << publish.Percentile(50.0) / 1e3 << ", p99 " << publish.Percentile(99.0) / 1e3
+				  << ", max " << publish.Max() / 1e3 << ", " << writer.WakeCount() << " wakeups, " << lapped << " reader(s) lapped\n";
+		std::cout.flush();
+
+		// let the readers that keep up take the last frames
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		writer.Close();
+		for (size_t i = 0; i < children.size(); i++)
+			waitpid(children[i], NULL, 0);
+	}
+	catch (std::exception& ex)
+	{
+		std::cerr << "ShmRingBench: " << ex.what() << "\n";
+		return -1;
+	}
+	return 0;
+}
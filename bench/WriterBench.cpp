@@ -0,0 +1,272 @@
+/***************************************************************************************
+ ***                                                                                 ***
+ ***  Copyright (c) 2025, Lucid Vision Labs, Inc.                                    ***
+ ***                                                                                 ***
+ ***  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     ***
+ ***  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       ***
+ ***  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    ***
+ ***  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         ***
+ ***  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  ***
+ ***  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  ***
+ ***  SOFTWARE.                                                                      ***
+ ***                                                                                 ***
+ ***************************************************************************************/
+
+#include "FramePool.h"
+#include "RecordingWriter.h"
+#include "UringWriter.h"
+#include <chrono>
+#include <cstdlib>
+#include <dirent.h>
+#include <iostream>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#define TAB1 "  "
+
+// WriterBench
+//    Writes the same synthetic recording with the blocking pwritev backend and
+//    with the io_uring backend and reports sustained throughput, including the
+//    time for syncfs to push the data to the device. Run it on the disk that
+//    will hold real recordings; each pass writes frames * frame_kb of data.
+//    Pass direct = 1 to open the segments with O_DIRECT, and compare against a
+//    buffered run to see how much of the buffered rate is page cache.
+//
+//    Usage: WriterBench <dir> [frames] [frame_kb] [workers] [depth] [direct]
+
+// =-=-=-=-=-=-=-=-=-
+// =-=- SETTINGS =-=-
+// =-=-=-=-=-=-=-=-=-
+
+#define DEFAULT_FRAMES 500
+#define DEFAULT_FRAME_KB 5120
+#define DEFAULT_WORKERS 2
+#define DEFAULT_DEPTH 8
+#define SEGMENT_BYTES (1ull << 30)
+
+struct BenchConfig
+{
+	std::string dir;
+	size_t frames;
+	size_t frameBytes;
+	size_t workers;
+	unsigned depth;
+	bool direct;
+};
+
+struct PassResult
+{
+	double writeSec;
+	double syncSec;
+	uint64_t bytes;
+};
+
+// Create the directory for one pass, removing segments left by earlier runs.
+static std::string MakePassDir(const BenchConfig& config, const char* name)
+{
+	std::string dir = config.dir + "/" + name;
+	if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+		throw std::runtime_error("Failed to create " + dir + ": " + std::strerror(errno));
+
+	DIR* pDir = opendir(dir.c_str());
+	if (pDir)
+	{
+		for (dirent* entry = readdir(pDir); entry; entry = readdir(pDir))
+		{
+			std::string file = entry->d_name;
+			if (file.size() > 5 && file.compare(file.size() - 5, 5, ".lrec") == 0)
+				unlink((dir + "/" + file).c_str());
+		}
+		closedir(pDir);
+	}
+	return dir;
+}
+
+static void FillSlots(FramePool& pool)
+{
+	for (size_t i = 0; i < pool.SlotCount(); i++)
+		std::memset(pool.RegionBase() + i * pool.SlotBytes(), static_cast<int>(i), pool.SlotBytes());
+}
+
+static RawFrameHeader MakeHeader(const BenchConfig& config, uint64_t frameId)
+{
+	return MakeRawFrameHeader(2448, 2048, 8, 0x01080001, frameId, frameId * 33333333ull, config.frameBytes);
+}
+
+static double SyncDir(const std::string& dir)
+{
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+	if (fd >= 0)
+	{
+		syncfs(fd);
+		close(fd);
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+	return elapsed.count();
+}
+
+static PassResult RunPwrite(const BenchConfig& config)
+{
+	std::string dir = MakePassDir(config, "pwrite");
+	FramePool pool(config.workers, config.frameBytes);
+	FillSlots(pool);
+
+	PassResult result;
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	{
+		RecordingWriter writer(dir, SEGMENT_BYTES, config.direct);
+		std::atomic<size_t> next(0);
+		std::vector<std::thread> workers;
+		for (size_t w = 0; w < config.workers; w++)
+		{
+			workers.push_back(std::thread([&, w]() {
+				const uint8_t* pData = pool.RegionBase() + w * pool.SlotBytes();
+				for (size_t frame = next.fetch_add(1); frame < config.frames; frame = next.fetch_add(1))
+					writer.Append(MakeHeader(config, frame), pData);
+			}));
+		}
+		for (size_t w = 0; w < workers.size(); w++)
+			workers[w].join();
+		writer.Close();
+		result.bytes = writer.BytesWritten();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+	result.writeSec = elapsed.count();
+	result.syncSec = SyncDir(dir);
+	return result;
+}
+
+struct UringBenchContext
+{
+	FramePool* pool;
+};
+
+static void OnComplete(void* cookie, int error, void* context)
+{
+	if (error != 0)
+		throw std::runtime_error(std::string("io_uring write failed: ") + std::strerror(error));
+	static_cast<UringBenchContext*>(context)->pool->Release(static_cast<FrameSlot*>(cookie));
+}
+
+static PassResult RunUring(const BenchConfig& config, bool& available)
+{
+	std::string dir = MakePassDir(config, "uring");
+	FramePool pool(config.workers * config.depth, config.frameBytes);
+	FillSlots(pool);
+
+	PassResult result;
+	available = true;
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	{
+		RecordingWriter writer(dir, SEGMENT_BYTES, config.direct);
+		std::atomic<size_t> next(0);
+		std::atomic<bool> fixed(true);
+		std::atomic<int> initError(0);
+		std::vector<std::thread> workers;
+		for (size_t w = 0; w < config.workers; w++)
+		{
+			workers.push_back(std::thread([&]() {
+				UringRecorder recorder(&writer, config.depth);
+				int error = recorder.Init(&pool);
+				if (error != 0)
+				{
+					initError.store(error);
+					return;
+				}
+				if (!recorder.UsesRegisteredBuffers())
+					fixed.store(false);
+
+				UringBenchContext context;
+				context.pool = &pool;
+				for (size_t frame = next.fetch_add(1); frame < config.frames; frame = next.fetch_add(1))
+				{
+					if (recorder.InFlight() == recorder.Depth())
+						recorder.Reap(true, OnComplete, &context);
+
+					FrameSlot* slot = pool.TryAcquire(config.frameBytes);
+					while (!slot)
+					{
+						recorder.Reap(true, OnComplete, &context);
+						slot = pool.TryAcquire(config.frameBytes);
+					}
+					slot->size = config.frameBytes;
+					recorder.Submit(MakeHeader(config, frame), slot->data, slot, slot);
+					recorder.Reap(false, OnComplete, &context);
+				}
+				while (recorder.InFlight() > 0)
+					recorder.Reap(true, OnComplete, &context);
+			}));
+		}
+		for (size_t w = 0; w < workers.size(); w++)
+			workers[w].join();
+		writer.Close();
+		result.bytes = writer.BytesWritten();
+
+		if (initError.load() != 0)
+		{
+			std::cout << "io_uring unavailable: " << std::strerror(initError.load()) << "\n";
+			available = false;
+		}
+		else if (!fixed.load())
+		{
+			std::cout << "io_uring buffer registration failed (RLIMIT_MEMLOCK?); using plain writes\n";
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+	result.writeSec = elapsed.count();
+	result.syncSec = SyncDir(dir);
+	return result;
+}
+
+static void PrintResult(const char* name, const PassResult& result)
+{
+	double mb = result.bytes / 1e6;
+	std::cout << name << "\n";
+	std::cout << TAB1 << "write: " << result.writeSec << " s, " << mb / result.writeSec << " MB/s\n";
+	std::cout << TAB1 << "write + syncfs: " << result.writeSec + result.syncSec << " s, " << mb / (result.writeSec + result.syncSec) << " MB/s\n";
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		std::cout << "Usage: " << argv[0] << " <dir> [frames] [frame_kb] [workers] [depth] [direct]\n";
+		return -1;
+	}
+
+	BenchConfig config;
+	config.dir = argv[1];
+	config.frames = argc > 2 ? std::strtoul(argv[2], NULL, 10) : DEFAULT_FRAMES;
+	config.frameBytes = (argc > 3 ? std::strtoul(argv[3], NULL, 10) : DEFAULT_FRAME_KB) * 1024;
+	config.workers = argc > 4 ? std::strtoul(argv[4], NULL, 10) : DEFAULT_WORKERS;
+	config.depth = static_cast<unsigned>(argc > 5 ? std::strtoul(argv[5], NULL, 10) : DEFAULT_DEPTH);
+	config.direct = argc > 6 && std::strtoul(argv[6], NULL, 10) != 0;
+	if (config.frames == 0 || config.frameBytes == 0 || config.workers == 0 || config.depth == 0)
+	{
+		std::cout << "Invalid arguments\n";
+		return -1;
+	}
+
+	try
+	{
+		std::cout << "WriterBench: " << config.frames << " frames of " << config.frameBytes / 1024 << " KB, " << config.workers
+				  << " workers, io_uring depth " << config.depth
+				  << (config.direct ? ", O_DIRECT" : ", buffered") << "\n";
+
+		PrintResult("pwritev (blocking)", RunPwrite(config));
+
+		bool available = false;
+		PassResult uring = RunUring(config, available);
+		if (available)
+			PrintResult("io_uring", uring);
+	}
+	catch (std::exception& ex)
+	{
+		std::cout << "Standard exception thrown: " << ex.what() << "\n";
+		return -1;
+	}
+	return 0;
+}